@@ -1,7 +1,10 @@
 #include "include/communication_config.h"
 #include "include/network/tcp_client.h"
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <sstream>
+#include <vector>
 #include "include/protocols/PIAP.h"
 #include "include/protocols/TITP.h"
 
@@ -24,25 +27,22 @@ void println(const std::string &format, Args... args) {
     printf("\n");
 }
 
-// 封装发送控制包函数，带重试
-bool send_ctrl_packet_with_retry(tcp_client &client, std::unique_ptr<piap_t> packet) {
-    for (int i = 0; i < MAX_RETRIES; ++i) {
-        if (client.send_ctrl_packet(packet)) {
-            return true;
-        }
-        printf("Warning: Control packet retrying %d/%d...\n", i + 1, MAX_RETRIES);
+// 发送控制包。send_ctrl_packet 内部已经处理短写，失败意味着报文可能只写出了一部分，
+// 整包重发会破坏字节流，因此不再重试，由调用者放弃本次操作。
+bool send_ctrl_packet_checked(tcp_client &client, std::unique_ptr<piap_t> packet) {
+    if (client.send_ctrl_packet(packet)) {
+        return true;
     }
+    println("Warning: Control packet could not be sent, the connection may be broken.");
     return false;
 }
 
-// 封装发送数据包函数，带重试
-bool send_data_packet_with_retry(tcp_client &client, std::unique_ptr<titp_t> packet) {
-    for (int i = 0; i < MAX_RETRIES; ++i) {
-        if (client.send_data_packet(packet)) {
-            return true;
-        }
-        printf("Warning: Data packet retrying %d/%d...\n", i + 1, MAX_RETRIES);
+// 发送数据包，失败时同样不重发
+bool send_data_packet_checked(tcp_client &client, std::unique_ptr<titp_t> packet) {
+    if (client.send_data_packet(packet)) {
+        return true;
     }
+    println("Warning: Data packet could not be sent, the connection may be broken.");
     return false;
 }
 
@@ -72,7 +72,7 @@ void request_task_detail(tcp_client &client) {
     request->set_task_id(task_id);
 
     // 发送请求
-    if (!send_data_packet_with_retry(client, std::move(request))) {
+    if (!send_data_packet_checked(client, std::move(request))) {
         println("错误: 发送任务请求失败，请重试！");
         return;
     }
@@ -96,6 +96,179 @@ void request_task_detail(tcp_client &client) {
     }
 }
 
+// 显示一个任务响应
+void print_task_response(const std::unique_ptr<titp_t> &task_response) {
+    auto format_status = task_response->get_format_status();
+    auto resource_status = task_response->get_resource_status();
+
+    if (format_status != titp_format_type_t::FORMAT_OK) {
+        println("Error: Invalid task response format.");
+        return;
+    }
+
+    if (resource_status != titp_resource_status_type_t::RESOURCE_ACK) {
+        println("Error: Failed to get task. Status: %d", static_cast<int>(resource_status));
+        return;
+    }
+
+    // 显示任务信息
+    println("\n===== Task Details =====");
+    println("ID: %llu", static_cast<unsigned long long>(task_response->get_task_id()));
+    println("Name: %s", task_response->get_task_name());
+    println("Description: %s", task_response->get_task_description());
+    println("Difficulty: %d", static_cast<int>(task_response->get_difficulty()));
+    println("========================");
+}
+
+/**
+ * @brief 显示接收响应期间收到的服务器推送。
+ *
+ * @return bool 服务器已强制下线时返回 false
+ */
+bool show_server_events(tcp_client &client) {
+    while (auto notice = client.take_notice()) {
+        auto task_id = static_cast<unsigned long long>(notice->get_task_id());
+        switch (notice->get_notice_kind()) {
+            case titp_notice_kind_t::TASK_POSTED:
+                println("\n[New Task] [%llu] %s", task_id, notice->get_notice_text());
+                break;
+            case titp_notice_kind_t::TASK_UPDATED:
+                println("\n[Task Updated] [%llu] %s", task_id, notice->get_notice_text());
+                break;
+            case titp_notice_kind_t::TASK_DELETED:
+                println("\n[Task Removed] [%llu]", task_id);
+                break;
+            case titp_notice_kind_t::EVENTS_LOST:
+                println("\n[Server Notice] Some task events were missed, view the task list to refresh.");
+                break;
+            default:
+                println("\n[Server Notice] %s", notice->get_notice_text());
+                break;
+        }
+    }
+    if (client.was_forced_logout()) {
+        println("You have been logged out by the server.");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 连接断开后重新连接，凭登录时得到的会话令牌恢复会话，只需要一次往返，不再输入密码。
+ *
+ * @return bool 会话是否恢复。失败时令牌被清空，连接已经重新建立，可以直接重新登录
+ */
+bool resume_session(tcp_client &client, std::string &token) {
+    try {
+        client.disconnect();
+        client.connect_server();
+    } catch (const std::exception &e) {
+        println("Error: %s", e.what());
+        return false;
+    }
+    if (token.empty()) return false;
+
+    auto request = std::make_unique<piap_t>(piap_msg_type_t::RESUME_REQUEST);
+    request->set_session(token.c_str());
+    if (send_ctrl_packet_checked(client, std::move(request))) {
+        auto response = client.recv_ctrl_packet();
+        if (response && response->get_msg_type() == piap_msg_type_t::RESUME_RESPONSE &&
+            response->get_auth_status() == piap_auth_type_t::LOGIN_SUCCESS) {
+            return true;
+        }
+        if (response) {
+            println("Error Code %d: %s", static_cast<int>(response->get_auth_status()),
+                    piap_auth_status_message(response->get_auth_status()));
+        }
+    }
+
+    // 服务器拒绝恢复后会关闭连接，重新连接以便重新登录
+    token.clear();
+    try {
+        client.disconnect();
+        client.connect_server();
+    } catch (const std::exception &e) {
+        println("Error: %s", e.what());
+    }
+    return false;
+}
+
+/**
+ * @brief 订阅或取消订阅任务事件，订阅时可以只关注一个难度区间。
+ */
+bool update_subscription(tcp_client &client, bool subscribe) {
+    int min_level = static_cast<int>(task_difficulty_t::UNKNOWN);
+    int max_level = static_cast<int>(task_difficulty_t::EXTREMELY_HARD);
+    if (subscribe) {
+        print("Difficulty range (e.g. '2 4', empty for all tasks): ");
+        std::string range;
+        std::getline(std::cin, range);
+        std::istringstream range_stream(range);
+        int low, high;
+        if (range_stream >> low >> high) {
+            min_level = std::clamp(low, min_level, max_level);
+            max_level = std::clamp(high, min_level, max_level);
+        }
+    }
+
+    auto request = std::make_unique<titp_t>(titp_msg_type_t::SUBSCRIBE);
+    request->set_subscription(subscribe, static_cast<task_difficulty_t>(min_level),
+                              static_cast<task_difficulty_t>(max_level));
+    uint32_t request_id = client.assign_request_id(request);
+    if (!send_data_packet_checked(client, std::move(request))) {
+        println("Error: Failed to send subscribe request.");
+        return false;
+    }
+
+    auto ack = client.recv_data_response(request_id);
+    if (!ack || ack->get_msg_type() != titp_msg_type_t::SUBSCRIBE_ACK) {
+        println("Error: Failed to receive subscribe response.");
+        return false;
+    }
+    if (ack->get_subscription_active()) {
+        println("Subscribed to tasks with difficulty %d-%d.", static_cast<int>(ack->get_min_difficulty()),
+                static_cast<int>(ack->get_max_difficulty()));
+    } else {
+        println("Unsubscribed from task events.");
+    }
+    return ack->get_subscription_active();
+}
+
+/**
+ * @brief 查看任务列表：发送一个不带任务 ID 的批量请求，服务器在同一批次中返回全部任务，直到 BATCH_END。
+ */
+void show_task_list(tcp_client &client) {
+    auto batch_request = std::make_unique<titp_t>(titp_msg_type_t::BATCH_REQUEST);
+    uint32_t request_id = client.assign_request_id(batch_request);
+    if (!send_data_packet_checked(client, std::move(batch_request))) {
+        println("Error: Failed to send task list request.");
+        return;
+    }
+
+    println("\n===== Task List =====");
+    uint32_t received = 0;
+    while (true) {
+        auto packet = client.recv_data_response(request_id);
+        if (!packet) {
+            println("Error: Failed to receive task list.");
+            return;
+        }
+        if (packet->get_msg_type() == titp_msg_type_t::BATCH_END) {
+            if (packet->get_batch_count() != received) {
+                println("Warning: Expected %u tasks but received %u.", packet->get_batch_count(), received);
+            }
+            break;
+        }
+
+        ++received;
+        if (packet->get_resource_status() == titp_resource_status_type_t::RESOURCE_ACK) {
+            println("[%llu] %s (Difficulty: %d)", static_cast<unsigned long long>(packet->get_task_id()),
+                    packet->get_task_name(), static_cast<int>(packet->get_difficulty()));
+        }
+    }
+    println("=====================");
+}
+
 int main() {
     try {
         tcp_client client(PORT, SERVER_TEST);
@@ -106,6 +279,7 @@ int main() {
         println("Server: %s:%d", client.get_server_ip(), client.get_port());
         println("==================================================\n");
 
+        std::string session_token;      // 登录成功时服务器下发，断线重连时用于恢复会话
         while (true) {
             bool is_authorized = false;
             std::string acc, pwd;
@@ -122,7 +296,7 @@ int main() {
                 std::unique_ptr <piap_t> auth_pkt = std::make_unique<piap_t>(piap_msg_type_t::LOGIN_REQUEST);
                 auth_pkt->set_usr_info(acc.c_str(), pwd.c_str());
 
-                if (!send_ctrl_packet_with_retry(client, std::move(auth_pkt))) {
+                if (!send_ctrl_packet_checked(client, std::move(auth_pkt))) {
                     println("Error: Failed to send login request, try again!");
                     continue;
                 }
@@ -142,91 +316,113 @@ int main() {
                 }
                 auto format_status = recv_pkt->valid_format();
                 if (format_status != piap_format_type_t::FORMAT_OK) {
-                    println("Error Code %s: Log in request broke down, try again!",
-                            static_cast<uint16_t>(format_status));
+                    println("Error Code %d: Log in request broke down, try again!",
+                            static_cast<int>(format_status));
                     continue;
                 }
+                // 服务器只回复状态码，提示信息由客户端按状态码查表得到
                 auto auth_status = recv_pkt->get_auth_status();
                 if (auth_status != piap_auth_type_t::LOGIN_SUCCESS) {
-                    println("Error Code {}: {}", static_cast<uint16_t>(auth_status), recv_pkt->get_status_msg());
+                    println("Error Code %d: %s", static_cast<int>(auth_status), piap_auth_status_message(auth_status));
                     continue;
                 }
+                session_token = recv_pkt->get_session();
             }
 
 
             is_authorized = true;
+            bool subscribed = false;
             println("Welcome back, user: {}", acc);
 
             // 进行数据层面的交互
             while (is_authorized) {
                 println("\n===== Available Operations =====");
                 println("1. Request Task");
-                println("2. Logout");
+                println("2. View Task List");
+                println("3. Logout");
+                println(subscribed ? "4. Unsubscribe from task events" : "4. Subscribe to task events");
                 print("Please choose an option: ");
 
                 std::string choice;
                 std::getline(std::cin, choice);
 
                 if (choice == "1") {
-                    uint64_t task_id;
-                    print("Enter task ID (1-3): ");
+                    print("Enter task IDs (1-3, separated by spaces): ");
                     std::string task_id_str;
                     std::getline(std::cin, task_id_str);
-                    try {
-                        task_id = std::stoull(task_id_str);
-                    } catch (...) {
-                        println("Invalid task ID. Please enter a number.");
-                        continue;
-                    }
 
-                    // 创建任务请求数据包
-                    auto task_request = std::make_unique<titp_t>(titp_msg_type_t::RESOURCE_REQUEST);
-                    task_request->set_task_id(task_id);
-
-                    // 发送任务请求
-                    if (!send_data_packet_with_retry(client, std::move(task_request))) {
-                        println("Error: Failed to send task request.");
-                        continue;
+                    std::vector<uint64_t> task_ids;
+                    std::istringstream task_id_stream(task_id_str);
+                    std::string token;
+                    bool valid = true;
+                    while (task_id_stream >> token) {
+                        try {
+                            task_ids.push_back(std::stoull(token));
+                        } catch (...) {
+                            valid = false;
+                            break;
+                        }
                     }
-
-                    // 接收任务响应
-                    auto task_response = client.recv_data_packet();
-                    if (!task_response) {
-                        println("Error: Failed to receive task response.");
+                    if (!valid || task_ids.empty()) {
+                        println("Invalid task ID. Please enter a number.");
                         continue;
                     }
 
-                    // 处理任务响应
-                    auto format_status = task_response->get_format_status();
-                    auto resource_status = task_response->get_resource_status();
-
-                    if (format_status != titp_format_type_t::FORMAT_OK) {
-                        println("Error: Invalid task response format.");
-                        continue;
+                    // 所有请求先连续发出，再按请求编号逐个取回响应，整批只等待一次往返
+                    std::vector<uint32_t> request_ids;
+                    for (uint64_t task_id : task_ids) {
+                        auto task_request = std::make_unique<titp_t>(titp_msg_type_t::RESOURCE_REQUEST);
+                        task_request->set_task_id(task_id);
+                        uint32_t request_id = client.assign_request_id(task_request);
+
+                        if (!send_data_packet_checked(client, std::move(task_request))) {
+                            println("Error: Failed to send task request.");
+                            break;
+                        }
+                        request_ids.push_back(request_id);
                     }
 
-                    if (resource_status != titp_resource_status_type_t::RESOURCE_ACK) {
-                        println("Error: Failed to get task. Status: %s", static_cast<int>(resource_status));
-                        continue;
+                    for (uint32_t request_id : request_ids) {
+                        auto task_response = client.recv_data_response(request_id);
+                        if (!task_response) {
+                            println("Error: Failed to receive task response.");
+                            break;
+                        }
+                        print_task_response(task_response);
                     }
 
-                    // 显示任务信息
-                    println("\n===== Task Details =====");
-                    println("ID: %llu", task_response->get_task_id());
-                    println("Name: %s", task_response->get_task_name());
-                    println("Description: %s", task_response->get_task_description());
-                    println("Difficulty: %d", static_cast<int>(task_response->get_difficulty()));
-                    println("========================");
-
                 } else if (choice == "2") {
+                    show_task_list(client);
+                } else if (choice == "3") {
                     // 退出登录
                     auto logout_packet = std::make_unique<piap_t>(piap_msg_type_t::LOGOUT_REQUEST);
-                    send_ctrl_packet_with_retry(client, std::move(logout_packet));
+                    send_ctrl_packet_checked(client, std::move(logout_packet));
+                    session_token.clear();
                     is_authorized = false;
                     println("You have been logged out.");
+                } else if (choice == "4") {
+                    subscribed = update_subscription(client, !subscribed);
                 } else {
                     println("Invalid option. Please try again.");
                 }
+
+                // 服务器强制下线后连接已经关闭，直接退出客户端
+                bool connected = client.collect_notices();
+                if (!show_server_events(client)) return 0;
+                if (is_authorized && !connected) {
+                    println("Connection lost, resuming the session...");
+                    if (resume_session(client, session_token)) {
+                        println("Session resumed.");
+                        // 订阅属于连接，不随令牌保存
+                        if (subscribed) {
+                            subscribed = false;
+                            println("Task event subscription ended with the old connection, subscribe again if needed.");
+                        }
+                    } else {
+                        println("Please log in again.");
+                        is_authorized = false;
+                    }
+                }
             }
 
         }
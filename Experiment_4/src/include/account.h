@@ -18,7 +18,7 @@ private:
 
 public:
     account(const std::string& uid, const std::string& pwd, const std::string& name,
-           uint8_t lvl, uint16_t str, uint16_t intel, uint16_t agi)
+           uint8_t lvl, [[maybe_unused]] uint16_t str, [[maybe_unused]] uint16_t intel, [[maybe_unused]] uint16_t agi)
         : usr_ID(uid),
           password(pwd),
           usr_name(name),
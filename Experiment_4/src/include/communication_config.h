@@ -15,5 +15,6 @@ constexpr const char* AUTHENTICATION_ERROR = "Authentication failed";
 constexpr const char* TASK_ERROR = "Task request failed";
 
 // 添加一些超时设置
-constexpr int CONNECTION_TIMEOUT = 10; // 秒
-constexpr int RECEIVE_TIMEOUT = 5;    // 秒
\ No newline at end of file
+constexpr int CONNECTION_TIMEOUT = 10; // 秒，连接建立后必须在这段时间内完成认证
+constexpr int RECEIVE_TIMEOUT = 5;    // 秒，一个报文开始到达后必须在这段时间内收完
+constexpr int IDLE_TIMEOUT = 300;     // 秒，认证后连续这么久没有收到任何报文时断开连接
\ No newline at end of file
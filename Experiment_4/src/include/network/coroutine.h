@@ -0,0 +1,171 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief 惰性启动的协程任务类型，只有被 co_await 时才开始执行，执行结束后通过对称转移恢复等待者。
+ * 任务对象拥有协程帧，对象析构时帧也随之销毁。
+ *
+ * @tparam T 协程的返回值类型
+ */
+template<typename T = void>
+class task;
+
+namespace coroutine_detail {
+
+    struct promise_base {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        std::suspend_always initial_suspend() const noexcept {
+            return {};
+        }
+
+        // 协程结束时直接转移到等待者，避免递归 resume 导致栈增长。
+        struct final_awaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) const noexcept {
+                std::coroutine_handle<> next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        final_awaiter final_suspend() const noexcept {
+            return {};
+        }
+
+        void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+    };
+
+    template<typename T>
+    struct promise : promise_base {
+        std::optional<T> value;
+
+        task<T> get_return_object() noexcept;
+
+        template<typename U>
+        void return_value(U &&v) {
+            value.emplace(std::forward<U>(v));
+        }
+
+        T take() {
+            if (exception) std::rethrow_exception(exception);
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct promise<void> : promise_base {
+        task<void> get_return_object() noexcept;
+
+        void return_void() const noexcept {}
+
+        void take() const {
+            if (exception) std::rethrow_exception(exception);
+        }
+    };
+}
+
+template<typename T>
+class task{
+
+        public:
+        using promise_type = coroutine_detail::promise<T>;
+
+        private:
+        std::coroutine_handle<promise_type> handle;
+
+        public:
+        explicit task(std::coroutine_handle<promise_type> h) noexcept : handle(h) {}
+
+        task(task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+        task &operator=(task &&other) noexcept {
+            if (this != &other) {
+                if (handle) handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        task(const task &) = delete;
+        task &operator=(const task &) = delete;
+
+        ~task() {
+            if (handle) handle.destroy();
+        }
+
+        bool await_ready() const noexcept {
+            return !handle || handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume() {
+            return handle.promise().take();
+        }
+};
+
+namespace coroutine_detail {
+
+    template<typename T>
+    task<T> promise<T>::get_return_object() noexcept {
+        return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+    }
+
+    inline task<void> promise<void>::get_return_object() noexcept {
+        return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+    }
+
+    // detach() 使用的顶层协程：创建后挂起等待调用者启动，结束时自行销毁协程帧。
+    struct detached {
+        struct promise_type {
+            detached get_return_object() noexcept {
+                return detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() const noexcept {
+                return {};
+            }
+
+            void return_void() const noexcept {}
+
+            // 顶层任务必须自行接住异常：协程帧随即自行销毁，持有它的一方不会知道，悄悄丢弃只会留下悬空的句柄
+            [[noreturn]] void unhandled_exception() const noexcept {
+                std::terminate();
+            }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    inline detached run_detached(task<void> t) {
+        co_await std::move(t);
+    }
+}
+
+/**
+ * @brief 将任务转为不被任何人等待的顶层协程。返回的句柄处于挂起状态，调用者保存后再 resume() 启动；
+ * 协程运行结束时自行销毁，只有仍处于挂起状态时才允许调用者 destroy()。
+ */
+inline std::coroutine_handle<> detach(task<void> t) {
+    return coroutine_detail::run_detached(std::move(t)).handle;
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "timer_wheel.h"
+
+/**
+ * @brief 基于 epoll 的事件循环（Reactor），负责监听文件描述符的就绪事件并分发给对应的处理函数。
+ * 事件循环本身不关心文件描述符背后的协议，所有的读写逻辑都应当由注册的回调完成。
+ * 每个循环持有一个时间轮与一个粗粒度时钟：每轮 epoll_wait 返回后读取一次时间，回调中通过 now_ms()/unix_time() 读取缓存，
+ * 分发完就绪事件后触发到期的定时器，epoll_wait 的超时取到下一个定时器到期为止。
+ * 除 post() 与 stop() 外，其余成员函数只允许在运行该循环的线程中调用。
+ *
+ */
+class event_loop{
+
+        public:
+        using handler_t = std::function<void(uint32_t events)>;
+        using task_t = std::function<void()>;
+
+        private:
+        int epoll_fd;
+        int wakeup_fd;
+        std::atomic<bool> is_running;
+        std::atomic<bool> stop_requested;
+        std::vector<epoll_event> ready_events;
+        std::unordered_map<int, handler_t> handlers;
+
+        std::mutex pending_mutex;
+        std::vector<task_t> pending_tasks;
+        std::vector<task_t> running_tasks;      // 与 pending_tasks 轮流交换，两块缓冲区都保留容量，投递任务不再分配内存
+
+        task_t pre_poll_hook;
+
+        coarse_clock clock;
+        timer_wheel timers;
+
+        void wakeup() noexcept {
+            uint64_t one = 1;
+            ssize_t n = write(wakeup_fd, &one, sizeof(one));
+            (void)n;
+        }
+
+        // 执行其他线程通过 post() 投递过来的任务，交换出队列后再执行，避免持锁调用回调。
+        // 执行完只清空不释放，下一轮交换回去继续承接 post()；上一轮若因回调抛出而中断，剩下的任务在交换前丢弃。
+        void run_pending_tasks() {
+            uint64_t counter;
+            ssize_t n = read(wakeup_fd, &counter, sizeof(counter));
+            (void)n;
+
+            running_tasks.clear();
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                running_tasks.swap(pending_tasks);
+            }
+            for (auto &task : running_tasks) {
+                task();
+            }
+            running_tasks.clear();
+        }
+
+        public:
+        /**
+         * @brief 创建 epoll 实例。
+         *
+         * @param max_events 单次 epoll_wait 最多取回的就绪事件数量。
+         */
+        explicit event_loop(int max_events = 1024)
+        : epoll_fd(-1), wakeup_fd(-1), is_running(false), stop_requested(false), ready_events(max_events > 0 ? max_events : 1),
+          timers(clock.now_ms()) {
+
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd < 0) {
+                throw std::runtime_error(
+                std::string("Error: Failed to create epoll instance - ") + strerror(errno)
+                );
+            }
+
+            wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (wakeup_fd < 0) {
+                int saved_errno = errno;
+                close(epoll_fd);
+                throw std::runtime_error(
+                std::string("Error: Failed to create wakeup eventfd - ") + strerror(saved_errno)
+                );
+            }
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = wakeup_fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) < 0) {
+                int saved_errno = errno;
+                close(wakeup_fd);
+                close(epoll_fd);
+                throw std::runtime_error(
+                std::string("Error: Failed to watch wakeup eventfd - ") + strerror(saved_errno)
+                );
+            }
+        }
+
+        ~event_loop() noexcept {
+            if (wakeup_fd >= 0) {
+                close(wakeup_fd);
+                wakeup_fd = -1;
+            }
+            if (epoll_fd >= 0) {
+                close(epoll_fd);
+                epoll_fd = -1;
+            }
+        }
+
+        event_loop(const event_loop&) = delete;
+        event_loop& operator=(const event_loop&) = delete;
+
+        /**
+         * @brief 注册文件描述符及其就绪回调。
+         *
+         * @param fd 需要监听的文件描述符
+         * @param events epoll 事件掩码，例如 `EPOLLIN | EPOLLET`
+         * @param handler 就绪时调用的回调，参数为实际触发的事件掩码
+         * @return bool 注册是否成功
+         */
+        bool add_fd(int fd, uint32_t events, handler_t handler) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                return false;
+            }
+            handlers[fd] = std::move(handler);
+            return true;
+        }
+
+        bool modify_fd(int fd, uint32_t events) noexcept {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.fd = fd;
+            return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+        }
+
+        /**
+         * @brief 注销文件描述符。必须在 close(fd) 之前调用，否则同一批次中残留的事件可能被分发给复用该 fd 的新连接。
+         */
+        bool remove_fd(int fd) noexcept {
+            handlers.erase(fd);
+            return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+        }
+
+        /**
+         * @brief 运行事件循环直到 stop() 被调用。
+         *
+         * @param timeout_ms epoll_wait 的超时时间，-1 表示无限等待；有定时器时不会超过下一个定时器的到期时间。
+         */
+        void run(int timeout_ms = -1) {
+            is_running = true;
+            while (!stop_requested) {
+                if (pre_poll_hook) pre_poll_hook();
+
+                int wait_ms = timers.next_timeout_ms();
+                if (wait_ms < 0 || (timeout_ms >= 0 && timeout_ms < wait_ms)) wait_ms = timeout_ms;
+
+                int n = epoll_wait(epoll_fd, ready_events.data(), static_cast<int>(ready_events.size()), wait_ms);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(
+                    std::string("Error: epoll_wait failed - ") + strerror(errno)
+                    );
+                }
+
+                // 本轮回调看到的时间都是这一次读取的结果；先推进时钟再分发，新定时器从真实的当前时间开始计时
+                clock.update();
+                timers.set_time(clock.now_ms());
+
+                for (int i = 0; i < n && !stop_requested; ++i) {
+                    int fd = ready_events[i].data.fd;
+                    if (fd == wakeup_fd) {
+                        run_pending_tasks();
+                        continue;
+                    }
+                    // 回调可能在本批次中注销了其他 fd，因此每次分发前都重新查找。
+                    auto it = handlers.find(fd);
+                    if (it == handlers.end()) continue;
+
+                    // 复制一份回调，防止回调内部 remove_fd(fd) 时销毁正在执行的 std::function。
+                    handler_t handler = it->second;
+                    handler(ready_events[i].events);
+                }
+
+                // 就绪事件先于定时器处理：同一轮里刚刚到达的数据可以挽救即将超时的连接
+                if (!stop_requested) timers.expire();
+            }
+            is_running = false;
+        }
+
+        /**
+         * @brief 设置每次进入 epoll_wait 之前调用的钩子，用于把本轮积累的工作（例如 io_uring 提交）批量刷出。
+         */
+        void set_pre_poll_hook(task_t hook) {
+            pre_poll_hook = std::move(hook);
+        }
+
+        /**
+         * @brief 线程安全地停止事件循环，可以在任意线程调用，也可以在 run() 之前调用。
+         */
+        void stop() noexcept {
+            stop_requested = true;
+            wakeup();
+        }
+
+        /**
+         * @brief 将任务投递到事件循环所在线程执行，可以在任意线程调用。
+         */
+        void post(task_t task) {
+            {
+                std::lock_guard<std::mutex> lock(pending_mutex);
+                pending_tasks.push_back(std::move(task));
+            }
+            wakeup();
+        }
+
+        /**
+         * @brief 本循环的时间轮，定时器回调在循环线程中执行。
+         */
+        timer_wheel &get_timers() noexcept {
+            return timers;
+        }
+
+        // 本轮 epoll_wait 返回时缓存的单调时间（毫秒）
+        uint64_t now_ms() const noexcept {
+            return clock.now_ms();
+        }
+
+        // 本轮 epoll_wait 返回时缓存的 Unix 时间（秒），用于报文时间戳的 TTL 检查
+        uint32_t unix_time() const noexcept {
+            return clock.unix_time();
+        }
+
+        bool is_active() const noexcept {
+            return is_running;
+        }
+
+        size_t watched_count() const noexcept {
+            return handlers.size();
+        }
+
+        int get_epoll_fd() const noexcept {
+            return epoll_fd;
+        }
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <netinet/in.h>
+#include "recv_buffer.h"
+#include "../protocols/PIAP.h"
+#include "../protocols/TITP.h"
+
+// 单个报文允许的最大长度，超过该长度的报文被视为恶意或损坏的数据流。
+constexpr size_t MAX_FRAME_SIZE = 64 * 1024;
+
+enum class frame_kind_t : uint8_t {
+    PIAP,       // 控制通路报文，v1 长度固定为 PIAP_TOTAL_SIZE，v2 为首部加上 payload_length
+    TITP        // 数据通路报文，长度为首部加上 payload_length
+};
+
+enum class decode_status_t : uint8_t {
+    FRAME_READY,    // 取出了一个完整报文
+    NEED_MORE,      // 缓冲区中的数据不足一个报文，等待下一次读取
+    BAD_FRAME       // 魔数无法识别或长度越界，连接应当被关闭
+};
+
+/**
+ * @brief 从接收缓冲区中切分出的一个完整报文，仍保持网络字节序。
+ * data 在下一次调用 frame_decoder::next() 或向缓冲区写入数据之前有效。
+ */
+struct frame_t {
+    frame_kind_t kind;
+    const std::byte *data;
+    size_t size;
+};
+
+/**
+ * @brief 可恢复的 PIAP/TITP 报文切分器。
+ * 报文首部只解析一次，长度记录在解码器中，数据不足时直接返回，下次可读时从断点继续。
+ * 报文跨越环形缓冲区末尾时才会拷贝到内部暂存区，其余情况直接引用缓冲区内存。
+ *
+ */
+class frame_decoder{
+
+        private:
+        size_t pending_size;                // 当前正在组装的报文总长度，0 表示尚未解析首部
+        frame_kind_t pending_kind;
+        std::vector<std::byte> scratch;
+
+        /**
+         * @brief 解析缓冲区头部的报文首部，确定报文类型与总长度。
+         */
+        decode_status_t parse_header(const recv_buffer &buf) {
+            if (buf.readable() < sizeof(uint32_t)) return decode_status_t::NEED_MORE;
+
+            uint32_t magic;
+            buf.peek(&magic, sizeof(magic));
+            magic = ntohl(magic);
+
+            if (magic == PIAP_MAGIC) {
+                if (buf.readable() < sizeof(piap_header_t)) return decode_status_t::NEED_MORE;
+
+                uint16_t version;
+                uint32_t payload_length;
+                buf.peek(&version, sizeof(version), offsetof(piap_header_t, version));
+                buf.peek(&payload_length, sizeof(payload_length), offsetof(piap_header_t, payload_length));
+                size_t total_size = piap_frame_size(version, payload_length);
+                if (total_size == 0) return decode_status_t::BAD_FRAME;
+
+                pending_kind = frame_kind_t::PIAP;
+                pending_size = total_size;
+                return decode_status_t::FRAME_READY;
+            }
+
+            if (magic == TITP_MAGIC) {
+                if (buf.readable() < sizeof(titp_header_t)) return decode_status_t::NEED_MORE;
+
+                uint32_t payload_length;
+                buf.peek(&payload_length, sizeof(payload_length), offsetof(titp_header_t, payload_length));
+                size_t total_size = sizeof(titp_header_t) + static_cast<size_t>(ntohl(payload_length));
+                if (total_size > MAX_FRAME_SIZE) return decode_status_t::BAD_FRAME;
+
+                pending_kind = frame_kind_t::TITP;
+                pending_size = total_size;
+                return decode_status_t::FRAME_READY;
+            }
+
+            return decode_status_t::BAD_FRAME;
+        }
+
+        public:
+        frame_decoder() : pending_size(0), pending_kind(frame_kind_t::PIAP) {}
+
+        /**
+         * @brief 尝试从缓冲区中取出下一个完整报文，取出的报文会立即从缓冲区中消费掉。
+         *
+         * @param buf 连接的接收缓冲区
+         * @param out 成功时写入报文的位置与长度
+         * @return decode_status_t 解码结果
+         */
+        decode_status_t next(recv_buffer &buf, frame_t &out) {
+            if (pending_size == 0) {
+                decode_status_t status = parse_header(buf);
+                if (status != decode_status_t::FRAME_READY) return status;
+            }
+
+            if (buf.readable() < pending_size) return decode_status_t::NEED_MORE;
+
+            const std::byte *data = buf.contiguous(pending_size);
+            if (!data) {
+                scratch.resize(pending_size);
+                buf.peek(scratch.data(), pending_size);
+                data = scratch.data();
+            }
+
+            out.kind = pending_kind;
+            out.data = data;
+            out.size = pending_size;
+
+            buf.consume(pending_size);
+            pending_size = 0;
+            return decode_status_t::FRAME_READY;
+        }
+
+        /**
+         * @brief 是否有报文只收到了一部分。
+         */
+        bool has_partial_frame(const recv_buffer &buf) const noexcept {
+            return pending_size != 0 || !buf.empty();
+        }
+};
\ No newline at end of file
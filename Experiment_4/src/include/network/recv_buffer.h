@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <sys/uio.h>
+
+/**
+ * @brief 每个连接独占的接收环形缓冲区。
+ * 读写位置单调递增，通过容量（2 的幂）取模定位到实际内存，空闲区域最多被分成两段，
+ * 可以用一次 readv 读满；已读数据在下一次写入之前保持有效，解码器可以直接引用其中的报文。
+ *
+ */
+class recv_buffer{
+
+        private:
+        std::unique_ptr<std::byte[]> storage;
+        size_t capacity;
+        size_t max_capacity;
+        size_t read_pos;
+        size_t write_pos;
+
+        static size_t round_up_pow2(size_t n) noexcept {
+            size_t cap = 1;
+            while (cap < n) cap <<= 1;
+            return cap;
+        }
+
+        size_t mask() const noexcept {
+            return capacity - 1;
+        }
+
+        public:
+        /**
+         * @param initial_capacity 初始容量，空闲连接只占用这部分内存
+         * @param max_capacity 允许扩容到的上限，应当不小于单个报文的最大长度
+         */
+        explicit recv_buffer(size_t initial_capacity = 4096, size_t max_capacity = 128 * 1024)
+        : capacity(round_up_pow2(initial_capacity)), max_capacity(round_up_pow2(max_capacity)),
+          read_pos(0), write_pos(0) {
+            storage = std::make_unique<std::byte[]>(capacity);
+        }
+
+        recv_buffer(const recv_buffer&) = delete;
+        recv_buffer& operator=(const recv_buffer&) = delete;
+        recv_buffer(recv_buffer&&) noexcept = default;
+        recv_buffer& operator=(recv_buffer&&) noexcept = default;
+
+        size_t readable() const noexcept {
+            return write_pos - read_pos;
+        }
+
+        size_t writable() const noexcept {
+            return capacity - readable();
+        }
+
+        size_t get_capacity() const noexcept {
+            return capacity;
+        }
+
+        bool empty() const noexcept {
+            return read_pos == write_pos;
+        }
+
+        /**
+         * @brief 缓冲区写满时尝试翻倍扩容，扩容后数据被重新排列到内存起始处。
+         *
+         * @return bool 是否成功扩容（已经达到上限时返回 false）
+         */
+        bool grow() {
+            if (capacity >= max_capacity) return false;
+
+            size_t new_capacity = capacity << 1;
+            auto new_storage = std::make_unique<std::byte[]>(new_capacity);
+            size_t n = readable();
+            peek(new_storage.get(), n);
+
+            storage = std::move(new_storage);
+            capacity = new_capacity;
+            read_pos = 0;
+            write_pos = n;
+            return true;
+        }
+
+        /**
+         * @brief 取得空闲区域对应的 iovec，供 readv 一次填满。
+         *
+         * @return int iovec 的段数（0、1 或 2）
+         */
+        int writable_segments(iovec (&iov)[2]) noexcept {
+            size_t free_bytes = writable();
+            if (free_bytes == 0) return 0;
+
+            size_t start = write_pos & mask();
+            size_t first = std::min(free_bytes, capacity - start);
+            iov[0].iov_base = storage.get() + start;
+            iov[0].iov_len = first;
+            if (first == free_bytes) return 1;
+
+            iov[1].iov_base = storage.get();
+            iov[1].iov_len = free_bytes - first;
+            return 2;
+        }
+
+        /**
+         * @brief 确认通过 writable_segments 写入了 n 字节。
+         */
+        void commit(size_t n) noexcept {
+            write_pos += n;
+        }
+
+        /**
+         * @brief 追加一段已经在用户态的数据，空间不足时扩容。
+         *
+         * @return bool 超过容量上限时返回 false，此时缓冲区不变
+         */
+        bool append(const std::byte *data, size_t n) {
+            while (writable() < n) {
+                if (!grow()) return false;
+            }
+
+            iovec iov[2]{};
+            int iovcnt = writable_segments(iov);
+            if (iovcnt == 0) return n == 0;
+            size_t first = std::min(n, iov[0].iov_len);
+            std::memcpy(iov[0].iov_base, data, first);
+            if (first < n && iovcnt > 1) {
+                std::memcpy(iov[1].iov_base, data + first, n - first);
+            }
+            commit(n);
+            return true;
+        }
+
+        /**
+         * @brief 从读位置偏移 offset 处拷贝 n 字节到 dst，自动处理环绕。调用者需保证数据足够。
+         */
+        void peek(void *dst, size_t n, size_t offset = 0) const noexcept {
+            size_t start = (read_pos + offset) & mask();
+            size_t first = std::min(n, capacity - start);
+            std::memcpy(dst, storage.get() + start, first);
+            if (first < n) {
+                std::memcpy(static_cast<std::byte *>(dst) + first, storage.get(), n - first);
+            }
+        }
+
+        /**
+         * @brief 若从读位置开始的 n 字节在内存中连续，直接返回其地址，否则返回 nullptr。
+         */
+        const std::byte *contiguous(size_t n) const noexcept {
+            size_t start = read_pos & mask();
+            if (start + n > capacity) return nullptr;
+            return storage.get() + start;
+        }
+
+        /**
+         * @brief 丢弃读位置开始的 n 字节。被丢弃的数据在下一次写入前仍然可以访问。
+         */
+        void consume(size_t n) noexcept {
+            read_pos += n;
+            // 缓冲区读空时回到起点，让下一次读取尽量不跨越环绕点。
+            if (read_pos == write_pos) {
+                read_pos = 0;
+                write_pos = 0;
+            }
+        }
+};
\ No newline at end of file
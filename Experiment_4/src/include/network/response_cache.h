@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include "send_buffer.h"
+#include "../protocols/TITP.h"
+#include "../storage/flat_task_index.h"
+
+/**
+ * @brief 按任务 ID 缓存已经编码好的 RESOURCE_SENT 响应，v1 与 v2 各一份。
+ * 响应只在建立缓存时编码一次，之后所有连接共享同一块只读内存（引用计数），
+ * 每次命中只改写首部中的请求编号，发送时以首部副本加共享报文体两段 iovec 写出。
+ * 本身不加锁：多个 Reactor 线程可以同时查找，任务变更时由调用者持有写锁再修改。
+ *
+ */
+class response_cache{
+
+        private:
+        struct entry {
+            shared_frame v1;
+            shared_frame v2;
+        };
+
+        flat_task_index<entry> entries;
+        entry not_found;        // 任务不存在时的响应与任务 ID 无关，所有未命中共用
+
+        static shared_frame &slot(entry &e, uint16_t version) noexcept {
+            return version == TITP_VERSION_V1 ? e.v1 : e.v2;
+        }
+
+        static const shared_frame &slot(const entry &e, uint16_t version) noexcept {
+            return version == TITP_VERSION_V1 ? e.v1 : e.v2;
+        }
+
+        public:
+        /**
+         * @brief 缓存一个任务在 version 下的响应，报文类型需要提供 wire_size() 与 encode()。
+         * 请求编号在发送时改写，这里应为 0。
+         */
+        template<typename Packet>
+        void store(uint64_t task_id, uint16_t version, const Packet &response) {
+            entry *cached = entries.find(task_id);
+            if (!cached) cached = &entries.assign(task_id, entry{});
+            slot(*cached, version) = encode_shared(response);
+        }
+
+        /**
+         * @brief 缓存任务不存在时的响应。
+         */
+        template<typename Packet>
+        void store_not_found(uint16_t version, const Packet &response) {
+            slot(not_found, version) = encode_shared(response);
+        }
+
+        /**
+         * @brief 查找任务的响应，任务不存在时返回对应版本的 not found 响应，两者都没有缓存时返回 nullptr。
+         */
+        const shared_frame &find(uint64_t task_id, uint16_t version) const noexcept {
+            const shared_frame *cached = lookup(task_id, version);
+            return cached ? *cached : slot(not_found, version);
+        }
+
+        /**
+         * @brief 一次探测取得任务的缓存响应，没有缓存时返回 nullptr，调用者据此改从其他来源编码。
+         */
+        const shared_frame *lookup(uint64_t task_id, uint16_t version) const noexcept {
+            const entry *cached = entries.find(task_id);
+            return cached && slot(*cached, version) ? &slot(*cached, version) : nullptr;
+        }
+
+        const shared_frame &not_found_response(uint16_t version) const noexcept {
+            return slot(not_found, version);
+        }
+
+        /**
+         * @brief 删除一个任务的响应，之后对该任务的请求得到 not found 响应。
+         */
+        void erase(uint64_t task_id) {
+            entries.erase(task_id);
+        }
+
+        bool contains(uint64_t task_id) const noexcept {
+            return entries.contains(task_id);
+        }
+
+        size_t size() const noexcept {
+            return entries.size();
+        }
+
+        /**
+         * @brief 把缓存的响应追加到连接的发送缓冲区：首部拷贝一份并写入请求编号，报文体只增加引用计数。
+         */
+        static void enqueue(send_buffer &out, const shared_frame &frame, uint32_t request_id) {
+            titp_header_t header(titp_msg_type_t::RESOURCE_SENT, 0);
+            std::memcpy(&header, frame->data(), sizeof(header));
+            header.request_id = htonl(request_id);
+            out.append_shared(frame, &header, sizeof(header));
+        }
+};
\ No newline at end of file
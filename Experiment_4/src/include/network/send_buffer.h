@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/**
+ * @brief 编码一次、由多个连接按引用计数共享的只读报文（网络字节序）。
+ */
+using shared_frame = std::shared_ptr<const std::vector<std::byte>>;
+
+/**
+ * @brief 将报文编码为共享报文，报文类型需要提供 wire_size() 与 encode()。
+ */
+template<typename Packet>
+shared_frame encode_shared(const Packet &packet) {
+    auto bytes = std::make_shared<std::vector<std::byte>>(packet.wire_size());
+    packet.encode(bytes->data());
+    return bytes;
+}
+
+// flush() 的返回状态
+enum class flush_status_t : uint8_t {
+    DRAINED,        // 缓冲区中的数据已全部写入内核
+    WOULD_BLOCK,    // 内核发送缓冲区已满，剩余数据等待连接可写后继续写
+    ERROR           // 写入出错，连接应当被关闭
+};
+
+/**
+ * @brief 每个连接独占的发送缓冲区，由若干内存块组成。
+ * 报文直接编码进尾部内存块，多个报文积累后通过一次 sendmsg 以 scatter/gather 的方式写出；
+ * 短写时记录已写位置，下次从中断处继续，不会重复发送已经写出的字节。
+ * 共享报文只记录引用而不拷贝，可以附带一段按连接改写的首部（如请求编号），写出时用 iovec 拼接。
+ *
+ */
+class send_buffer{
+
+        private:
+        // 共享报文前可以替换的首部长度上限
+        static constexpr size_t MAX_PREFIX = 32;
+
+        // 自有内存块，或者一段共享报文：其前 prefix_len 字节以 prefix 代替，
+        // 两种情况下 begin/end 都是逻辑字节流中的位置。
+        struct block {
+            std::unique_ptr<std::byte[]> data;      // 自有内存，共享报文时为空
+            shared_frame shared;
+            size_t capacity;
+            size_t begin;       // 第一个未发送的字节
+            size_t end;         // 第一个空闲字节
+            size_t prefix_len;
+            std::byte prefix[MAX_PREFIX];
+
+            // 逻辑位置 [begin, end) 对应的内存，共享报文最多拆成两段
+            int segments(iovec *iov) const noexcept {
+                if (!shared) {
+                    iov[0].iov_base = data.get() + begin;
+                    iov[0].iov_len = end - begin;
+                    return 1;
+                }
+                int count = 0;
+                if (begin < prefix_len) {
+                    iov[count].iov_base = const_cast<std::byte*>(prefix + begin);
+                    iov[count].iov_len = prefix_len - begin;
+                    ++count;
+                }
+                size_t body = std::max(begin, prefix_len);
+                if (body < end) {
+                    iov[count].iov_base = const_cast<std::byte*>(shared->data() + body);
+                    iov[count].iov_len = end - body;
+                    ++count;
+                }
+                return count;
+            }
+        };
+
+        // 单次 sendmsg 最多携带的 iovec 数量
+        static constexpr int MAX_IOV = 64;
+
+        std::deque<block> blocks;
+        size_t block_size;
+        size_t buffered;
+
+        public:
+        /**
+         * @param block_size 新建内存块的默认大小，编码单个大于该值的报文时按报文大小分配
+         */
+        explicit send_buffer(size_t block_size = 4096)
+        : block_size(block_size), buffered(0) {}
+
+        send_buffer(const send_buffer&) = delete;
+        send_buffer& operator=(const send_buffer&) = delete;
+        send_buffer(send_buffer&&) noexcept = default;
+        send_buffer& operator=(send_buffer&&) noexcept = default;
+
+        /**
+         * @brief 尚未写入内核的字节数。
+         */
+        size_t size() const noexcept {
+            return buffered;
+        }
+
+        bool empty() const noexcept {
+            return buffered == 0;
+        }
+
+        /**
+         * @brief 在尾部取得至少 n 字节的连续空间，写入后调用 commit(n) 确认。
+         */
+        std::byte *prepare(size_t n) {
+            if (blocks.empty() || blocks.back().shared || blocks.back().capacity - blocks.back().end < n) {
+                size_t capacity = std::max(n, block_size);
+                blocks.push_back(block{std::make_unique<std::byte[]>(capacity), nullptr, capacity, 0, 0, 0, {}});
+            }
+            block &tail = blocks.back();
+            return tail.data.get() + tail.end;
+        }
+
+        void commit(size_t n) noexcept {
+            blocks.back().end += n;
+            buffered += n;
+        }
+
+        void append(const void *data, size_t n) {
+            std::memcpy(prepare(n), data, n);
+            commit(n);
+        }
+
+        /**
+         * @brief 将报文直接以网络字节序编码到缓冲区尾部，报文类型需要提供 wire_size() 与 encode()。
+         */
+        template<typename Packet>
+        void encode(const Packet &packet) {
+            size_t n = packet.wire_size();
+            packet.encode(prepare(n));
+            commit(n);
+        }
+
+        /**
+         * @brief 追加一个共享报文，只增加引用计数而不拷贝报文内容。
+         *
+         * @param frame 共享报文
+         * @param header 非空时代替报文开头的 header_len 字节写出，用于按连接改写首部字段
+         * @param header_len 不超过 MAX_PREFIX 与报文长度
+         */
+        void append_shared(shared_frame frame, const void *header = nullptr, size_t header_len = 0) {
+            size_t size = frame->size();
+            if (size == 0) return;
+
+            block b{nullptr, std::move(frame), size, 0, size, 0, {}};
+            if (header && header_len > 0) {
+                b.prefix_len = std::min({header_len, MAX_PREFIX, size});
+                std::memcpy(b.prefix, header, b.prefix_len);
+            }
+            blocks.push_back(std::move(b));
+            buffered += size;
+        }
+
+        /**
+         * @brief 丢弃头部已经写入内核的 n 字节。
+         */
+        void consume(size_t n) noexcept {
+            buffered -= n;
+            while (n > 0) {
+                block &head = blocks.front();
+                size_t step = std::min(n, head.end - head.begin);
+                head.begin += step;
+                n -= step;
+                if (head.begin == head.end) release_head();
+            }
+        }
+
+        /**
+         * @brief 从头部整块取出未发送的数据，交给需要自行持有缓冲区直到发送完成的后端（io_uring）：
+         * 自有内存块整体转移，共享报文只转移引用，不拷贝报文内容。取出的数据最多对应 max_segments 个 iovec，
+         * 剩余部分留在缓冲区中，由调用者继续取出。
+         */
+        send_buffer take_front(size_t max_segments) {
+            send_buffer out(block_size);
+            size_t used = 0;
+            while (!blocks.empty()) {
+                block &head = blocks.front();
+                size_t n = head.end - head.begin;
+                if (n > 0) {
+                    iovec iov[2];
+                    size_t count = static_cast<size_t>(head.segments(iov));
+                    if (used > 0 && used + count > max_segments) break;
+                    used += count;
+                    buffered -= n;
+                    out.buffered += n;
+                    out.blocks.push_back(std::move(head));
+                }
+                blocks.pop_front();
+            }
+            return out;
+        }
+
+        /**
+         * @brief 以 iovec 描述全部未发送的数据，追加到 iov 末尾。iovec 在缓冲区被修改或销毁之前有效。
+         */
+        void segments(std::vector<iovec> &iov) const {
+            for (const block &b : blocks) {
+                if (b.begin == b.end) continue;
+                iovec parts[2];
+                int count = b.segments(parts);
+                iov.insert(iov.end(), parts, parts + count);
+            }
+        }
+
+        /**
+         * @brief 通过 sendmsg 把缓冲区写入 fd，每次系统调用覆盖多个内存块，直到写完或内核缓冲区已满。
+         */
+        flush_status_t flush(int fd) {
+            while (buffered > 0) {
+                iovec iov[MAX_IOV];
+                int iovcnt = 0;
+                for (auto it = blocks.begin(); it != blocks.end() && iovcnt + 2 <= MAX_IOV; ++it) {
+                    if (it->begin == it->end) continue;
+                    iovcnt += it->segments(iov + iovcnt);
+                }
+
+                msghdr msg{};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = static_cast<size_t>(iovcnt);
+
+                ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+                if (n > 0) {
+                    consume(static_cast<size_t>(n));
+                    continue;
+                }
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return flush_status_t::WOULD_BLOCK;
+                return flush_status_t::ERROR;
+            }
+            return flush_status_t::DRAINED;
+        }
+
+        private:
+        // 写空的内存块：默认大小的最后一块留作复用，其余直接释放，避免空闲连接长期占用大块内存。
+        void release_head() noexcept {
+            if (blocks.size() == 1 && !blocks.front().shared && blocks.front().capacity == block_size) {
+                blocks.front().begin = 0;
+                blocks.front().end = 0;
+                return;
+            }
+            blocks.pop_front();
+        }
+};
\ No newline at end of file
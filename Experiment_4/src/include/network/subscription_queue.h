@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <netinet/in.h>
+#include "send_buffer.h"
+#include "../protocols/TITP.h"
+
+// 每个订阅者最多积压的任务数（合并后），超过后清空队列并通知客户端重新拉取
+constexpr size_t SUBSCRIPTION_QUEUE_LIMIT = 1024;
+
+/**
+ * @brief 单个订阅者尚未写出的任务事件，按任务 ID 合并：同一任务的多次修改只保留最新的一帧，
+ * 并沿用第一次入队的位置。订阅者还没收到的新任务（TASK_POSTED）又被修改时仍然以 TASK_POSTED 送达，
+ * 正文取修改后的名称；在送达之前又被删除时两条事件一起取消。
+ * 队列有上限，溢出时丢弃全部积压并记下标志，由调用者改为发送一条 EVENTS_LOST。
+ * 事件报文是所有订阅者共享的只读报文，入队只增加引用计数。
+ *
+ */
+class subscription_queue{
+
+        private:
+        struct pending_event {
+            uint64_t sequence;          // 入队时的序号，用于识别 order 中已经失效的位置
+            titp_notice_kind_t kind;    // 送达时的种类，可能与 frame 中的不同
+            shared_frame frame;
+        };
+
+        // 通知报文中 kind 字段之前的字节数，改写种类时以此为首部长度
+        static constexpr size_t KIND_OFFSET = sizeof(titp_header_t) + offsetof(titp_notice_payload_t, kind);
+
+        std::deque<std::pair<uint64_t, uint64_t>> order;        // (任务 ID, 序号)，按首次入队的顺序
+        std::unordered_map<uint64_t, pending_event> pending;
+        size_t limit;
+        uint64_t next_sequence;
+        bool overflowed;
+
+        // 取消的事件在 order 中留下失效的位置，数量过多时整体清理一次
+        void compact() {
+            std::deque<std::pair<uint64_t, uint64_t>> live;
+            for (const auto &[task_id, sequence] : order) {
+                auto it = pending.find(task_id);
+                if (it != pending.end() && it->second.sequence == sequence) live.emplace_back(task_id, sequence);
+            }
+            order.swap(live);
+        }
+
+        public:
+        explicit subscription_queue(size_t limit = SUBSCRIPTION_QUEUE_LIMIT)
+        : limit(limit), next_sequence(0), overflowed(false) {}
+
+        /**
+         * @brief 加入一个任务事件。
+         *
+         * @return bool 队列溢出、积压被丢弃时返回 false
+         */
+        bool push(uint64_t task_id, titp_notice_kind_t kind, shared_frame frame) {
+            auto it = pending.find(task_id);
+            if (it != pending.end()) {
+                bool posted = it->second.kind == titp_notice_kind_t::TASK_POSTED;
+                if (posted && kind == titp_notice_kind_t::TASK_DELETED) {
+                    pending.erase(it);
+                } else {
+                    if (!posted || kind != titp_notice_kind_t::TASK_UPDATED) it->second.kind = kind;
+                    it->second.frame = std::move(frame);
+                }
+                return true;
+            }
+
+            if (pending.size() >= limit) {
+                clear();
+                overflowed = true;
+                return false;
+            }
+
+            if (order.size() >= 2 * limit) compact();
+            pending.emplace(task_id, pending_event{next_sequence, kind, std::move(frame)});
+            order.emplace_back(task_id, next_sequence++);
+            return true;
+        }
+
+        /**
+         * @brief 取出最早的一帧追加到 out。合并后种类与报文不同时，只以按连接的首部改写 kind 字段，
+         * 报文本身仍然共享。
+         *
+         * @return bool 队列为空时返回 false
+         */
+        bool pop(send_buffer &out) {
+            while (!order.empty()) {
+                auto [task_id, sequence] = order.front();
+                order.pop_front();
+
+                auto it = pending.find(task_id);
+                if (it == pending.end() || it->second.sequence != sequence) continue;
+                pending_event event = std::move(it->second);
+                pending.erase(it);
+
+                std::byte header[KIND_OFFSET + sizeof(uint16_t)];
+                uint16_t kind = htons(static_cast<uint16_t>(event.kind));
+                if (event.frame->size() >= sizeof(header) &&
+                    std::memcmp(event.frame->data() + KIND_OFFSET, &kind, sizeof(kind)) != 0) {
+                    std::memcpy(header, event.frame->data(), KIND_OFFSET);
+                    std::memcpy(header + KIND_OFFSET, &kind, sizeof(kind));
+                    out.append_shared(std::move(event.frame), header, sizeof(header));
+                } else {
+                    out.append_shared(std::move(event.frame));
+                }
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief 自上次调用以来是否发生过溢出，调用后清除标志。
+         */
+        bool take_overflow() noexcept {
+            bool result = overflowed;
+            overflowed = false;
+            return result;
+        }
+
+        bool empty() const noexcept {
+            return pending.empty() && !overflowed;
+        }
+
+        size_t size() const noexcept {
+            return pending.size();
+        }
+
+        void clear() noexcept {
+            order.clear();
+            pending.clear();
+            overflowed = false;
+        }
+};
\ No newline at end of file
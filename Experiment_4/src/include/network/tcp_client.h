@@ -10,7 +10,13 @@
 #include <cstring>
 #include "../protocols/PIAP.h"
 #include "../protocols/TITP.h"
+#include "event_loop.h"
+#include "tcp_connection.h"
+#include <fcntl.h>
+#include <poll.h>
 #include <memory>
+#include <deque>
+#include <unordered_map>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -27,10 +33,25 @@ class tcp_client{
         std::string server_ip;
         struct sockaddr_in server_addr;
         bool is_connected;
+        event_loop *loop;                               // 调用 attach_loop() 后非空
+        std::unique_ptr<tcp_connection> connection;     // 异步接口使用的接收缓冲区与挂起状态
+        uint32_t next_request_id;
+        std::unordered_map<uint32_t, std::deque<std::unique_ptr<titp_t>>> early_responses;   // 先于等待者到达的响应
+        std::deque<std::unique_ptr<titp_t>> notices;    // 服务器主动推送、尚未取走的 NOTICE
+        bool forced_logout;                             // 收到了服务器的 FORCE_LOGOUT
+
+        void require_async() const {
+            if (!connection) {
+                throw
+                std::runtime_error(std::string("Error: Client ") + std::to_string(client_fd) +
+                                   std::string(" is not attached to an event loop."));
+            }
+        }
 
         public:
         explicit tcp_client(int port, const std::string& server_ip)
-        : client_fd(-1), port(port), server_ip(server_ip), is_connected(false) {
+        : client_fd(-1), port(port), server_ip(server_ip), is_connected(false), loop(nullptr), next_request_id(1),
+          forced_logout(false) {
             std::memset(&server_addr, 0, sizeof(sockaddr_in));
             connect_server();
         }
@@ -79,6 +100,7 @@ class tcp_client{
             }
 
             is_connected = true;
+            forced_logout = false;
             return true;
         }
 
@@ -90,18 +112,8 @@ class tcp_client{
             }
 
             auto buffer = packet->serialize();
-            size_t packet_size = buffer.size();
-            const void *buf = buffer.data();
-
-            ssize_t sent_size;
-            do {
-                sent_size = send(client_fd, buf, packet_size, 0);
-            } while (sent_size < 0 && errno == EINTR);
-
-            // TODO: 如果后续需要引入日志系统来管理，这边需要拆分并修改。
-            if (sent_size < 0 || sent_size != static_cast<ssize_t>(packet_size)) return false;
-
-            return true;
+            // 短写时从已写位置继续；失败时报文可能只写出了一部分，不能整包重发
+            return send_all(client_fd, buffer.data(), buffer.size());
         }
 
         std::unique_ptr<piap_t> recv_ctrl_packet() const {
@@ -111,11 +123,21 @@ class tcp_client{
                                    std::string(" have not connected server yet."));
             }
 
-            std::vector <std::byte> buf(PIAP_TOTAL_SIZE);
-            ssize_t recv_size = recv(client_fd, buf.data(), PIAP_TOTAL_SIZE, MSG_WAITALL);
+            // 先接收首部，按版本确定报文长度后再接收载荷
+            piap_header_t header(0, 0);
+            ssize_t recv_size = recv(client_fd, &header, sizeof(piap_header_t), MSG_WAITALL);
+            if (recv_size != static_cast<ssize_t>(sizeof(piap_header_t))) return nullptr;
+
+            size_t total_size = piap_frame_size(header.version, header.payload_length);
+            if (total_size == 0) return nullptr;
+
+            std::vector <std::byte> buf(total_size);
+            std::memcpy(buf.data(), &header, sizeof(piap_header_t));
+            size_t payload_size = total_size - sizeof(piap_header_t);
+            recv_size = recv(client_fd, buf.data() + sizeof(piap_header_t), payload_size, MSG_WAITALL);
 
             // TODO: 如果后续引入日志系统，则需要拆分并修改。
-            if (recv_size <= 0 || recv_size != static_cast<ssize_t>(PIAP_TOTAL_SIZE)) return nullptr;
+            if (recv_size < 0 || recv_size != static_cast<ssize_t>(payload_size)) return nullptr;
 
             auto packet = piap_t::deserialize(buf.data(), buf.size());
             if (!packet) {
@@ -133,20 +155,15 @@ class tcp_client{
             }
 
             auto buffer = packet->serialize();
-            size_t packet_size = buffer.size();
-            const void *buf = buffer.data();
-
-            ssize_t sent_size;
-            do {
-                sent_size = send(client_fd, buf, packet_size, 0);
-            } while (sent_size < 0 && errno == EINTR);
-
-            if (sent_size < 0 || sent_size != static_cast<ssize_t>(packet_size)) return false;
-
-            return true;
+            // 短写时从已写位置继续；失败时报文可能只写出了一部分，不能整包重发
+            return send_all(client_fd, buffer.data(), buffer.size());
         }
 
-        std::unique_ptr<titp_t> recv_data_packet() const {
+        /**
+         * @brief 接收一个 TITP 报文。服务器可能在数据通道上推送 PIAP FORCE_LOGOUT，
+         * 此时记录下线标志并返回 nullptr，由 was_forced_logout() 区分于连接出错。
+         */
+        std::unique_ptr<titp_t> recv_data_packet() {
             if (!is_connected) {
                 throw
                 std::runtime_error(std::string("Error: Client ") + std::to_string(client_fd) +
@@ -165,7 +182,23 @@ class tcp_client{
             // 验证魔数和版本 (convert from network byte order)
             uint32_t magic = ntohl(header->magic);
             uint16_t version = ntohs(header->version);
-            if (magic != TITP_MAGIC || version != TITP_VERSION) return nullptr;
+            if (magic == PIAP_MAGIC) {
+                // 两种协议的首部长度相同，按 PIAP 的规则收完整个报文
+                static_assert(sizeof(piap_header_t) == sizeof(titp_header_t));
+                size_t total_size = piap_frame_size(header->version, header->payload_length);
+                if (total_size == 0) return nullptr;
+
+                std::vector <std::byte> buf(total_size);
+                std::memcpy(buf.data(), header_buffer, sizeof(piap_header_t));
+                size_t payload_size = total_size - sizeof(piap_header_t);
+                recv_size = recv(client_fd, buf.data() + sizeof(piap_header_t), payload_size, MSG_WAITALL);
+                if (recv_size < 0 || recv_size != static_cast<ssize_t>(payload_size)) return nullptr;
+
+                auto packet = piap_t::deserialize(buf.data(), buf.size());
+                if (packet && packet->get_msg_type() == piap_msg_type_t::FORCE_LOGOUT) forced_logout = true;
+                return nullptr;
+            }
+            if (magic != TITP_MAGIC || !titp_version_supported(version)) return nullptr;
 
             // 分配完整消息的缓冲区
             uint32_t payload_length = ntohl(header->payload_length);
@@ -182,7 +215,143 @@ class tcp_client{
             return packet;
         }
 
+        /**
+         * @brief 为 TITP 请求分配一个本连接内唯一的请求编号并写入报文头，跳过表示“不关联”的 0。
+         *
+         * @return uint32_t 分配的请求编号，之后用 recv_data_response() 取回对应的响应
+         */
+        uint32_t assign_request_id(const std::unique_ptr<titp_t>& packet) noexcept {
+            uint32_t id = next_request_id++;
+            if (next_request_id == 0) next_request_id = 1;
+            packet->set_request_id(id);
+            return id;
+        }
+
+        /**
+         * @brief 接收指定请求编号的响应。多个请求同时在途时响应可能乱序到达，
+         * 先到达的其他响应会被暂存，留给之后对应的调用取走。批量请求的多个响应共用一个编号，按到达顺序逐个返回。
+         * 期间收到的服务器推送（NOTICE）放入通知队列，由 take_notice() 取走。
+         *
+         * @return std::unique_ptr<titp_t> 对应的响应，连接出错时返回 nullptr
+         */
+        std::unique_ptr<titp_t> recv_data_response(uint32_t request_id) {
+            auto early = early_responses.find(request_id);
+            if (early != early_responses.end()) {
+                auto packet = std::move(early->second.front());
+                early->second.pop_front();
+                if (early->second.empty()) early_responses.erase(early);
+                return packet;
+            }
+
+            while (true) {
+                auto packet = recv_data_packet();
+                if (!packet) return nullptr;
+                if (packet->get_msg_type() == titp_msg_type_t::NOTICE) {
+                    notices.push_back(std::move(packet));
+                    continue;
+                }
+                if (packet->get_request_id() == request_id) return packet;
+                early_responses[packet->get_request_id()].push_back(std::move(packet));
+            }
+        }
+
+        /**
+         * @brief 不等待地收下已经到达的报文：通知放入通知队列，其他响应暂存给对应的 recv_data_response()。
+         * 订阅了任务事件的客户端在空闲时调用，以便及时显示推送。
+         *
+         * @return bool 连接是否仍然可用
+         */
+        bool collect_notices() {
+            pollfd pfd{client_fd, POLLIN, 0};
+            while (poll(&pfd, 1, 0) > 0) {
+                if (!(pfd.revents & POLLIN)) return false;
+                auto packet = recv_data_packet();
+                if (!packet) return false;
+                if (packet->get_msg_type() == titp_msg_type_t::NOTICE) {
+                    notices.push_back(std::move(packet));
+                } else {
+                    early_responses[packet->get_request_id()].push_back(std::move(packet));
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief 取出一条服务器推送的通知，没有时返回 nullptr。
+         */
+        std::unique_ptr<titp_t> take_notice() {
+            if (notices.empty()) return nullptr;
+            auto notice = std::move(notices.front());
+            notices.pop_front();
+            return notice;
+        }
+
+        /**
+         * @brief 连接是否因为服务器发送 FORCE_LOGOUT 而结束。
+         */
+        bool was_forced_logout() const noexcept {
+            return forced_logout;
+        }
+
+        /**
+         * @brief 将连接切换为非阻塞模式并注册到事件循环，之后可以在该循环的线程中使用 async_* 接口。
+         * 切换后不应再调用阻塞的 send/recv 接口，否则二者会争抢套接字中的数据。
+         *
+         * @return bool 注册是否成功
+         */
+        bool attach_loop(event_loop &target) {
+            if (!is_connected) {
+                throw
+                std::runtime_error(std::string("Error: Client ") + std::to_string(client_fd) +
+                                   std::string(" have not connected server yet."));
+            }
+
+            int flags = fcntl(client_fd, F_GETFL, 0);
+            if (flags < 0 || fcntl(client_fd, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+
+            connection = std::make_unique<tcp_connection>(client_fd);
+            bool registered = target.add_fd(client_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                                            [conn = connection.get()](uint32_t events) {
+                                                conn->notify(events);
+                                            });
+            if (!registered) {
+                connection.reset();
+                return false;
+            }
+            loop = &target;
+            return true;
+        }
+
+        send_awaitable async_send_ctrl_packet(const std::unique_ptr<piap_t>& packet) const {
+            require_async();
+            connection->send_buf.encode(*packet);
+            return connection->async_flush();
+        }
+
+        ctrl_packet_awaitable async_recv_ctrl_packet() const {
+            require_async();
+            return ctrl_packet_awaitable(*connection);
+        }
+
+        send_awaitable async_send_data_packet(const std::unique_ptr<titp_t>& packet) const {
+            require_async();
+            connection->send_buf.encode(*packet);
+            return connection->async_flush();
+        }
+
+        data_packet_awaitable async_recv_data_packet() const {
+            require_async();
+            return data_packet_awaitable(*connection);
+        }
+
         bool disconnect() noexcept {
+            if (loop) {
+                loop->remove_fd(client_fd);
+                loop = nullptr;
+            }
+            connection.reset();
+            early_responses.clear();
+            notices.clear();
             if (client_fd >= 0) {
                 close(client_fd);
                 client_fd = -1;
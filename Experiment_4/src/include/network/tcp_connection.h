@@ -0,0 +1,502 @@
+#pragma once
+
+#include <cerrno>
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "recv_buffer.h"
+#include "frame_decoder.h"
+#include "send_buffer.h"
+#include "timer_wheel.h"
+#include "uring_transport.h"
+#include "../protocols/PIAP.h"
+#include "../protocols/TITP.h"
+
+// read_available 的返回状态
+enum class recv_status_t : uint8_t {
+    DRAINED,        // 内核缓冲区已读空
+    BUFFER_FULL,    // 接收缓冲区已满且无法扩容，处理后需要继续读取
+    PEER_CLOSED,    // 对端关闭了连接
+    ERROR           // 读取出错
+};
+
+/**
+ * @brief 非阻塞地读取 fd 中当前可读的全部数据到接收缓冲区，直到内核返回 EAGAIN。
+ * 边缘触发模式下必须一次读空，否则剩余数据不会再次触发就绪事件；
+ * 每次 readv 都填满缓冲区的全部空闲区域，缓冲区写满时先尝试扩容。
+ *
+ * @return recv_status_t 读取结束的原因，BUFFER_FULL 时调用者应当先处理数据再次调用。
+ */
+inline recv_status_t read_available(int fd, recv_buffer &buf) {
+    while (true) {
+        if (buf.writable() == 0 && !buf.grow()) {
+            return recv_status_t::BUFFER_FULL;
+        }
+
+        iovec iov[2];
+        int iovcnt = buf.writable_segments(iov);
+
+        ssize_t n;
+        do {
+            n = readv(fd, iov, iovcnt);
+        } while (n < 0 && errno == EINTR);
+
+        if (n > 0) {
+            buf.commit(static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            return recv_status_t::PEER_CLOSED;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return recv_status_t::DRAINED;
+        }
+        return recv_status_t::ERROR;
+    }
+}
+
+/**
+ * @brief 阻塞地写出整段数据：短写时从已写位置继续，非阻塞套接字上等待可写后继续。
+ * 失败时报文可能已经写出了一部分，字节流不再完整，调用者不能重发该报文，只能断开连接。
+ */
+inline bool send_all(int fd, const void *data, size_t size) {
+    const std::byte *ptr = static_cast<const std::byte*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, ptr, size, MSG_NOSIGNAL);
+        if (n > 0) {
+            ptr += n;
+            size -= static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd{fd, POLLOUT, 0};
+            if (poll(&pfd, 1, -1) < 0 && errno != EINTR) return false;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// 未写出的响应超过低水位时立即尝试写出，否则等到协程下一次等待报文之前再统一写出
+constexpr size_t SEND_LOW_WATERMARK = 64 * 1024;
+// 未写出的响应超过高水位时挂起发送方，并停止读取该连接，直到积压回落到低水位以下
+constexpr size_t SEND_HIGH_WATERMARK = 256 * 1024;
+// io_uring 暂停接收后、取消生效前仍可能送达的数据上限，与 provided buffer 的总量相当
+constexpr size_t RECV_BACKLOG_LIMIT = 4 * 1024 * 1024;
+
+// 向连接投递共享报文（如广播）时，积压已超过高水位的处理方式
+enum class overflow_policy_t : uint8_t {
+    DROP,           // 丢弃这一帧，连接照常工作，适合可以丢失的通知
+    DISCONNECT,     // 断开连接：对端长期不读取，继续为它保留数据只会占用内存
+    FORCE           // 无论积压多少都投递，如随后就会关闭连接的 FORCE_LOGOUT
+};
+
+enum class offer_result_t : uint8_t {
+    QUEUED,         // 已排入发送缓冲区
+    DROPPED,        // 按策略丢弃，或连接已经不可用
+    DISCONNECTED    // 按策略断开了连接
+};
+
+class tcp_connection;
+
+/**
+ * @brief 等待下一个完整报文的 awaitable。
+ * 缓冲区中已有完整报文时不会挂起；否则挂起到连接上，由 tcp_connection::notify() 在数据到达后继续切分，
+ * 直到取出报文或连接关闭才恢复协程。整个过程不分配协程帧。
+ */
+class frame_awaitable{
+
+        protected:
+        tcp_connection &conn;
+        frame_t frame;
+        bool has_frame;
+        std::coroutine_handle<> waiting;
+
+        friend class tcp_connection;
+
+        public:
+        explicit frame_awaitable(tcp_connection &connection) noexcept
+        : conn(connection), frame{}, has_frame(false) {}
+
+        /**
+         * @brief 尝试取出报文。返回 true 表示可以恢复协程（取到报文或连接已不可用）。
+         */
+        bool poll();
+
+        bool await_ready() {
+            return poll();
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept;
+
+        std::optional<frame_t> await_resume() const noexcept {
+            if (!has_frame) return std::nullopt;
+            return frame;
+        }
+};
+
+// 等待下一个报文并按 PIAP 反序列化，报文不是 PIAP 或连接关闭时得到 nullptr
+class ctrl_packet_awaitable : public frame_awaitable{
+
+        public:
+        using frame_awaitable::frame_awaitable;
+
+        std::unique_ptr<piap_t> await_resume() const {
+            if (!has_frame || frame.kind != frame_kind_t::PIAP) return nullptr;
+            return piap_t::deserialize(frame.data, frame.size);
+        }
+};
+
+// 等待下一个报文并按 TITP 反序列化，报文不是 TITP 或连接关闭时得到 nullptr
+class data_packet_awaitable : public frame_awaitable{
+
+        public:
+        using frame_awaitable::frame_awaitable;
+
+        std::unique_ptr<titp_t> await_resume() const {
+            if (!has_frame || frame.kind != frame_kind_t::TITP) return nullptr;
+            return titp_t::deserialize(frame.data, frame.size);
+        }
+};
+
+/**
+ * @brief 等待发送积压回落的 awaitable。报文已经编码进连接的 send_buf，
+ * 未写出的数据不超过 high 时不会挂起；否则挂起发送方并暂停读取该连接，
+ * 连接可写后从中断处继续写，直到积压不超过 low 才恢复，避免在水位附近反复挂起与恢复。
+ */
+class send_awaitable{
+
+        private:
+        tcp_connection &conn;
+        size_t low;
+        size_t high;
+        bool ok;
+        bool suspended;
+        std::coroutine_handle<> waiting;
+
+        friend class tcp_connection;
+
+        public:
+        send_awaitable(tcp_connection &connection, size_t low, size_t high) noexcept
+        : conn(connection), low(low), high(high), ok(false), suspended(false) {}
+
+        bool poll();
+
+        bool await_ready() {
+            return poll();
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept;
+
+        bool await_resume() const noexcept {
+            return ok;
+        }
+};
+
+/**
+ * @brief 一条非阻塞 TCP 连接的收发状态：接收缓冲区、报文切分器、发送缓冲区以及挂起在该连接上的协程。
+ * epoll 后端在就绪时调用 notify()，由挂起的 awaitable 自己读取数据；
+ * io_uring 后端先把数据 append 到 recv_buf，再调用 notify()。
+ * 响应先编码进 send_buf，协程等待下一个报文之前统一写出，流水线上的多个响应只需要一次 sendmsg。
+ * 积压超过高水位时协程挂起在发送上，不再读取新的请求，慢速的对端不会让服务器无限制地缓存响应。
+ * 同一时刻一条连接上最多挂起一个接收和一个发送。
+ * 提供时间轮时连接可以设置两种超时，到期后以 timed_out 标志关闭连接：
+ * 空闲超时从最近一次收到完整报文开始计时，到期时才检查是否真的空闲，收到报文只更新一个时间戳；
+ * 接收超时只在协程带着半个报文挂起时计时，对端必须在期限内把这个报文发完。
+ *
+ */
+class tcp_connection{
+
+        public:
+        int fd;
+        uring_transport *uring;     // 非空时数据由 io_uring 写入 recv_buf，awaitable 不自行读取套接字，发送也交给它
+        bool peer_closed;
+        bool malformed;             // 收到无法识别的报文，连接应当被关闭
+        bool write_failed;          // 写出发送缓冲区时出错，连接应当被关闭
+        bool close_requested;       // 上层要求关闭连接，挂起的协程会被唤醒并以连接关闭的结果返回
+        bool timed_out;             // 因空闲或接收超时被关闭
+        recv_buffer recv_buf;
+        frame_decoder decoder;
+        send_buffer send_buf;
+        std::function<void()> on_writable;      // 非空时，发送积压回落到低水位以下后调用，用于继续投递排队中的推送
+
+        private:
+        std::vector<std::byte> recv_backlog;    // 接收缓冲区已满时暂存外部后端送来的数据
+        size_t backlog_head;
+        frame_awaitable *pending_recv;
+        send_awaitable *pending_send;
+
+        timer_wheel *timers;        // 为空时不启用超时
+        timer_node idle_timer;
+        timer_node receive_timer;
+        uint64_t idle_timeout_ms;
+        uint64_t receive_timeout_ms;
+        uint64_t last_activity_ms;
+
+        friend class frame_awaitable;
+        friend class send_awaitable;
+
+        void expire() {
+            timed_out = true;
+            request_close();
+        }
+
+        // 取到一个完整报文：记下活动时间，正在计时的接收超时随之结束
+        void on_frame() noexcept {
+            if (!timers) return;
+            last_activity_ms = timers->now_ms();
+            receive_timer.cancel();
+        }
+
+        // 协程即将挂起等待数据：缓冲区里留有半个报文时开始接收计时，已经在计时的不重新计时
+        void on_recv_suspend() noexcept {
+            if (!timers || receive_timeout_ms == 0 || receive_timer.armed()) return;
+            if (recv_buf.readable() > 0) timers->schedule(receive_timer, receive_timeout_ms);
+        }
+
+        public:
+        explicit tcp_connection(int client_fd, uring_transport *transport = nullptr, timer_wheel *wheel = nullptr)
+        : fd(client_fd), uring(transport), peer_closed(false), malformed(false), write_failed(false),
+          close_requested(false), timed_out(false),
+          backlog_head(0), pending_recv(nullptr), pending_send(nullptr),
+          timers(wheel), idle_timeout_ms(0), receive_timeout_ms(0), last_activity_ms(wheel ? wheel->now_ms() : 0) {
+
+            // 定时器的回调可能恢复协程并销毁连接，因此 expire() 必须是回调的最后一步
+            idle_timer.callback = [this]() {
+                uint64_t idle = timers->now_ms() - last_activity_ms;
+                if (idle >= idle_timeout_ms) {
+                    expire();
+                } else {
+                    timers->schedule(idle_timer, idle_timeout_ms - idle);
+                }
+            };
+            receive_timer.callback = [this]() {
+                expire();
+            };
+        }
+
+        tcp_connection(const tcp_connection &) = delete;
+        tcp_connection &operator=(const tcp_connection &) = delete;
+
+        /**
+         * @brief 设置空闲超时并从现在开始计时，0 表示不限制。需要构造时提供时间轮。
+         */
+        void set_idle_timeout(uint64_t timeout_ms) noexcept {
+            if (!timers) return;
+            idle_timeout_ms = timeout_ms;
+            last_activity_ms = timers->now_ms();
+            if (timeout_ms == 0) {
+                idle_timer.cancel();
+            } else {
+                timers->schedule(idle_timer, timeout_ms);
+            }
+        }
+
+        /**
+         * @brief 设置收完一个报文的期限，0 表示不限制。只影响之后开始的报文。
+         */
+        void set_receive_timeout(uint64_t timeout_ms) noexcept {
+            receive_timeout_ms = timeout_ms;
+            if (timeout_ms == 0) receive_timer.cancel();
+        }
+
+        frame_awaitable next_frame() noexcept {
+            return frame_awaitable(*this);
+        }
+
+        /**
+         * @brief 等待未写出的数据不超过 limit 字节，limit 为 0 时等待全部写出。
+         */
+        send_awaitable async_flush(size_t limit = 0) noexcept {
+            return send_awaitable(*this, limit, limit);
+        }
+
+        /**
+         * @brief 按高低水位等待发送积压回落，发送响应后调用。
+         */
+        send_awaitable async_drain() noexcept {
+            return send_awaitable(*this, SEND_LOW_WATERMARK, SEND_HIGH_WATERMARK);
+        }
+
+        /**
+         * @brief 尚未写入内核的字节数，包括已交给 io_uring 但尚未完成的发送。
+         */
+        size_t pending_output() const noexcept {
+            return send_buf.size() + (uring ? uring->pending_bytes(fd) : 0);
+        }
+
+        /**
+         * @brief 外部后端送来一段数据。接收缓冲区已满（通常是协程因发送积压暂停了处理）时先暂存，
+         * 协程恢复处理后由 refill() 移入接收缓冲区。
+         *
+         * @return bool 暂存的数据超过 RECV_BACKLOG_LIMIT 时返回 false，连接应当被关闭
+         */
+        bool feed(const std::byte *data, size_t n) {
+            if (recv_backlog.empty() && recv_buf.append(data, n)) return true;
+            recv_backlog.insert(recv_backlog.end(), data, data + n);
+            return recv_backlog.size() - backlog_head <= RECV_BACKLOG_LIMIT;
+        }
+
+        /**
+         * @brief 把暂存的数据尽量移入接收缓冲区。
+         *
+         * @return bool 是否移入了数据
+         */
+        bool refill() {
+            if (backlog_head == recv_backlog.size()) return false;
+            if (recv_buf.writable() == 0 && !recv_buf.grow()) return false;
+
+            size_t n = std::min(recv_buf.writable(), recv_backlog.size() - backlog_head);
+            recv_buf.append(recv_backlog.data() + backlog_head, n);
+            backlog_head += n;
+            if (backlog_head == recv_backlog.size()) {
+                // 积压只在慢速对端上短暂出现，消化完后归还内存
+                std::vector<std::byte>().swap(recv_backlog);
+                backlog_head = 0;
+            }
+            return true;
+        }
+
+        /**
+         * @brief 不挂起地写出发送缓冲区：epoll 后端写到内核缓冲区满为止，io_uring 后端整体提交到发送链。
+         *
+         * @return bool 连接是否仍可写
+         */
+        bool flush() {
+            if (write_failed) return false;
+            if (send_buf.empty()) return true;
+
+            if (uring) {
+                if (!uring->submit_send(fd, send_buf)) write_failed = true;
+            } else if (send_buf.flush(fd) == flush_status_t::ERROR) {
+                write_failed = true;
+            }
+            return !write_failed;
+        }
+
+        /**
+         * @brief 投递一个共享报文，只增加引用计数，随后立即尝试写出。
+         * 每个连接各自记录写出进度；积压超过高水位时按 policy 丢弃该帧或断开连接。
+         */
+        offer_result_t offer(const shared_frame &frame, overflow_policy_t policy) {
+            if (close_requested || write_failed || peer_closed) return offer_result_t::DROPPED;
+
+            if (policy != overflow_policy_t::FORCE && pending_output() + frame->size() > SEND_HIGH_WATERMARK) {
+                if (policy == overflow_policy_t::DROP) return offer_result_t::DROPPED;
+                request_close();
+                return offer_result_t::DISCONNECTED;
+            }
+
+            send_buf.append_shared(frame);
+            flush();
+            return offer_result_t::QUEUED;
+        }
+
+        /**
+         * @brief 要求关闭连接：唤醒挂起在连接上的协程，使其以连接关闭的结果返回。
+         * 协程恢复后连接可能已被销毁，调用后不能再访问该连接。
+         */
+        void request_close() {
+            close_requested = true;
+            notify(0);
+        }
+
+        /**
+         * @brief 连接上发生了事件（epoll 就绪掩码，或外部后端写入数据后传入 EPOLLIN）。
+         * 只有挂起的操作真正可以继续时才恢复协程；恢复后连接可能已被销毁，因此恢复是最后一步。
+         */
+        void notify(uint32_t events) {
+            std::coroutine_handle<> resume_recv;
+            std::coroutine_handle<> resume_send;
+
+            if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) || close_requested) {
+                if (pending_send) {
+                    if (pending_send->poll()) {
+                        resume_send = pending_send->waiting;
+                        pending_send = nullptr;
+                    }
+                } else {
+                    flush();
+                }
+                if (on_writable && !write_failed && !close_requested && pending_output() < SEND_LOW_WATERMARK) {
+                    on_writable();
+                }
+            }
+            if (pending_recv && ((events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) || write_failed || close_requested) &&
+                pending_recv->poll()) {
+                resume_recv = pending_recv->waiting;
+                pending_recv = nullptr;
+            }
+
+            if (resume_send) {
+                if (uring) uring->resume_recv(fd);
+                resume_send.resume();
+            }
+            else if (resume_recv) resume_recv.resume();
+        }
+};
+
+inline bool frame_awaitable::poll() {
+    bool drained = false;
+    while (true) {
+        if (conn.close_requested) return true;
+        decode_status_t status = conn.decoder.next(conn.recv_buf, frame);
+        if (status == decode_status_t::FRAME_READY) {
+            conn.on_frame();
+            has_frame = true;
+            return true;
+        }
+        if (status == decode_status_t::BAD_FRAME) {
+            conn.malformed = true;
+            return true;
+        }
+        if (conn.peer_closed || conn.malformed || conn.write_failed) return true;
+        if (conn.uring || drained) {
+            if (conn.refill()) continue;
+            conn.on_recv_suspend();
+            // 即将挂起：之前处理的报文产生的响应在这里一次写出
+            return !conn.flush();
+        }
+
+        recv_status_t recv_status = read_available(conn.fd, conn.recv_buf);
+        if (recv_status == recv_status_t::DRAINED) {
+            drained = true;
+        } else if (recv_status != recv_status_t::BUFFER_FULL) {
+            conn.peer_closed = true;
+        }
+    }
+}
+
+inline void frame_awaitable::await_suspend(std::coroutine_handle<> h) noexcept {
+    waiting = h;
+    conn.pending_recv = this;
+}
+
+inline bool send_awaitable::poll() {
+    if (conn.send_buf.size() > low) conn.flush();
+    if (conn.write_failed || conn.close_requested) {
+        ok = false;
+        return true;
+    }
+    ok = conn.pending_output() <= (suspended ? low : high);
+    return ok;
+}
+
+inline void send_awaitable::await_suspend(std::coroutine_handle<> h) noexcept {
+    waiting = h;
+    suspended = true;
+    conn.pending_send = this;
+    // epoll 后端下协程挂起期间本就不会读取套接字；io_uring 的 multishot recv 需要显式暂停
+    if (conn.uring) conn.uring->pause_recv(conn.fd);
+}
\ No newline at end of file
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <coroutine>
 #include <cstdint>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 #include <string>
 #include <vector>
 #include <memory>
@@ -12,6 +15,61 @@
 #include <stdexcept>
 #include "../protocols/PIAP.h"
 #include "../protocols/TITP.h"
+#include "recv_buffer.h"
+#include "tcp_connection.h"
+#include "uring_transport.h"
+
+/**
+ * @brief 等待新连接的 awaitable。监听套接字必须是非阻塞的；没有待接受的连接时挂起，
+ * 由 tcp_server::notify_acceptable() 在监听套接字就绪后恢复。
+ */
+class accept_awaitable{
+
+        private:
+        int listen_fd;
+        accept_awaitable **slot;
+        bool wait_first;
+        int result;
+        std::coroutine_handle<> waiting;
+
+        friend class tcp_server;
+
+        public:
+        accept_awaitable(int fd, accept_awaitable **pending, bool wait_first) noexcept
+        : listen_fd(fd), slot(pending), wait_first(wait_first), result(-1) {}
+
+        /**
+         * @brief 尝试接受一个连接。返回 true 表示可以恢复协程（得到新连接或发生了 EAGAIN 以外的错误）。
+         */
+        bool poll() noexcept {
+            while (true) {
+                sockaddr_in client_addr;
+                socklen_t addr_len = sizeof(client_addr);
+                result = accept4(listen_fd, (sockaddr *) &client_addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (result >= 0) return true;
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+                result = -errno;
+                return true;
+            }
+        }
+
+        bool await_ready() noexcept {
+            return !wait_first && poll();
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            waiting = h;
+            *slot = this;
+        }
+
+        /**
+         * @return int 非阻塞的 client_fd，出错时为 -errno
+         */
+        int await_resume() const noexcept {
+            return result;
+        }
+};
 
 /**
  * @brief 基于 TCP 的类 HTTP 理念服务器类，用于管理服务器 TCP 管道的连接与终止以及二类数据包的发送。
@@ -25,15 +83,18 @@ class tcp_server{
         int port;
         sockaddr_in server_addr;
         bool is_running;
+        uring_transport *uring;     // 非空时收发与断开都交给 io_uring 后端
+        accept_awaitable *pending_accept;
 
         public:
         /**
          * @brief 初始化 TCP 服务器的同时开放服务器连接通道
          *
          * @param port 端口号，应当由客户端与服务器共同协商达成。
+         * @param reuse_port 为 true 时开启 SO_REUSEPORT，允许多个监听套接字绑定同一端口，由内核在它们之间分配新连接。
          */
-        explicit tcp_server(int port)
-        : server_fd(-1), port(port), is_running(false) {
+        explicit tcp_server(int port, bool reuse_port = false)
+        : server_fd(-1), port(port), is_running(false), uring(nullptr), pending_accept(nullptr) {
 
             server_fd = socket(AF_INET, SOCK_STREAM, 0);
             if (server_fd < 0) {
@@ -51,6 +112,14 @@ class tcp_server{
                 );
             }
 
+            if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+                int saved_errno = errno;
+                close(server_fd);
+                throw std::runtime_error(
+                std::string("Error: Failed to enable SO_REUSEPORT - ") + strerror(saved_errno)
+                );
+            }
+
             std::memset(&server_addr, 0, sizeof(server_addr));
             server_addr.sin_family = AF_INET;
             server_addr.sin_addr.s_addr = INADDR_ANY;
@@ -65,7 +134,8 @@ class tcp_server{
                 );
             }
 
-            if (listen(server_fd, 10) < 0) {
+            // 登录高峰时会有大量连接同时到达，积压队列交给内核上限决定。
+            if (listen(server_fd, SOMAXCONN) < 0) {
                 int saved_errno = errno;
                 close(server_fd);
                 server_fd = -1;
@@ -90,18 +160,16 @@ class tcp_server{
                 std::runtime_error("Error: Server is not running or invalid client file descriptor.");
             }
 
-            auto buffer = packet->serialize();
-            size_t packet_size = buffer.size();
-            const void *buf = buffer.data();
-
-            ssize_t sent_size;
-            do {
-                sent_size = send(client_fd, buf, packet_size, 0);
-            } while (sent_size < 0 && errno == EINTR);
+            if (uring) {
+                send_buffer out;
+                out.encode(*packet);
+                return uring->submit_send(client_fd, out);
+            }
 
-            if (sent_size < 0 || sent_size != static_cast<ssize_t>(packet_size)) return false;
+            auto buffer = packet->serialize();
 
-            return true;
+            // 短写时从已写位置继续；失败时报文可能只写出了一部分，不能整包重发
+            return send_all(client_fd, buffer.data(), buffer.size());
         }
 
         std::unique_ptr<piap_t> recv_ctrl_packet(int client_fd) const {
@@ -118,11 +186,24 @@ class tcp_server{
                 return nullptr;  // 不是 PIAP 包，不消费数据
             }
             
-            // 确认是 PIAP 包后再读取
-            std::vector<std::byte> buf(PIAP_TOTAL_SIZE);
-            ssize_t recv_size = recv(client_fd, buf.data(), PIAP_TOTAL_SIZE, MSG_WAITALL);
+            // 确认是 PIAP 包后再读取首部，按版本确定报文长度
+            piap_header_t header(0, 0);
+            ssize_t recv_size = recv(client_fd, &header, sizeof(piap_header_t), MSG_WAITALL);
+            if (recv_size != static_cast<ssize_t>(sizeof(piap_header_t))) {
+                return nullptr;
+            }
+
+            size_t total_size = piap_frame_size(header.version, header.payload_length);
+            if (total_size == 0) {
+                return nullptr;
+            }
+
+            std::vector<std::byte> buf(total_size);
+            std::memcpy(buf.data(), &header, sizeof(piap_header_t));
+            size_t payload_size = total_size - sizeof(piap_header_t);
+            recv_size = recv(client_fd, buf.data() + sizeof(piap_header_t), payload_size, MSG_WAITALL);
             
-            if (recv_size != static_cast<ssize_t>(PIAP_TOTAL_SIZE)) {
+            if (recv_size != static_cast<ssize_t>(payload_size)) {
                 return nullptr;
             }
             
@@ -135,18 +216,16 @@ class tcp_server{
                 std::runtime_error("Error: Server is not running or invalid client file descriptor.");
             }
 
-            auto buffer = packet->serialize();
-            size_t packet_size = buffer.size();
-            const void *buf = buffer.data();
-
-            ssize_t sent_size;
-            do {
-                sent_size = send(client_fd, buf, packet_size, 0);
-            } while (sent_size < 0 && errno == EINTR);
+            if (uring) {
+                send_buffer out;
+                out.encode(*packet);
+                return uring->submit_send(client_fd, out);
+            }
 
-            if (sent_size < 0 || sent_size != static_cast<ssize_t>(packet_size)) return false;
+            auto buffer = packet->serialize();
 
-            return true;
+            // 短写时从已写位置继续；失败时报文可能只写出了一部分，不能整包重发
+            return send_all(client_fd, buffer.data(), buffer.size());
         }
 
         std::unique_ptr<titp_t> recv_data_packet(int client_fd) const {
@@ -188,21 +267,111 @@ class tcp_server{
             return titp_t::deserialize(buffer.data(), buffer.size());
         }
         
+        /**
+         * @brief 非阻塞地读取 client_fd 中当前可读的全部数据到接收缓冲区，直到内核返回 EAGAIN。
+         *
+         * @return recv_status_t 读取结束的原因，BUFFER_FULL 时调用者应当先处理数据再次调用。
+         */
+        recv_status_t recv_available(int client_fd, recv_buffer& buf) const {
+            return read_available(client_fd, buf);
+        }
+
+        /**
+         * @brief 异步等待下一个新连接，需要事件循环在监听套接字就绪时调用 notify_acceptable()。
+         * io_uring 后端使用 multishot accept，不经过这里。
+         *
+         * @param wait_first 为 true 时先挂起到下一次就绪再尝试，用于 accept 出错（如 EMFILE）后避免空转。
+         */
+        accept_awaitable async_accept(bool wait_first = false) noexcept {
+            return accept_awaitable(server_fd, &pending_accept, wait_first);
+        }
+
+        /**
+         * @brief 监听套接字就绪时由事件循环调用，恢复挂起在 async_accept() 上的协程。
+         */
+        void notify_acceptable() {
+            if (!pending_accept || !pending_accept->poll()) return;
+
+            std::coroutine_handle<> h = pending_accept->waiting;
+            pending_accept = nullptr;
+            h.resume();
+        }
+
+        frame_awaitable async_recv_frame(tcp_connection& conn) const noexcept {
+            return frame_awaitable(conn);
+        }
+
+        ctrl_packet_awaitable async_recv_ctrl_packet(tcp_connection& conn) const noexcept {
+            return ctrl_packet_awaitable(conn);
+        }
+
+        data_packet_awaitable async_recv_data_packet(tcp_connection& conn) const noexcept {
+            return data_packet_awaitable(conn);
+        }
+
+        /**
+         * @brief 异步发送一段已序列化的数据，可以是多个报文拼接而成。
+         * 数据先追加到连接的发送缓冲区，积压不超过高水位时不挂起，由协程下一次等待报文前统一写出；
+         * 超过高水位时挂起，直到对端读走数据、积压回落到低水位以下。
+         */
+        send_awaitable async_send(tcp_connection& conn, const std::vector<std::byte>& buffer) const {
+            conn.send_buf.append(buffer.data(), buffer.size());
+            return conn.async_drain();
+        }
+
+        // 报文直接编码进连接的发送缓冲区，不经过中间的 std::vector
+        send_awaitable async_send_ctrl_packet(tcp_connection& conn, const std::unique_ptr<piap_t>& packet) const {
+            conn.send_buf.encode(*packet);
+            return conn.async_drain();
+        }
+
+        send_awaitable async_send_ctrl_packet(tcp_connection& conn, const piap_response_t& response) const {
+            conn.send_buf.encode(response);
+            return conn.async_drain();
+        }
+
+        send_awaitable async_send_data_packet(tcp_connection& conn, const std::unique_ptr<titp_t>& packet) const {
+            conn.send_buf.encode(*packet);
+            return conn.async_drain();
+        }
+
         /**
          * @brief 从信道中监听并获取到服务器的 client_fd 以建立 TCP 连接。
          *
+         * @param nonblocking 为 true 时返回的 client_fd 直接处于非阻塞模式，供事件循环使用。
          * @return int 通常情况下为 `client_fd`, 如果没有监听到则返回 -1.
          */
-        int accept_connection() noexcept {
+        int accept_connection(bool nonblocking = false) noexcept {
             struct sockaddr_in client_addr;
             socklen_t addr_len = sizeof(client_addr);
 
-            int fd = accept(server_fd, (struct sockaddr *) &client_addr, &addr_len);
+            int flags = SOCK_CLOEXEC | (nonblocking ? SOCK_NONBLOCK : 0);
+            int fd = accept4(server_fd, (struct sockaddr *) &client_addr, &addr_len, flags);
 
             return fd;
         }
 
+        /**
+         * @brief 切换到 io_uring 传输后端。之后 send_*_packet 只把报文排入该后端的发送队列，
+         * kick_client 也交由后端在内核交回缓冲区后释放连接；接收由后端的回调驱动。
+         */
+        void attach_uring(uring_transport *transport) noexcept {
+            uring = transport;
+        }
+
+        /**
+         * @brief 将文件描述符设置为非阻塞模式。
+         */
+        static bool set_nonblocking(int fd) noexcept {
+            int flags = fcntl(fd, F_GETFL, 0);
+            if (flags < 0) return false;
+            return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+        }
+
         bool kick_client(int client_fd) noexcept {
+            if (uring) {
+                return uring->close_fd(client_fd);
+            }
             if (client_fd >= 0) {
                 close(client_fd);
                 return true;
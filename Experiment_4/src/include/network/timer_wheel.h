@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <time.h>
+
+// 时间轮的层数与每层的槽数：4 层 64 槽，以 100ms 为一格时可以覆盖约 19 天
+constexpr size_t TIMER_WHEEL_LEVELS = 4;
+constexpr size_t TIMER_WHEEL_SLOT_BITS = 6;
+constexpr size_t TIMER_WHEEL_SLOTS = size_t{1} << TIMER_WHEEL_SLOT_BITS;
+// 事件循环时间轮的默认精度，连接超时以秒计，100ms 足够
+constexpr uint64_t TIMER_TICK_MS = 100;
+
+/**
+ * @brief 粗粒度时钟：每轮事件循环读取一次时间并缓存，处理报文时直接读缓存。
+ * 使用 CLOCK_*_COARSE，读取走 vDSO，不陷入内核，精度为一个调度周期（通常 1~4ms），用于超时与 TTL 检查足够。
+ */
+class coarse_clock{
+
+        private:
+        uint64_t monotonic_ms;
+        uint32_t unix_seconds;
+
+        public:
+        coarse_clock() noexcept {
+            update();
+        }
+
+        void update() noexcept {
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            monotonic_ms = static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            unix_seconds = static_cast<uint32_t>(ts.tv_sec);
+        }
+
+        // 单调时间，用于计算超时
+        uint64_t now_ms() const noexcept {
+            return monotonic_ms;
+        }
+
+        // 墙上时间（Unix 秒），用于校验报文时间戳
+        uint32_t unix_time() const noexcept {
+            return unix_seconds;
+        }
+};
+
+class timer_wheel;
+
+// 侵入式双向链表的节点，时间轮的每个槽是一个带哨兵的环形链表
+struct timer_link {
+    timer_link *prev = nullptr;
+    timer_link *next = nullptr;
+};
+
+/**
+ * @brief 挂在时间轮上的一个定时器，由使用者持有，时间轮不分配内存。
+ * 定时器只记录链表指针，取消时直接从所在的槽中摘下，不需要知道属于哪个时间轮；
+ * 析构时自动取消，因此持有者销毁时不需要额外清理。到期后定时器自动解除，需要周期触发时在回调中重新 schedule。
+ */
+class timer_node : private timer_link{
+
+        private:
+        uint64_t expires;
+
+        friend class timer_wheel;
+
+        public:
+        std::function<void()> callback;
+
+        timer_node() noexcept : expires(0) {}
+
+        explicit timer_node(std::function<void()> fn)
+        : expires(0), callback(std::move(fn)) {}
+
+        ~timer_node() noexcept {
+            cancel();
+        }
+
+        timer_node(const timer_node&) = delete;
+        timer_node& operator=(const timer_node&) = delete;
+
+        bool armed() const noexcept {
+            return prev != nullptr;
+        }
+
+        void cancel() noexcept {
+            if (!prev) return;
+            prev->next = next;
+            next->prev = prev;
+            prev = next = nullptr;
+        }
+};
+
+/**
+ * @brief 分层时间轮。第 0 层每格一个 tick，第 n 层每格 64^n 个 tick；
+ * 定时器按剩余时间放入能容纳它的最低一层，高层的槽在低层转完一圈时整体下放一层。
+ * 添加与取消都是 O(1) 的链表操作，每个定时器在到期前最多被下放 LEVELS-1 次。
+ * 不是线程安全的，只能在持有它的线程（或锁）下使用。
+ *
+ */
+class timer_wheel{
+
+        private:
+        timer_link slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+        uint64_t tick_ms;
+        uint64_t current;       // 已经处理到的 tick
+        uint64_t now;           // 最近一次 set_time 的时间（毫秒），新定时器从这里开始计时
+
+        static constexpr uint64_t SLOT_MASK = TIMER_WHEEL_SLOTS - 1;
+        static constexpr uint64_t MAX_DELTA = (uint64_t{1} << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+        static bool empty(const timer_link &head) noexcept {
+            return head.next == &head;
+        }
+
+        // 按到期时间相对 current 的距离选择所在的层与槽
+        void place(timer_node &node) noexcept {
+            if (node.expires < current) node.expires = current;
+            if (node.expires - current > MAX_DELTA) node.expires = current + MAX_DELTA;
+
+            uint64_t delta = node.expires - current;
+            size_t level = 0;
+            while (level + 1 < TIMER_WHEEL_LEVELS && delta >> (TIMER_WHEEL_SLOT_BITS * (level + 1)) != 0) ++level;
+
+            timer_link &head = slots[level][(node.expires >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK];
+            node.prev = head.prev;
+            node.next = &head;
+            head.prev->next = &node;
+            head.prev = &node;
+        }
+
+        // 把高层的一个槽下放：先整体摘到临时链表，重新放置时可能落回同一个槽（下一圈才到期）
+        void cascade(size_t level, size_t slot) noexcept {
+            timer_link &head = slots[level][slot];
+            if (empty(head)) return;
+
+            timer_link pending;
+            pending.next = head.next;
+            pending.prev = head.prev;
+            pending.next->prev = &pending;
+            pending.prev->next = &pending;
+            head.prev = head.next = &head;
+
+            while (!empty(pending)) {
+                timer_node &node = static_cast<timer_node&>(*pending.next);
+                node.cancel();
+                place(node);
+            }
+        }
+
+        public:
+        /**
+         * @param now_ms 当前时间，之后由 set_time() 推进
+         * @param tick 每格的毫秒数
+         */
+        explicit timer_wheel(uint64_t now_ms, uint64_t tick = TIMER_TICK_MS) noexcept
+        : tick_ms(tick > 0 ? tick : 1), current(now_ms / tick_ms), now(now_ms) {
+            for (auto &level : slots) {
+                for (auto &head : level) head.prev = head.next = &head;
+            }
+        }
+
+        ~timer_wheel() noexcept {
+            // 仍挂着的定时器可能比时间轮活得久，先把它们摘下，避免析构时访问已释放的槽
+            for (auto &level : slots) {
+                for (auto &head : level) {
+                    while (!empty(head)) static_cast<timer_node&>(*head.next).cancel();
+                }
+            }
+        }
+
+        timer_wheel(const timer_wheel&) = delete;
+        timer_wheel& operator=(const timer_wheel&) = delete;
+
+        /**
+         * @brief 推进当前时间，只影响之后 schedule 的起点，到期的定时器由 expire() 触发。
+         * 时间不会倒退：多个线程的粗粒度时钟可能相差几毫秒。
+         */
+        void set_time(uint64_t now_ms) noexcept {
+            if (now_ms > now) now = now_ms;
+        }
+
+        uint64_t now_ms() const noexcept {
+            return now;
+        }
+
+        /**
+         * @brief 在 delay_ms 之后触发定时器，已经挂着的定时器会被重新计时。至少延后一格。
+         */
+        void schedule(timer_node &node, uint64_t delay_ms) noexcept {
+            node.cancel();
+            uint64_t ticks = (delay_ms + tick_ms - 1) / tick_ms;
+            node.expires = now / tick_ms + (ticks > 0 ? ticks : 1);
+            place(node);
+        }
+
+        /**
+         * @brief 触发截至当前时间到期的全部定时器。回调可以重新 schedule 自己或取消其他定时器，
+         * 也可以销毁定时器的持有者：回调先复制一份再调用，之后不再访问定时器。
+         */
+        void expire() {
+            uint64_t target = now / tick_ms;
+            while (current < target) {
+                ++current;
+                // 高层先下放，下放到中间层的定时器可能正好落在紧接着要下放的槽里
+                for (size_t level = TIMER_WHEEL_LEVELS - 1; level > 0; --level) {
+                    uint64_t span_mask = (uint64_t{1} << (TIMER_WHEEL_SLOT_BITS * level)) - 1;
+                    if ((current & span_mask) == 0) {
+                        cascade(level, (current >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK);
+                    }
+                }
+
+                // 第 0 层的一个槽里只有恰好在这一格到期的定时器，回调新加的定时器至少在下一格
+                timer_link &head = slots[0][current & SLOT_MASK];
+                while (!empty(head)) {
+                    timer_node &node = static_cast<timer_node&>(*head.next);
+                    node.cancel();
+                    std::function<void()> callback = node.callback;
+                    if (callback) callback();
+                }
+            }
+        }
+
+        /**
+         * @brief 距离下一次需要调用 expire() 的毫秒数，没有定时器时返回 -1。
+         * 第 0 层之内的定时器给出准确的到期时间，更远的定时器只需要在下一次下放时醒来。
+         */
+        int next_timeout_ms() const noexcept {
+            uint64_t next_tick = 0;
+            for (uint64_t tick = current + 1; tick < current + TIMER_WHEEL_SLOTS; ++tick) {
+                if (!empty(slots[0][tick & SLOT_MASK])) {
+                    next_tick = tick;
+                    break;
+                }
+            }
+            if (next_tick == 0) {
+                bool pending = false;
+                for (size_t level = 1; level < TIMER_WHEEL_LEVELS && !pending; ++level) {
+                    for (const auto &head : slots[level]) {
+                        if (!empty(head)) {
+                            pending = true;
+                            break;
+                        }
+                    }
+                }
+                if (!pending) return -1;
+                next_tick = (current | SLOT_MASK) + 1;
+            }
+
+            uint64_t deadline = next_tick * tick_ms;
+            return deadline > now ? static_cast<int>(deadline - now) : 0;
+        }
+};
\ No newline at end of file
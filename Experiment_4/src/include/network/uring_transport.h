@@ -0,0 +1,634 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "send_buffer.h"
+
+/**
+ * @brief 基于 io_uring 的传输后端，直接使用系统调用而不依赖 liburing。
+ * - 监听套接字使用 multishot accept，一次提交持续产生新连接；
+ * - 接收使用 multishot recv 与 provided buffer ring，内核直接挑选空闲缓冲区写入数据；
+ * - 发送使用 IORING_OP_SENDMSG，发送缓冲区的内存块与共享报文以 iovec 直接交给内核，不拷贝报文内容；
+ *   同一连接在一轮中产生的多段发送以 IOSQE_IO_LINK 链接提交，保证按顺序写出；
+ * - 上层发送积压时可以暂停连接上的接收（取消 multishot recv），积压消化后再恢复。
+ *
+ * 提交队列只在 submit_pending() 中统一提交，通常由事件循环在每次等待前调用；
+ * 完成队列通过 io_uring 的文件描述符接入 epoll，可读时调用 process_completions()。
+ * 所有成员函数都只允许在拥有该实例的 Reactor 线程中调用。
+ *
+ */
+class uring_transport{
+
+        public:
+        // 新连接回调，参数为 client_fd，出错时为 -errno
+        using accept_handler_t = std::function<void(int client_fd)>;
+        // 数据回调，len > 0 为收到的数据；len == 0 表示对端关闭；len < 0 为 -errno
+        using recv_handler_t = std::function<void(const std::byte *data, ssize_t len)>;
+        // 发送完成回调，每完成一段发送调用一次，可通过 pending_bytes() 查询剩余积压
+        using send_handler_t = std::function<void()>;
+
+        private:
+        enum class op_t : uint8_t {
+            ACCEPT = 1,
+            RECV,
+            SEND,
+            CANCEL
+        };
+
+        static constexpr uint16_t BUFFER_GROUP_ID = 0;
+
+        // 一次 SENDMSG 携带的 iovec 上限（内核的 UIO_MAXIOV）
+        static constexpr size_t MAX_SEND_SEGMENTS = 1024;
+
+        // 一段交给内核的发送：持有内存块与共享报文的引用，iovec 与 msghdr 在内核完成前必须保持有效，
+        // 因此按指针保存，在队列之间移动时地址不变
+        struct outgoing {
+            send_buffer data;
+            std::vector<iovec> iov;
+            msghdr msg;
+            size_t size;
+        };
+
+        // 每个连接在 io_uring 中的状态。连接以 (generation, fd) 作为键，
+        // fd 被内核复用给新连接时，旧连接迟到的完成事件不会被误分发。
+        struct connection {
+            int fd;
+            recv_handler_t on_recv;
+            send_handler_t on_sent;
+            std::deque<std::unique_ptr<outgoing>> queued;   // 等待提交的响应
+            std::deque<std::unique_ptr<outgoing>> inflight; // 已提交、等待完成的响应，内核完成前不能释放
+            size_t pending_bytes;                           // queued 与 inflight 中尚未写出的字节数
+            bool recv_armed;
+            bool recv_paused;
+            bool closing;
+        };
+
+        int ring_fd;
+        io_uring_params params;
+
+        // 提交队列
+        void *sq_ptr;
+        size_t sq_ring_size;
+        uint32_t *sq_head;
+        uint32_t *sq_tail;
+        uint32_t sq_mask;
+        uint32_t sq_entries;
+        io_uring_sqe *sqes;
+        size_t sqes_size;
+        uint32_t sqe_tail;          // 本地已填写但尚未发布的尾指针
+        uint32_t sqe_published;     // 已发布给内核的尾指针
+
+        // 完成队列
+        void *cq_ptr;
+        size_t cq_ring_size;
+        uint32_t *cq_head;
+        uint32_t *cq_tail;
+        uint32_t cq_mask;
+        io_uring_cqe *cqes;
+
+        // provided buffer ring
+        io_uring_buf_ring *buf_ring;
+        io_uring_buf *buf_entries;
+        size_t buf_ring_size;
+        uint32_t buf_count;
+        uint32_t buf_size;
+        uint16_t buf_tail;
+        std::unique_ptr<std::byte[]> buf_storage;
+
+        int listen_fd;
+        accept_handler_t on_accept;
+
+        uint32_t next_generation;
+        std::unordered_map<int, uint32_t> live_generation;      // fd -> 当前连接的 generation
+        std::unordered_map<uint64_t, connection> connections;    // (generation << 32 | fd) -> 连接
+        std::vector<uint64_t> dirty;                             // 有待提交响应的连接
+
+        static uint64_t make_key(uint32_t generation, int fd) noexcept {
+            return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+        }
+
+        static uint64_t make_user_data(op_t op, uint64_t key) noexcept {
+            return (static_cast<uint64_t>(op) << 56) | (key & 0x00FFFFFFFFFFFFFFULL);
+        }
+
+        // 按 fd 找到当前存活的连接，已关闭或未注册时返回 nullptr
+        connection *find_live(int fd) {
+            auto gen = live_generation.find(fd);
+            if (gen == live_generation.end()) return nullptr;
+            auto it = connections.find(make_key(gen->second, fd));
+            if (it == connections.end() || it->second.closing) return nullptr;
+            return &it->second;
+        }
+
+        [[noreturn]] void fail(const char *what) {
+            int saved_errno = errno;
+            release();
+            throw std::runtime_error(std::string("Error: ") + what + " - " + strerror(saved_errno));
+        }
+
+        void release() noexcept {
+            if (buf_ring) munmap(buf_ring, buf_ring_size);
+            if (sqes) munmap(sqes, sqes_size);
+            if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_ring_size);
+            if (sq_ptr) munmap(sq_ptr, sq_ring_size);
+            if (ring_fd >= 0) close(ring_fd);
+            buf_ring = nullptr;
+            sqes = nullptr;
+            cq_ptr = nullptr;
+            sq_ptr = nullptr;
+            ring_fd = -1;
+        }
+
+        uint32_t sq_space() const noexcept {
+            uint32_t head = std::atomic_ref<uint32_t>(*sq_head).load(std::memory_order_acquire);
+            return sq_entries - (sqe_tail - head);
+        }
+
+        // 发布已填写的 SQE 并进入内核提交
+        void enter_pending() {
+            uint32_t to_submit = sqe_tail - sqe_published;
+            if (to_submit == 0) return;
+
+            std::atomic_ref<uint32_t>(*sq_tail).store(sqe_tail, std::memory_order_release);
+            sqe_published = sqe_tail;
+
+            int ret;
+            do {
+                ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0));
+            } while (ret < 0 && errno == EINTR);
+        }
+
+        /**
+         * @brief 取得一个空闲的 SQE，提交队列已满时先提交一次。
+         */
+        io_uring_sqe *get_sqe() {
+            if (sq_space() == 0) {
+                enter_pending();
+                if (sq_space() == 0) return nullptr;
+            }
+
+            io_uring_sqe *sqe = &sqes[sqe_tail & sq_mask];
+            std::memset(sqe, 0, sizeof(*sqe));
+            ++sqe_tail;
+            return sqe;
+        }
+
+        void recycle_buffer(uint16_t bid) noexcept {
+            io_uring_buf *buf = &buf_entries[buf_tail & (buf_count - 1)];
+            buf->addr = reinterpret_cast<uint64_t>(buf_storage.get() + static_cast<size_t>(bid) * buf_size);
+            buf->len = buf_size;
+            buf->bid = bid;
+            ++buf_tail;
+        }
+
+        void publish_buffers() noexcept {
+            std::atomic_ref<uint16_t>(buf_ring->tail).store(buf_tail, std::memory_order_release);
+        }
+
+        bool arm_accept() {
+            io_uring_sqe *sqe = get_sqe();
+            if (!sqe) return false;
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = listen_fd;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_CLOEXEC;
+            sqe->user_data = make_user_data(op_t::ACCEPT, 0);
+            return true;
+        }
+
+        bool arm_recv(uint64_t key, connection &conn) {
+            io_uring_sqe *sqe = get_sqe();
+            if (!sqe) return false;
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = conn.fd;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = BUFFER_GROUP_ID;
+            sqe->user_data = make_user_data(op_t::RECV, key);
+            conn.recv_armed = true;
+            return true;
+        }
+
+        /**
+         * @brief 将连接中排队的响应以链接的方式一次提交，前一个写完后内核才会开始写下一个。
+         */
+        void flush_connection(uint64_t key, connection &conn, uint32_t msg_flags = MSG_NOSIGNAL | MSG_WAITALL) {
+            if (conn.closing || !conn.inflight.empty() || conn.queued.empty()) return;
+
+            // 一条链必须在同一次提交中完整进入内核，否则前后两段可能乱序。
+            // 空间不足时先提交已有的 SQE，仍放不下的部分等这条链完成后再提交。
+            if (sq_space() < conn.queued.size()) enter_pending();
+            size_t count = std::min<size_t>(conn.queued.size(), sq_space());
+            if (count == 0) {
+                dirty.push_back(key);
+                return;
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                io_uring_sqe *sqe = get_sqe();
+                outgoing &send = *conn.queued.front();
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = conn.fd;
+                sqe->addr = reinterpret_cast<uint64_t>(&send.msg);
+                sqe->len = 1;
+                sqe->msg_flags = msg_flags;
+                sqe->flags = (i + 1 < count) ? IOSQE_IO_LINK : 0;
+                sqe->user_data = make_user_data(op_t::SEND, key);
+
+                conn.inflight.push_back(std::move(conn.queued.front()));
+                conn.queued.pop_front();
+            }
+        }
+
+        // 连接已关闭且内核不再引用它的任何缓冲区时，才真正释放连接状态。
+        // 只在完成事件的回调之外调用，保证回调执行期间连接状态不会被销毁。
+        void maybe_release(uint64_t key) {
+            auto it = connections.find(key);
+            if (it == connections.end()) return;
+
+            const connection &conn = it->second;
+            if (conn.closing && !conn.recv_armed && conn.inflight.empty()) {
+                connections.erase(it);
+            }
+        }
+
+        void handle_accept(const io_uring_cqe &cqe) {
+            if (!(cqe.flags & IORING_CQE_F_MORE) && listen_fd >= 0) {
+                arm_accept();
+            }
+            if (on_accept) on_accept(cqe.res);
+        }
+
+        void handle_recv(uint64_t key, const io_uring_cqe &cqe) {
+            const std::byte *data = nullptr;
+            int bid = -1;
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                bid = static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                data = buf_storage.get() + static_cast<size_t>(bid) * buf_size;
+            }
+
+            auto it = connections.find(key);
+            if (it != connections.end()) {
+                connection &conn = it->second;
+                bool more = cqe.flags & IORING_CQE_F_MORE;
+                if (!more) conn.recv_armed = false;
+
+                if (!conn.closing) {
+                    if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED) {
+                        // provided buffer 暂时耗尽或被 pause_recv() 取消，都不算连接错误；未处于暂停状态时重新挂起接收。
+                        if (!more && !conn.recv_paused) arm_recv(key, conn);
+                    } else {
+                        if (cqe.res > 0 && !more && !conn.recv_paused) arm_recv(key, conn);
+                        conn.on_recv(data, cqe.res);
+                    }
+                }
+                maybe_release(key);
+            }
+
+            if (bid >= 0) recycle_buffer(static_cast<uint16_t>(bid));
+        }
+
+        void handle_send(uint64_t key, const io_uring_cqe &cqe) {
+            auto it = connections.find(key);
+            if (it == connections.end()) return;
+
+            connection &conn = it->second;
+            if (conn.inflight.empty()) return;
+
+            size_t size = conn.inflight.front()->size;
+            bool complete = cqe.res == static_cast<int>(size);
+            conn.inflight.pop_front();
+            conn.pending_bytes -= size;
+
+            // 发送失败（包括链中前一个失败导致的 -ECANCELED）说明连接已不可用，关闭读端让接收回调感知。
+            if (!complete && !conn.closing) {
+                shutdown(conn.fd, SHUT_RDWR);
+            }
+
+            if (conn.inflight.empty() && !conn.queued.empty()) {
+                dirty.push_back(key);
+            }
+            if (!conn.closing && conn.on_sent) conn.on_sent();
+            maybe_release(key);
+        }
+
+        public:
+        /**
+         * @param entries 提交队列的深度
+         * @param buffers provided buffer 的数量，必须是 2 的幂
+         * @param buffer_size 每个 provided buffer 的大小
+         */
+        explicit uring_transport(uint32_t entries = 4096, uint32_t buffers = 1024, uint32_t buffer_size = 4096)
+        : ring_fd(-1), params{}, sq_ptr(nullptr), sq_ring_size(0), sq_head(nullptr), sq_tail(nullptr),
+          sq_mask(0), sq_entries(0), sqes(nullptr), sqes_size(0), sqe_tail(0), sqe_published(0),
+          cq_ptr(nullptr), cq_ring_size(0), cq_head(nullptr), cq_tail(nullptr), cq_mask(0), cqes(nullptr),
+          buf_ring(nullptr), buf_entries(nullptr), buf_ring_size(0), buf_count(buffers), buf_size(buffer_size), buf_tail(0),
+          listen_fd(-1), next_generation(1) {
+
+            if (buffers == 0 || (buffers & (buffers - 1)) != 0 || buffers > 32768) {
+                throw std::invalid_argument("Error: Provided buffer count must be a power of two not above 32768.");
+            }
+
+            // multishot recv 会为每个到达的数据段产生一个完成事件，完成队列给足余量。
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = entries * 4;
+
+            ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (ring_fd < 0) fail("Failed to set up io_uring");
+
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) {
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            }
+
+            sq_ptr = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_SQ_RING);
+            if (sq_ptr == MAP_FAILED) {
+                sq_ptr = nullptr;
+                fail("Failed to map io_uring submission ring");
+            }
+
+            if (single_mmap) {
+                cq_ptr = sq_ptr;
+            } else {
+                cq_ptr = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ring_fd, IORING_OFF_CQ_RING);
+                if (cq_ptr == MAP_FAILED) {
+                    cq_ptr = nullptr;
+                    fail("Failed to map io_uring completion ring");
+                }
+            }
+
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void *sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring_fd, IORING_OFF_SQES);
+            if (sqes_ptr == MAP_FAILED) fail("Failed to map io_uring SQE array");
+            sqes = static_cast<io_uring_sqe *>(sqes_ptr);
+
+            auto *sq_base = static_cast<std::byte *>(sq_ptr);
+            sq_head = reinterpret_cast<uint32_t *>(sq_base + params.sq_off.head);
+            sq_tail = reinterpret_cast<uint32_t *>(sq_base + params.sq_off.tail);
+            sq_mask = *reinterpret_cast<uint32_t *>(sq_base + params.sq_off.ring_mask);
+            sq_entries = *reinterpret_cast<uint32_t *>(sq_base + params.sq_off.ring_entries);
+            sqe_tail = sqe_published = *sq_tail;
+
+            // SQE 下标与数组位置一一对应，初始化一次即可。
+            uint32_t *sq_array = reinterpret_cast<uint32_t *>(sq_base + params.sq_off.array);
+            for (uint32_t i = 0; i < sq_entries; ++i) sq_array[i] = i;
+
+            auto *cq_base = static_cast<std::byte *>(cq_ptr);
+            cq_head = reinterpret_cast<uint32_t *>(cq_base + params.cq_off.head);
+            cq_tail = reinterpret_cast<uint32_t *>(cq_base + params.cq_off.tail);
+            cq_mask = *reinterpret_cast<uint32_t *>(cq_base + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq_base + params.cq_off.cqes);
+
+            // 注册 provided buffer ring，并把所有缓冲区交给内核
+            buf_ring_size = buf_count * sizeof(io_uring_buf);
+            void *ring_mem = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ring_mem == MAP_FAILED) fail("Failed to allocate provided buffer ring");
+            buf_ring = static_cast<io_uring_buf_ring *>(ring_mem);
+            // 内核头文件中的柔性数组在 C++ 下会被空结构体占位而偏移 8 字节，这里直接按数组访问，
+            // 尾指针 tail 与第一个元素的 resv 字段重叠，仍然通过 buf_ring->tail 访问。
+            buf_entries = static_cast<io_uring_buf *>(ring_mem);
+
+            io_uring_buf_reg reg{};
+            reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+            reg.ring_entries = buf_count;
+            reg.bgid = BUFFER_GROUP_ID;
+            if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+                fail("Failed to register provided buffer ring");
+            }
+
+            buf_storage = std::make_unique<std::byte[]>(static_cast<size_t>(buf_count) * buf_size);
+            for (uint32_t i = 0; i < buf_count; ++i) {
+                recycle_buffer(static_cast<uint16_t>(i));
+            }
+            publish_buffers();
+        }
+
+        ~uring_transport() noexcept {
+            release();
+        }
+
+        uring_transport(const uring_transport&) = delete;
+        uring_transport& operator=(const uring_transport&) = delete;
+
+        /**
+         * @brief 在监听套接字上挂起 multishot accept。
+         */
+        bool watch_accept(int fd, accept_handler_t handler) {
+            listen_fd = fd;
+            on_accept = std::move(handler);
+            return arm_accept();
+        }
+
+        /**
+         * @brief 开始在连接上接收数据，每收到一段数据调用一次 handler。
+         * handler 拿到的数据位于 provided buffer 中，回调返回后缓冲区即被归还给内核。
+         */
+        bool watch_recv(int fd, recv_handler_t handler) {
+            uint32_t generation = next_generation++ & 0x00FFFFFF;
+            if (next_generation > 0x00FFFFFF) next_generation = 1;
+
+            uint64_t key = make_key(generation, fd);
+            auto [it, inserted] = connections.emplace(key, connection{fd, std::move(handler), {}, {}, {}, 0, false, false, false});
+            if (!inserted) return false;
+
+            if (!arm_recv(key, it->second)) {
+                connections.erase(it);
+                return false;
+            }
+            live_generation[fd] = generation;
+            return true;
+        }
+
+        /**
+         * @brief 设置连接的发送完成回调，上层据此在积压减少后恢复被挂起的发送方。
+         */
+        bool watch_send(int fd, send_handler_t handler) {
+            connection *conn = find_live(fd);
+            if (!conn) return false;
+            conn->on_sent = std::move(handler);
+            return true;
+        }
+
+        /**
+         * @brief 连接上已排队或已提交但尚未写出的字节数。
+         */
+        size_t pending_bytes(int fd) const noexcept {
+            auto gen = live_generation.find(fd);
+            if (gen == live_generation.end()) return 0;
+            auto it = connections.find(make_key(gen->second, fd));
+            return it == connections.end() ? 0 : it->second.pending_bytes;
+        }
+
+        /**
+         * @brief 暂停连接上的接收：取消 multishot recv，已经收到的数据仍会照常回调。
+         */
+        void pause_recv(int fd) {
+            connection *conn = find_live(fd);
+            if (!conn || conn->recv_paused) return;
+
+            conn->recv_paused = true;
+            if (!conn->recv_armed) return;
+
+            io_uring_sqe *sqe = get_sqe();
+            if (!sqe) return;
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = make_user_data(op_t::RECV, make_key(live_generation[fd], fd));
+            sqe->user_data = make_user_data(op_t::CANCEL, 0);
+            // 立即提交，缩短取消生效前继续送达数据的窗口
+            enter_pending();
+        }
+
+        /**
+         * @brief 恢复被 pause_recv() 暂停的接收。
+         */
+        void resume_recv(int fd) {
+            connection *conn = find_live(fd);
+            if (!conn || !conn->recv_paused) return;
+
+            conn->recv_paused = false;
+            // 取消请求的完成事件尚未到达时接收仍处于挂起状态，由 handle_recv 在收到 -ECANCELED 后重新挂起
+            if (!conn->recv_armed) arm_recv(make_key(live_generation[fd], fd), *conn);
+        }
+
+        /**
+         * @brief 取走发送缓冲区中的全部数据排入连接的发送队列，在下一次 submit_pending() 时提交。
+         * 内存块与共享报文的引用随之转移，直到内核完成发送才释放；iovec 超过 MAX_SEND_SEGMENTS 时拆成多段。
+         */
+        bool submit_send(int fd, send_buffer &buffer) {
+            auto gen = live_generation.find(fd);
+            if (gen == live_generation.end()) return false;
+
+            uint64_t key = make_key(gen->second, fd);
+            auto it = connections.find(key);
+            if (it == connections.end() || it->second.closing) return false;
+
+            connection &conn = it->second;
+            bool was_idle = conn.queued.empty() && conn.inflight.empty();
+            while (!buffer.empty()) {
+                auto send = std::make_unique<outgoing>(outgoing{buffer.take_front(MAX_SEND_SEGMENTS), {}, {}, 0});
+                send->size = send->data.size();
+                send->data.segments(send->iov);
+                send->msg.msg_iov = send->iov.data();
+                send->msg.msg_iovlen = send->iov.size();
+                conn.pending_bytes += send->size;
+                conn.queued.push_back(std::move(send));
+            }
+            if (was_idle) dirty.push_back(key);
+            return true;
+        }
+
+        /**
+         * @brief 关闭连接。先 shutdown 使挂起的接收与发送尽快结束，
+         * 连接状态要等内核交回全部缓冲区后才会释放。
+         * 没有在途发送时，尚未提交的响应（如认证失败的回复）以 MSG_DONTWAIT 尽力写出后再关闭：
+         * 能立即进入内核发送缓冲区的部分照常送达，对端不读时发送直接失败，不会让连接滞留。
+         */
+        bool close_fd(int fd) noexcept {
+            auto gen = live_generation.find(fd);
+            if (gen == live_generation.end()) {
+                return fd >= 0 && close(fd) == 0;
+            }
+
+            uint64_t key = make_key(gen->second, fd);
+            live_generation.erase(gen);
+
+            auto it = connections.find(key);
+            if (it != connections.end()) {
+                connection &conn = it->second;
+                if (conn.inflight.empty() && !conn.queued.empty()) {
+                    flush_connection(key, conn, MSG_NOSIGNAL | MSG_DONTWAIT);
+                    // 内核在提交时解析 fd，必须在 close 之前进入内核；只关闭读端，让发送继续完成
+                    enter_pending();
+                    shutdown(fd, SHUT_RD);
+                } else {
+                    shutdown(fd, SHUT_RDWR);
+                }
+                conn.closing = true;
+                conn.queued.clear();
+                // 可能正处于该连接的回调中，释放推迟到下一次 submit_pending()
+                dirty.push_back(key);
+            }
+            close(fd);
+            return true;
+        }
+
+        /**
+         * @brief 将本轮积累的发送请求链接后，与其他 SQE 一起通过一次 io_uring_enter 提交。
+         */
+        void submit_pending() {
+            std::vector<uint64_t> pending;
+            pending.swap(dirty);
+            for (uint64_t key : pending) {
+                auto it = connections.find(key);
+                if (it == connections.end()) continue;
+                if (it->second.closing) {
+                    maybe_release(key);
+                } else {
+                    flush_connection(key, it->second);
+                }
+            }
+
+            enter_pending();
+        }
+
+        /**
+         * @brief 处理完成队列中的全部事件，并把用完的 provided buffer 一次性归还给内核。
+         */
+        void process_completions() {
+            uint32_t head = *cq_head;
+            uint32_t tail = std::atomic_ref<uint32_t>(*cq_tail).load(std::memory_order_acquire);
+
+            while (head != tail) {
+                io_uring_cqe cqe = cqes[head & cq_mask];
+                ++head;
+                // 先释放完成队列的位置，回调中提交的新请求不会因此溢出。
+                std::atomic_ref<uint32_t>(*cq_head).store(head, std::memory_order_release);
+
+                op_t op = static_cast<op_t>(cqe.user_data >> 56);
+                uint64_t key = cqe.user_data & 0x00FFFFFFFFFFFFFFULL;
+                switch (op) {
+                    case op_t::ACCEPT:
+                        handle_accept(cqe);
+                        break;
+                    case op_t::RECV:
+                        handle_recv(key, cqe);
+                        break;
+                    case op_t::SEND:
+                        handle_send(key, cqe);
+                        break;
+                    case op_t::CANCEL:
+                        break;
+                }
+
+                if (head == tail) {
+                    tail = std::atomic_ref<uint32_t>(*cq_tail).load(std::memory_order_acquire);
+                }
+            }
+
+            publish_buffers();
+        }
+
+        int get_ring_fd() const noexcept {
+            return ring_fd;
+        }
+};
\ No newline at end of file
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <ctime>
 #include <memory>
+#include <string_view>
 #include <netinet/in.h>  // For ntohl, ntohs
 #include <vector>
 
@@ -16,11 +19,15 @@ enum class piap_msg_type_t : uint16_t {
     SIGNUP_REQUEST = 0x0001,        // 客户端向服务器发送注册其请求
     LOGIN_REQUEST = 0x0002,         // 客户端向服务器发送认证请求。
     LOGOUT_REQUEST = 0x0003,        // 客户端请求断开连接
+    RESUME_REQUEST = 0x0007,        // 客户端凭登录时获得的会话令牌恢复会话，不再发送密码
+    CHANGE_PASSWORD_REQUEST = 0x0009,   // 已登录的客户端修改密码：password 为当前密码，new_password 为新密码
 
     // ----- 服务器认证消息类型
     SIGNUP_RESPONSE = 0x0004,       // 服务器成功注册用户。
     LOGIN_RESPONSE = 0x0005,        // 服务器同意客户端登录
-    FORCE_LOGOUT = 0x0006           // 服务器发送信息使得客户端强制退出。
+    FORCE_LOGOUT = 0x0006,          // 服务器发送信息使得客户端强制退出。
+    RESUME_RESPONSE = 0x0008,       // 服务器对恢复会话请求的答复
+    CHANGE_PASSWORD_RESPONSE = 0x000A   // 服务器对修改密码请求的答复，成功时携带新签发的会话令牌
 };
 
 enum class piap_format_type_t : uint16_t {
@@ -40,6 +47,7 @@ enum class piap_auth_type_t : uint16_t {
     // ----- PIAP 协议只有该状态才算作控制通路连接 -----
     SIGNUP_SUCCESS = 100,        // 注册成功，按照本处逻辑注册即可直接登录。
     LOGIN_SUCCESS = 200,         // 验证与登录均通过，客户端成功连接上服务器并允许传输信息。
+    PASSWORD_CHANGED = 201,      // 密码修改成功，已经写入磁盘。
 
     // Otherwise:
 
@@ -49,6 +57,7 @@ enum class piap_auth_type_t : uint16_t {
     USER_NOT_FOUND,              // 服务器内并不存在该玩家账号。
     WRONG_PASSWORD,              // 账户登录信息错误。
     USER_BANNED,                 // 账户被服务器直接拒绝，目前只有被封号的原因。
+    SESSION_EXPIRED,             // 会话令牌不存在或已过期，需要重新登录。
 
     // ----- 服务器错误 -----
     SERVER_ERR_RESPONSE = 500,   // 服务器响应异常。
@@ -56,11 +65,91 @@ enum class piap_auth_type_t : uint16_t {
 };
 
 constexpr uint32_t PIAP_MAGIC = 0x50494150;
-constexpr uint16_t PIAP_VERSION = 0x0100;
+constexpr uint16_t PIAP_VERSION_V1 = 0x0100;       // 定长载荷，服务器在 status_msg 中附带提示文本
+constexpr uint16_t PIAP_VERSION_V2 = 0x0200;       // 紧凑载荷：字段带长度前缀，只传状态码
+constexpr uint16_t PIAP_VERSION = PIAP_VERSION_V2;
 // TTL 应当由客户端与服务器约定，目前设置 TTL 为一分钟，保证连接不会被拦截并盗取信息。
 constexpr unsigned int PIAP_TTL = 60;
 
-constexpr size_t PIAP_TOTAL_SIZE = 536;
+constexpr size_t PIAP_TOTAL_SIZE = 536;            // v1 报文的固定长度
+
+/*
+ * v2 载荷的线上布局（网络字节序），字符串不含结尾的 '\0'：
+ *   msg_status(2) auth_status(2) userID_length(1) password_length(1) session_length(1) new_password_length(1)
+ *   userID[userID_length] password[password_length] session[session_length] new_password[new_password_length]
+ * new_password_length 原为保留字节，只有修改密码请求不为 0。
+ */
+constexpr size_t PIAP_V2_PAYLOAD_FIXED_SIZE = 8;
+
+inline bool piap_version_supported(uint16_t version) noexcept {
+    return version == PIAP_VERSION_V1 || version == PIAP_VERSION_V2;
+}
+
+/**
+ * @brief 认证状态码对应的提示信息。v2 报文只携带状态码，由接收方通过该表还原提示文本。
+ */
+inline const char *piap_auth_status_message(piap_auth_type_t status) noexcept {
+    switch (status) {
+        case piap_auth_type_t::SIGNUP_SUCCESS:
+            return "Registration successful!";
+        case piap_auth_type_t::LOGIN_SUCCESS:
+            return "Authentication successful!";
+        case piap_auth_type_t::PASSWORD_CHANGED:
+            return "Password changed successfully!";
+
+        // 客户端请求错误
+        case piap_auth_type_t::BAD_REQUEST:
+            return "Error: Invalid request format or missing required fields";
+        case piap_auth_type_t::USER_ALREADY_EXISTS:
+            return "Error: Username already exists.";
+        case piap_auth_type_t::USER_NOT_FOUND:
+            return "Error: Invalid account.";
+        case piap_auth_type_t::WRONG_PASSWORD:
+            return "Error: Invalid password.";
+        case piap_auth_type_t::USER_BANNED:
+            return "Permission denied: Account has been banned!";
+        case piap_auth_type_t::SESSION_EXPIRED:
+            return "Error: Session expired, please log in again.";
+
+        // 服务器错误
+        case piap_auth_type_t::SERVER_ERR_RESPONSE:
+            return "Error: Internal server error.";
+        case piap_auth_type_t::SERVER_UNAVAILABLE:
+            return "Error: Service temporarily unavailable.";
+
+        default:
+            return "Unknown error occurred!";
+    }
+}
+
+/**
+ * @brief 格式状态码对应的提示信息。
+ */
+inline const char *piap_format_status_message(piap_format_type_t status) noexcept {
+    switch (status) {
+        case piap_format_type_t::FORMAT_OK:
+            return "Format validation passed.";
+        case piap_format_type_t::MAGIC_MISMATCH:
+            return "Error: Protocol magic number mismatch.";
+        case piap_format_type_t::BAD_VERSION:
+            return "Error: Unsupported protocol version.";
+        case piap_format_type_t::MSG_TYPE_NOT_FOUND:
+            return "Error: Unknown message type.";
+        case piap_format_type_t::TIMESTAMP_ERR:
+            return "Error: Request timestamp expired or invalid.";
+        default:
+            return "Unknown format error occurred!";
+    }
+}
+
+/**
+ * @brief v1 报文未携带提示文本时按状态码补上的提示信息：优先使用认证状态，否则使用格式状态。
+ */
+inline const char *piap_default_status_message(uint16_t msg_status, uint16_t auth_status) noexcept {
+    if (auth_status != 0) return piap_auth_status_message(static_cast<piap_auth_type_t>(auth_status));
+    if (msg_status != 0) return piap_format_status_message(static_cast<piap_format_type_t>(msg_status));
+    return "";
+}
 
 struct piap_header_t {
     uint32_t magic;
@@ -79,9 +168,13 @@ struct piap_header_t {
 struct piap_payload_t {
     char userID[64];
     char password[128];
-    char session[64];         // TODO: 用于生成唯一令牌
-    char status_msg[256];
-    
+    char session[64];         // 会话令牌：登录成功时由服务器下发，恢复会话时由客户端带回
+    // 请求不携带提示文本，修改密码请求的新密码放在同一位置，v1 的定长布局因此不变
+    union {
+        char status_msg[256];
+        char new_password[128];
+    };
+
     uint16_t msg_status;
     uint16_t auth_status;
 
@@ -93,6 +186,76 @@ struct piap_payload_t {
     }
 };
 
+/**
+ * @brief 报文格式检查（魔数、版本、消息类型、TTL、注册与登录请求的凭据完整性、恢复请求的会话令牌、改密请求的新密码），
+ * 字段均为主机字节序。piap_t 与 piap_view_t 共用这一套规则。
+ * now 为当前的 Unix 时间，服务器传入事件循环缓存的时间，避免每个报文读取一次时钟；为 0 时读取系统时间。
+ */
+inline piap_format_type_t piap_check_format(uint32_t magic, uint16_t version, uint16_t msg,
+                                            uint32_t timestamp, bool has_credentials, bool has_session,
+                                            bool has_new_password, uint32_t now = 0) noexcept {
+    if (magic != PIAP_MAGIC) {
+        return piap_format_type_t::MAGIC_MISMATCH;
+    }
+
+    if (!piap_version_supported(version)) {
+        return piap_format_type_t::BAD_VERSION;
+    }
+
+    if (msg != static_cast<uint16_t>(piap_msg_type_t::SIGNUP_REQUEST) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::LOGIN_REQUEST) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::LOGOUT_REQUEST) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::SIGNUP_RESPONSE) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::LOGIN_RESPONSE) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::FORCE_LOGOUT) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::RESUME_REQUEST) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::RESUME_RESPONSE) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::CHANGE_PASSWORD_REQUEST) &&
+        msg != static_cast<uint16_t>(piap_msg_type_t::CHANGE_PASSWORD_RESPONSE)) {
+        return piap_format_type_t::MSG_TYPE_NOT_FOUND;
+    }
+
+    if (timestamp != 0) {
+        uint32_t current_time = now != 0 ? now : static_cast<uint32_t>(std::time(nullptr));
+        if (current_time > timestamp + PIAP_TTL ||
+            current_time < timestamp) {
+            return piap_format_type_t::TIMESTAMP_ERR;
+        }
+    }
+
+    if (msg == static_cast<uint16_t>(piap_msg_type_t::SIGNUP_REQUEST) ||
+        msg == static_cast<uint16_t>(piap_msg_type_t::LOGIN_REQUEST)) {
+        if (!has_credentials) {
+            return piap_format_type_t::MSG_TYPE_NOT_FOUND;
+        }
+    }
+
+    if (msg == static_cast<uint16_t>(piap_msg_type_t::RESUME_REQUEST) && !has_session) {
+        return piap_format_type_t::MSG_TYPE_NOT_FOUND;
+    }
+
+    // 修改密码需要当前的凭据与新密码
+    if (msg == static_cast<uint16_t>(piap_msg_type_t::CHANGE_PASSWORD_REQUEST) && (!has_credentials || !has_new_password)) {
+        return piap_format_type_t::MSG_TYPE_NOT_FOUND;
+    }
+
+    return piap_format_type_t::FORMAT_OK;
+}
+
+/**
+ * @brief 根据报文首部中（网络字节序的）版本与载荷长度计算整个报文的长度，首部非法时返回 0。
+ * v1 报文长度固定为 PIAP_TOTAL_SIZE；v2 的紧凑载荷不会超过定长载荷。
+ */
+inline size_t piap_frame_size(uint16_t net_version, uint32_t net_payload_length) noexcept {
+    uint16_t version = ntohs(net_version);
+    if (version == PIAP_VERSION_V1) return PIAP_TOTAL_SIZE;
+    if (version != PIAP_VERSION_V2) return 0;
+
+    uint32_t payload_length = ntohl(net_payload_length);
+    if (payload_length > sizeof(piap_payload_t)) return 0;
+    return sizeof(piap_header_t) + payload_length;
+}
+
 /**
  * @brief 用户身份认证协议的具体定义，具有首部与载荷部分。
  * 
@@ -102,6 +265,69 @@ class piap_t {
 private:
     piap_header_t header;
     piap_payload_t payload;
+
+    // 状态码对应的默认提示信息：认证响应优先使用认证状态，否则使用格式状态
+    const char *default_status_msg() const noexcept {
+        return piap_default_status_message(payload.msg_status, payload.auth_status);
+    }
+
+    // 新密码与提示文本共用位置，只有修改密码请求才把它当作新密码
+    bool carries_new_password() const noexcept {
+        return header.msg_type == static_cast<uint16_t>(piap_msg_type_t::CHANGE_PASSWORD_REQUEST);
+    }
+
+    // v2 载荷长度，取决于各字符串的实际长度
+    size_t compact_payload_size() const noexcept {
+        return PIAP_V2_PAYLOAD_FIXED_SIZE +
+               strnlen(payload.userID, sizeof(payload.userID) - 1) +
+               strnlen(payload.password, sizeof(payload.password) - 1) +
+               strnlen(payload.session, sizeof(payload.session) - 1) +
+               (carries_new_password() ? strnlen(payload.new_password, sizeof(payload.new_password) - 1) : 0);
+    }
+
+    void serialize_compact_payload(std::byte *ptr) const noexcept {
+        uint16_t msg_status = htons(payload.msg_status);
+        uint16_t auth_status = htons(payload.auth_status);
+        std::memcpy(ptr, &msg_status, sizeof(msg_status));
+        std::memcpy(ptr + 2, &auth_status, sizeof(auth_status));
+
+        const char *fields[] = {payload.userID, payload.password, payload.session, payload.new_password};
+        const size_t limits[] = {sizeof(payload.userID), sizeof(payload.password), sizeof(payload.session),
+                                 sizeof(payload.new_password)};
+        int field_count = carries_new_password() ? 4 : 3;
+        std::byte *text = ptr + PIAP_V2_PAYLOAD_FIXED_SIZE;
+        for (int i = 0; i < field_count; ++i) {
+            size_t length = strnlen(fields[i], limits[i] - 1);
+            ptr[4 + i] = static_cast<std::byte>(length);
+            std::memcpy(text, fields[i], length);
+            text += length;
+        }
+        if (field_count == 3) ptr[7] = std::byte{0};
+    }
+
+    // 解析 v2 载荷，长度字段越界时返回 false
+    bool deserialize_compact_payload(const std::byte *ptr, size_t length) noexcept {
+        if (length < PIAP_V2_PAYLOAD_FIXED_SIZE) return false;
+
+        uint16_t msg_status, auth_status;
+        std::memcpy(&msg_status, ptr, sizeof(msg_status));
+        std::memcpy(&auth_status, ptr + 2, sizeof(auth_status));
+        payload.msg_status = ntohs(msg_status);
+        payload.auth_status = ntohs(auth_status);
+
+        char *fields[] = {payload.userID, payload.password, payload.session, payload.new_password};
+        const size_t limits[] = {sizeof(payload.userID), sizeof(payload.password), sizeof(payload.session),
+                                 sizeof(payload.new_password)};
+        size_t offset = PIAP_V2_PAYLOAD_FIXED_SIZE;
+        for (int i = 0; i < 4; ++i) {
+            size_t field_length = static_cast<size_t>(ptr[4 + i]);
+            if (field_length >= limits[i] || offset + field_length > length) return false;
+            std::memcpy(fields[i], ptr + offset, field_length);
+            fields[i][field_length] = '\0';
+            offset += field_length;
+        }
+        return true;
+    }
     
 public:
 
@@ -128,40 +354,79 @@ public:
     }
 
     /**
-     * @brief Serialize the packet to network byte order for sending
-     * 
-     * @return std::vector<std::byte> Serialized data in network byte order
+     * @brief 序列化后在线上的长度，v1 固定为 PIAP_TOTAL_SIZE，v2 取决于字段的实际长度。
      */
-    std::vector<std::byte> serialize() const {
-        std::vector<std::byte> buffer(size());
+    size_t wire_size() const noexcept {
+        if (header.version == PIAP_VERSION_V2) {
+            return sizeof(piap_header_t) + compact_payload_size();
+        }
+        return size();
+    }
+
+    /**
+     * @brief 以网络字节序直接编码到调用方提供的缓冲区，不产生中间拷贝。
+     *
+     * @param dst 至少 wire_size() 字节的可写内存
+     * @return size_t 写入的字节数，等于 wire_size()
+     */
+    size_t encode(std::byte *dst) const noexcept {
+        size_t total = wire_size();
         piap_header_t net_header(0, 0, 0);  // Dummy values, will overwrite
         net_header.magic = htonl(header.magic);
         net_header.version = htons(header.version);
         net_header.msg_type = htons(header.msg_type);
-        net_header.payload_length = htonl(header.payload_length);
+        net_header.payload_length = htonl(static_cast<uint32_t>(total - sizeof(piap_header_t)));
         net_header.timestamp = htonl(header.timestamp);
         net_header.reserved = htonl(header.reserved);
 
-        std::memcpy(buffer.data(), &net_header, sizeof(piap_header_t));
+        std::memcpy(dst, &net_header, sizeof(piap_header_t));
+        std::byte *body = dst + sizeof(piap_header_t);
 
-        // Copy payload, but convert uint16_t fields
-        piap_payload_t net_payload = payload;
-        net_payload.msg_status = htons(payload.msg_status);
-        net_payload.auth_status = htons(payload.auth_status);
+        if (header.version == PIAP_VERSION_V2) {
+            serialize_compact_payload(body);
+            return total;
+        }
 
-        std::memcpy(buffer.data() + sizeof(piap_header_t), &net_payload, sizeof(piap_payload_t));
+        // Copy payload in place, then convert uint16_t fields
+        std::memcpy(body, &payload, sizeof(piap_payload_t));
+        uint16_t msg_status = htons(payload.msg_status);
+        uint16_t auth_status = htons(payload.auth_status);
+        std::memcpy(body + offsetof(piap_payload_t, msg_status), &msg_status, sizeof(msg_status));
+        std::memcpy(body + offsetof(piap_payload_t, auth_status), &auth_status, sizeof(auth_status));
+        // v1 客户端直接显示 status_msg，未设置时按状态码补上提示信息；修改密码请求在这里携带新密码
+        if (!carries_new_password() && payload.status_msg[0] == '\0') {
+            char *status_msg = reinterpret_cast<char*>(body + offsetof(piap_payload_t, status_msg));
+            std::strncpy(status_msg, default_status_msg(), sizeof(payload.status_msg) - 1);
+        }
+        return total;
+    }
 
+    /**
+     * @brief Serialize the packet to network byte order for sending
+     * 
+     * @return std::vector<std::byte> Serialized data in network byte order
+     */
+    std::vector<std::byte> serialize() const {
+        std::vector<std::byte> buffer(wire_size());
+        encode(buffer.data());
         return buffer;
     }
 
     static std::unique_ptr<piap_t> deserialize(const void *data, size_t len) {
-        if(len < sizeof(piap_header_t) + sizeof(piap_payload_t)) return nullptr;
+        if(len < sizeof(piap_header_t)) return nullptr;
 
         const piap_header_t *h = static_cast<const piap_header_t*>(data);
         // Convert from network byte order to host byte order
         uint32_t magic = ntohl(h->magic);
         uint16_t version = ntohs(h->version);
-        if(magic != PIAP_MAGIC || version != PIAP_VERSION) return nullptr;
+        if(magic != PIAP_MAGIC || !piap_version_supported(version)) return nullptr;
+
+        size_t payload_length = ntohl(h->payload_length);
+        if (version == PIAP_VERSION_V1) {
+            if (len < sizeof(piap_header_t) + sizeof(piap_payload_t)) return nullptr;
+        } else if (len < sizeof(piap_header_t) + payload_length) {
+            return nullptr;
+        }
 
         auto packet = std::make_unique<piap_t>(static_cast<piap_msg_type_t>(ntohs(h->msg_type)));
 
@@ -175,6 +440,13 @@ public:
 
         // 因为内存连续，因此如果要得到载荷的部分就应该加上对应的长度才可以访问到实际的内存。
         const std::byte *payload_bytes = static_cast<const std::byte*>(data) + sizeof(piap_header_t);
+        if (version == PIAP_VERSION_V2) {
+            if (!packet->deserialize_compact_payload(payload_bytes, payload_length)) return nullptr;
+            // 解析后统一为定长的内存布局
+            packet->header.payload_length = sizeof(piap_payload_t);
+            return packet;
+        }
+
         std::memcpy(&packet->payload, payload_bytes, sizeof(piap_payload_t));
 
         // Convert payload fields from network byte order
@@ -187,45 +459,14 @@ public:
     /**
      * @brief 验证数据包格式是否合法（魔数、版本、TTL、字段完整性）
      * 
+     * @param now 当前的 Unix 时间，0 表示读取系统时间
      * @return piap_format_type_t 格式验证结果
      */
-    piap_format_type_t valid_format() noexcept {
-
-        if (header.magic != PIAP_MAGIC) {
-            return piap_format_type_t::MAGIC_MISMATCH;
-        }
-        
-        if (header.version != PIAP_VERSION) {
-            return piap_format_type_t::BAD_VERSION;
-        }
-        
-        uint16_t msg = header.msg_type;
-        if (msg != static_cast<uint16_t>(piap_msg_type_t::SIGNUP_REQUEST) &&
-            msg != static_cast<uint16_t>(piap_msg_type_t::LOGIN_REQUEST) &&
-            msg != static_cast<uint16_t>(piap_msg_type_t::LOGOUT_REQUEST) &&
-            msg != static_cast<uint16_t>(piap_msg_type_t::SIGNUP_RESPONSE) &&
-            msg != static_cast<uint16_t>(piap_msg_type_t::LOGIN_RESPONSE) &&
-            msg != static_cast<uint16_t>(piap_msg_type_t::FORCE_LOGOUT)) {
-            return piap_format_type_t::MSG_TYPE_NOT_FOUND;
-        }
-        
-        if (header.timestamp != 0) {
-            uint32_t current_time = static_cast<uint32_t>(std::time(nullptr));
-            if (current_time > header.timestamp + PIAP_TTL || 
-                current_time < header.timestamp) {
-                return piap_format_type_t::TIMESTAMP_ERR;
-            }
-        }
-        
-        if (header.msg_type == static_cast<uint16_t>(piap_msg_type_t::SIGNUP_REQUEST) ||
-            header.msg_type == static_cast<uint16_t>(piap_msg_type_t::LOGIN_REQUEST)) {
-            
-            if (payload.userID[0] == '\0' || payload.password[0] == '\0') {
-                return piap_format_type_t::MSG_TYPE_NOT_FOUND;
-            }
-        }
-        
-        return piap_format_type_t::FORMAT_OK;
+    piap_format_type_t valid_format(uint32_t now = 0) noexcept {
+        bool has_credentials = payload.userID[0] != '\0' && payload.password[0] != '\0';
+        bool has_new_password = carries_new_password() && payload.new_password[0] != '\0';
+        return piap_check_format(header.magic, header.version, header.msg_type, header.timestamp, has_credentials,
+                                 payload.session[0] != '\0', has_new_password, now);
     }
     
     
@@ -282,92 +523,36 @@ public:
     }
     
     /**
-     * @brief 设置认证状态并自动填充对应的提示信息
+     * @brief 设置认证状态。提示信息不再随报文逐个填写，v1 报文在序列化时按状态码补上，v2 报文只携带状态码。
      * 
      * @param status 认证状态码
      */
-    void set_auth_status(piap_auth_type_t status) {
+    void set_auth_status(piap_auth_type_t status) noexcept {
         payload.auth_status = static_cast<uint16_t>(status);
-        
-        const char* default_msg = nullptr;
-        
-        switch (status) {
-            case piap_auth_type_t::SIGNUP_SUCCESS:
-                default_msg = "Registration successful!";
-                break;
-            case piap_auth_type_t::LOGIN_SUCCESS:
-                default_msg = "Authentication successful!";
-                break;
-                
-            // 客户端请求错误
-            case piap_auth_type_t::BAD_REQUEST:
-                default_msg = "Error: Invalid request format or missing required fields";
-                break;
-            case piap_auth_type_t::USER_ALREADY_EXISTS:
-                default_msg = "Error: Username already exists.";
-                break;
-            case piap_auth_type_t::USER_NOT_FOUND:
-                default_msg = "Error: Invalid account.";
-                break;
-            case piap_auth_type_t::WRONG_PASSWORD:
-                default_msg = "Error: Invalid password.";
-                break;
-            case piap_auth_type_t::USER_BANNED:
-                default_msg = "Permission denied: Account has been banned!";
-                break;
-                
-            // 服务器错误
-            case piap_auth_type_t::SERVER_ERR_RESPONSE:
-                default_msg = "Error: Internal server error.";
-                break;
-            case piap_auth_type_t::SERVER_UNAVAILABLE:
-                default_msg = "Error: Service temporarily unavailable.";
-                break;
-                
-            default:
-                default_msg = "Unknown error occurred!";
-                break;
-        }
-        
-        std::strncpy(payload.status_msg, default_msg, sizeof(payload.status_msg) - 1);
-        payload.status_msg[sizeof(payload.status_msg) - 1] = '\0';
+        payload.status_msg[0] = '\0';
     }
     
     /**
-     * @brief 设置格式状态并自动填充对应的提示信息
+     * @brief 设置格式状态，提示信息的处理与 set_auth_status 相同。
      * 
      * @param status 格式状态码
      */
-    void set_format_status(piap_format_type_t status) {
+    void set_format_status(piap_format_type_t status) noexcept {
         payload.msg_status = static_cast<uint16_t>(status);
-        
-        const char* default_msg = nullptr;
-        
-        switch (status) {
-            case piap_format_type_t::FORMAT_OK:
-                default_msg = "Format validation passed.";
-                break;
-            case piap_format_type_t::MAGIC_MISMATCH:
-                default_msg = "Error: Protocol magic number mismatch.";
-                break;
-            case piap_format_type_t::BAD_VERSION:
-                default_msg = "Error: Unsupported protocol version.";
-                break;
-            case piap_format_type_t::MSG_TYPE_NOT_FOUND:
-                default_msg = "Error: Unknown message type.";
-                break;
-            case piap_format_type_t::TIMESTAMP_ERR:
-                default_msg = "Error: Request timestamp expired or invalid.";
-                break;
-            default:
-                default_msg = "Unknown format error occurred!";
-                break;
-        }
-        
-        std::strncpy(payload.status_msg, default_msg, sizeof(payload.status_msg) - 1);
-        payload.status_msg[sizeof(payload.status_msg) - 1] = '\0';
+        payload.status_msg[0] = '\0';
     }
     
+    /**
+     * @brief 设置报文使用的协议版本。服务器按请求的版本回复，使 v1 客户端仍然收到定长报文。
+     */
+    void set_version(uint16_t version) noexcept {
+        header.version = version;
+    }
+
+    uint16_t get_version() const noexcept {
+        return header.version;
+    }
+
     /**
      * @brief 设置用户凭据（客户端发送请求时使用）
      */
@@ -379,6 +564,22 @@ public:
         payload.password[sizeof(payload.password) - 1] = '\0';
     }
 
+    /**
+     * @brief 设置会话令牌：服务器在登录成功的响应中下发，客户端在恢复会话的请求中带回。
+     */
+    void set_session(const char* token) noexcept {
+        std::strncpy(payload.session, token, sizeof(payload.session) - 1);
+        payload.session[sizeof(payload.session) - 1] = '\0';
+    }
+
+    /**
+     * @brief 设置修改密码请求的新密码，长度上限与 password 相同。
+     */
+    void set_new_password(const char* pass) noexcept {
+        std::strncpy(payload.new_password, pass, sizeof(payload.new_password) - 1);
+        payload.new_password[sizeof(payload.new_password) - 1] = '\0';
+    }
+
     // ========== Getters ==========
     
     /**
@@ -417,9 +618,239 @@ public:
     }
     
     /**
-     * @brief 获取错误消息
+     * @brief 获取会话令牌
+     */
+    const char* get_session() const noexcept {
+        return payload.session;
+    }
+
+    /**
+     * @brief 获取修改密码请求的新密码，其他报文为空。
+     */
+    const char* get_new_password() const noexcept {
+        return carries_new_password() ? payload.new_password : "";
+    }
+
+    /**
+     * @brief 获取提示信息。报文未携带文本（v2）时由状态码映射得到。
      */
     const char* get_status_msg() const noexcept {
-        return payload.status_msg;
+        if (payload.status_msg[0] != '\0') return payload.status_msg;
+        return default_status_msg();
+    }
+};
+
+/**
+ * @brief 服务器直接由状态码与令牌编码的认证响应，不经过 piap_t 的定长载荷，也不需要在堆上构造报文。
+ * 令牌引用调用者的内存，编码时拷贝一次；线上格式与只设置了这些字段的 piap_t 相同。
+ * 提供 wire_size() 与 encode()，可以交给 send_buffer::encode。
+ */
+struct piap_response_t {
+    uint16_t version = PIAP_VERSION;
+    piap_msg_type_t msg_type;
+    uint16_t msg_status = 0;
+    uint16_t auth_status = 0;
+    std::string_view session;
+
+    piap_response_t(uint16_t response_version, piap_msg_type_t type) noexcept
+        : version(response_version), msg_type(type) {}
+
+    void set_format_status(piap_format_type_t status) noexcept {
+        msg_status = static_cast<uint16_t>(status);
+    }
+
+    void set_auth_status(piap_auth_type_t status) noexcept {
+        auth_status = static_cast<uint16_t>(status);
+    }
+
+    // 与 piap_t::set_session 一致，不超出定长字段
+    std::string_view wire_session() const noexcept {
+        return session.substr(0, std::min(session.find('\0'), sizeof(piap_payload_t::session) - 1));
+    }
+
+    size_t wire_size() const noexcept {
+        if (version == PIAP_VERSION_V2) {
+            return sizeof(piap_header_t) + PIAP_V2_PAYLOAD_FIXED_SIZE + wire_session().size();
+        }
+        return PIAP_TOTAL_SIZE;
+    }
+
+    size_t encode(std::byte *dst) const noexcept {
+        size_t total = wire_size();
+        std::string_view token = wire_session();
+
+        piap_header_t net_header(0, 0, 0);
+        net_header.magic = htonl(PIAP_MAGIC);
+        net_header.version = htons(version);
+        net_header.msg_type = htons(static_cast<uint16_t>(msg_type));
+        net_header.payload_length = htonl(static_cast<uint32_t>(total - sizeof(piap_header_t)));
+        std::memcpy(dst, &net_header, sizeof(piap_header_t));
+        std::byte *body = dst + sizeof(piap_header_t);
+
+        uint16_t net_msg_status = htons(msg_status);
+        uint16_t net_auth_status = htons(auth_status);
+        if (version == PIAP_VERSION_V2) {
+            std::memcpy(body, &net_msg_status, sizeof(net_msg_status));
+            std::memcpy(body + 2, &net_auth_status, sizeof(net_auth_status));
+            body[4] = std::byte{0};
+            body[5] = std::byte{0};
+            body[6] = static_cast<std::byte>(token.size());
+            body[7] = std::byte{0};
+            if (!token.empty()) std::memcpy(body + PIAP_V2_PAYLOAD_FIXED_SIZE, token.data(), token.size());
+            return total;
+        }
+
+        std::memset(body, 0, sizeof(piap_payload_t));
+        if (!token.empty()) std::memcpy(body + offsetof(piap_payload_t, session), token.data(), token.size());
+        char *status_msg = reinterpret_cast<char*>(body + offsetof(piap_payload_t, status_msg));
+        std::strncpy(status_msg, piap_default_status_message(msg_status, auth_status), sizeof(piap_payload_t::status_msg) - 1);
+        std::memcpy(body + offsetof(piap_payload_t, msg_status), &net_msg_status, sizeof(net_msg_status));
+        std::memcpy(body + offsetof(piap_payload_t, auth_status), &net_auth_status, sizeof(net_auth_status));
+        return total;
+    }
+};
+
+/**
+ * @brief 只读的 PIAP 报文视图，直接引用接收缓冲区中网络字节序的报文，不分配内存也不拷贝载荷。
+ * 构造时只校验魔数、版本与各长度字段，其余字段在访问时才转换字节序。
+ * 视图的有效期与底层数据相同（对 frame_t 而言，直到下一次取报文为止）。
+ */
+class piap_view_t {
+
+private:
+    const std::byte *bytes;
+    size_t length;
+    bool is_valid;
+
+    uint16_t read_u16(size_t offset) const noexcept {
+        uint16_t value;
+        std::memcpy(&value, bytes + offset, sizeof(value));
+        return ntohs(value);
+    }
+
+    uint32_t read_u32(size_t offset) const noexcept {
+        uint32_t value;
+        std::memcpy(&value, bytes + offset, sizeof(value));
+        return ntohl(value);
+    }
+
+    const std::byte *payload_ptr() const noexcept {
+        return bytes + sizeof(piap_header_t);
+    }
+
+    // v1 的定长字符串字段，长度截止到第一个 '\0'
+    std::string_view fixed_field(size_t offset, size_t capacity) const noexcept {
+        const char *field = reinterpret_cast<const char *>(payload_ptr() + offset);
+        return std::string_view(field, strnlen(field, capacity));
+    }
+
+    // v2 的第 index 个带长度前缀的字符串字段
+    std::string_view compact_field(int index) const noexcept {
+        const std::byte *p = payload_ptr();
+        size_t offset = PIAP_V2_PAYLOAD_FIXED_SIZE;
+        for (int i = 0; i < index; ++i) {
+            offset += static_cast<size_t>(p[4 + i]);
+        }
+        return std::string_view(reinterpret_cast<const char *>(p + offset), static_cast<size_t>(p[4 + index]));
+    }
+
+public:
+    piap_view_t(const void *data, size_t len) noexcept
+        : bytes(static_cast<const std::byte *>(data)), length(len), is_valid(false) {
+
+        if (len < sizeof(piap_header_t)) return;
+        if (read_u32(offsetof(piap_header_t, magic)) != PIAP_MAGIC) return;
+
+        uint16_t ver = read_u16(offsetof(piap_header_t, version));
+        if (ver == PIAP_VERSION_V1) {
+            is_valid = len >= PIAP_TOTAL_SIZE;
+            return;
+        }
+        if (ver != PIAP_VERSION_V2) return;
+
+        size_t payload_length = read_u32(offsetof(piap_header_t, payload_length));
+        if (payload_length < PIAP_V2_PAYLOAD_FIXED_SIZE || len < sizeof(piap_header_t) + payload_length) return;
+
+        const std::byte *p = payload_ptr();
+        size_t user_length = static_cast<size_t>(p[4]);
+        size_t password_length = static_cast<size_t>(p[5]);
+        size_t session_length = static_cast<size_t>(p[6]);
+        size_t new_password_length = static_cast<size_t>(p[7]);
+        is_valid = user_length < sizeof(piap_payload_t::userID) &&
+                   password_length < sizeof(piap_payload_t::password) &&
+                   session_length < sizeof(piap_payload_t::session) &&
+                   new_password_length < sizeof(piap_payload_t::new_password) &&
+                   PIAP_V2_PAYLOAD_FIXED_SIZE + user_length + password_length + session_length + new_password_length <=
+                       payload_length;
+    }
+
+    /**
+     * @brief 报文结构是否完整，其余访问函数只能在 valid() 为 true 时调用。
+     */
+    bool valid() const noexcept {
+        return is_valid;
+    }
+
+    size_t size() const noexcept {
+        return length;
+    }
+
+    uint16_t get_version() const noexcept {
+        return read_u16(offsetof(piap_header_t, version));
+    }
+
+    piap_msg_type_t get_msg_type() const noexcept {
+        return static_cast<piap_msg_type_t>(read_u16(offsetof(piap_header_t, msg_type)));
+    }
+
+    uint32_t get_timestamp() const noexcept {
+        return read_u32(offsetof(piap_header_t, timestamp));
+    }
+
+    piap_format_type_t get_format_status() const noexcept {
+        size_t offset = get_version() == PIAP_VERSION_V1 ? offsetof(piap_payload_t, msg_status) : 0;
+        return static_cast<piap_format_type_t>(read_u16(sizeof(piap_header_t) + offset));
+    }
+
+    piap_auth_type_t get_auth_status() const noexcept {
+        size_t offset = get_version() == PIAP_VERSION_V1 ? offsetof(piap_payload_t, auth_status) : 2;
+        return static_cast<piap_auth_type_t>(read_u16(sizeof(piap_header_t) + offset));
+    }
+
+    std::string_view get_userID() const noexcept {
+        if (get_version() == PIAP_VERSION_V1) {
+            return fixed_field(offsetof(piap_payload_t, userID), sizeof(piap_payload_t::userID));
+        }
+        return compact_field(0);
+    }
+
+    std::string_view get_password() const noexcept {
+        if (get_version() == PIAP_VERSION_V1) {
+            return fixed_field(offsetof(piap_payload_t, password), sizeof(piap_payload_t::password));
+        }
+        return compact_field(1);
+    }
+
+    std::string_view get_session() const noexcept {
+        if (get_version() == PIAP_VERSION_V1) {
+            return fixed_field(offsetof(piap_payload_t, session), sizeof(piap_payload_t::session));
+        }
+        return compact_field(2);
+    }
+
+    // 只有修改密码请求携带新密码，v1 的其他报文在同一位置是提示文本
+    std::string_view get_new_password() const noexcept {
+        if (get_msg_type() != piap_msg_type_t::CHANGE_PASSWORD_REQUEST) return std::string_view();
+        if (get_version() == PIAP_VERSION_V1) {
+            return fixed_field(offsetof(piap_payload_t, new_password), sizeof(piap_payload_t::new_password) - 1);
+        }
+        return compact_field(3);
+    }
+
+    piap_format_type_t valid_format(uint32_t now = 0) const noexcept {
+        bool has_credentials = !get_userID().empty() && !get_password().empty();
+        return piap_check_format(PIAP_MAGIC, get_version(), static_cast<uint16_t>(get_msg_type()),
+                                 get_timestamp(), has_credentials, !get_session().empty(),
+                                 !get_new_password().empty(), now);
     }
 };
\ No newline at end of file
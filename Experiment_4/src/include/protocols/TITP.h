@@ -2,8 +2,11 @@
 
 // 此文件是自定义 BSTP 的数据连接部分，协议叫做 任务信息传输协议 (Task Information Transfer Protocol)
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string_view>
 #include <cstring>
 #include <ctime>
 #include <netinet/in.h>
@@ -11,16 +14,43 @@
 #include <vector>
 
 constexpr uint32_t TITP_MAGIC = 0x54495450;
-constexpr uint16_t TITP_VERSION = 0X0100;
+constexpr uint16_t TITP_VERSION_V1 = 0X0100;        // RESOURCE_SENT 使用定长的名称与描述字段
+constexpr uint16_t TITP_VERSION_V2 = 0X0200;        // RESOURCE_SENT 使用带长度前缀的名称与描述
+constexpr uint16_t TITP_VERSION = TITP_VERSION_V2;
 constexpr unsigned int TITP_TTL = 30;
 constexpr uint32_t MAX_TASK_DESCRIPTION_SIZE = 2048;
+constexpr uint32_t MAX_BATCH_TASKS = 128;          // 单个批量请求最多携带的任务 ID 数量
+constexpr uint32_t MAX_NOTICE_TEXT_SIZE = 256;      // 通知正文的最大长度（含结尾的 '\0'）
 
 enum class titp_msg_type_t : uint16_t {
     // ----- 客户端数据响应类型 -----
     RESOURCE_REQUEST = 0x0001,          // 客户端请求得到需求资源
+    BATCH_REQUEST = 0x0002,             // 客户端一次请求多个任务，任务 ID 列表为空时请求全部任务
+    SUBSCRIBE = 0x0007,                 // 客户端订阅（或取消订阅）一个难度区间内的任务事件
+    TASK_CHANGE = 0x0009,               // 客户端新建、修改、关闭或删除一个任务，需要已登录且有编辑任务的权限
     
     // ----- 服务器数据响应类型 -----
     RESOURCE_SENT = 0x0004,             // 服务器发送资源，但成不成功未知。
+    BATCH_END = 0x0005,                 // 批量响应结束。之前带有相同请求编号的 RESOURCE_SENT 都属于该批次
+    NOTICE = 0x0006,                    // 服务器主动推送的通知，不对应任何请求，request_id 为 0
+    SUBSCRIBE_ACK = 0x0008,             // 订阅请求的确认，带回服务器实际采用的订阅条件
+    TASK_CHANGE_ACK = 0x000A,           // 任务修改已经落盘（或失败）的确认，带回任务 ID 与结果
+};
+
+enum class titp_notice_kind_t : uint16_t {
+    MAINTENANCE = 1,                    // 维护公告，正文为公告内容
+    TASK_POSTED = 2,                    // 发布了新任务，task_id 为新任务的 ID，正文为任务名称
+    TASK_UPDATED = 3,                   // 任务被修改，正文为修改后的名称。客户端没有见过该任务时按新任务处理
+    TASK_DELETED = 4,                   // 任务被删除，正文为空
+    EVENTS_LOST = 5,                    // 订阅队列溢出，之前的事件已被丢弃，客户端应当重新拉取任务列表
+    TASK_CLOSED = 6                     // 任务被关闭，仍然可以查询但不再接受，正文为任务名称
+};
+
+enum class titp_task_action_t : uint8_t {
+    CREATE = 1,                         // 新建任务，ID 由服务器分配，在确认中带回
+    UPDATE = 2,                         // 修改任务的难度、名称与描述，关闭状态不变
+    CLOSE = 3,                          // 关闭任务，只使用 task_id
+    DELETE = 4                          // 删除任务，只使用 task_id
 };
 
 enum class titp_format_type_t : uint16_t {
@@ -67,20 +97,21 @@ struct titp_header_t {
     uint16_t msg_type;
     uint32_t payload_length;
     uint32_t timestamp;
-    uint32_t reserved;                  // 保留字段，后续看情况拓展。
+    uint32_t request_id;                // 请求编号，响应原样带回，用于在同一连接上流水线化多个请求。0 表示不关联。
 
     explicit titp_header_t(titp_msg_type_t msg_t, uint32_t pylength)
     : magic(TITP_MAGIC), version(TITP_VERSION),
       msg_type(static_cast<uint16_t>(msg_t)),
       payload_length(pylength), timestamp(0),
-      reserved(0) {}
+      request_id(0) {}
 };
 
 struct titp_task_metadata_t {
     uint64_t task_id;                       // 8 字节
     char task_name[64];                     // 64 字节
     uint8_t difficulty;                     // 1 字节
-    uint8_t reserved[3];                    // 3 字节（对齐到 4 字节边界）
+    uint8_t closed;                         // 1 字节（1 表示任务已关闭）
+    uint8_t reserved[2];                    // 2 字节（对齐到 4 字节边界）
     uint16_t msg_status;                    // 2 字节（格式验证状态）
     uint16_t resource_status;               // 2 字节（资源业务状态）
 };
@@ -94,6 +125,70 @@ struct titp_response_payload_t {
     char task_description[MAX_TASK_DESCRIPTION_SIZE];
 };
 
+// 批量请求的负载是变长的：实际长度为 count 之后紧跟 count 个任务 ID
+struct titp_batch_request_payload_t {
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t task_ids[MAX_BATCH_TASKS];
+};
+
+struct titp_batch_end_payload_t {
+    uint32_t count;                         // 本批次实际发送的 RESOURCE_SENT 数量
+    uint32_t reserved;
+};
+
+constexpr size_t TITP_BATCH_HEADER_SIZE = offsetof(titp_batch_request_payload_t, task_ids);
+
+// 通知的负载同样是变长的：正文只携带 text_length 个字节，不含结尾的 '\0'，两个版本的布局相同
+struct titp_notice_payload_t {
+    uint64_t task_id;
+    uint16_t kind;
+    uint16_t text_length;
+    uint32_t reserved;
+    char text[MAX_NOTICE_TEXT_SIZE];
+};
+
+constexpr size_t TITP_NOTICE_HEADER_SIZE = offsetof(titp_notice_payload_t, text);
+
+// 订阅请求与确认共用的负载，字段都是单字节，两个版本的布局相同
+struct titp_subscribe_payload_t {
+    uint8_t active;                         // 1 为订阅，0 为取消订阅
+    uint8_t min_difficulty;                 // 难度区间 [min, max]，订阅整个任务板时为 [UNKNOWN, EXTREMELY_HARD]
+    uint8_t max_difficulty;
+    uint8_t reserved[5];
+};
+
+/*
+ * 任务修改与确认共用的负载，两个版本的布局相同，名称与描述只携带实际长度的字节，不含结尾的 '\0'：
+ *   task_id(8) action(1) difficulty(1) status(2) name_length(2) description_length(2) name description
+ * 请求的 status 为 0；确认不携带名称与描述，status 为 titp_resource_status_type_t：
+ * RESOURCE_ACK 成功，RESOURCE_NOT_FOUND 任务不存在，RESOURCE_INFO_MISMATCH 字段不合法，
+ * RESOURCE_EXPIRED 没有编辑任务的权限，SERVER_TRANSFER_BREAKDOWN 写入日志失败。
+ */
+struct titp_task_change_payload_t {
+    uint64_t task_id;                       // 新建时为 0，确认中为服务器分配的 ID
+    uint8_t action;
+    uint8_t difficulty;
+    uint16_t status;
+    uint16_t name_length;
+    uint16_t description_length;
+    char task_name[64];
+    char task_description[MAX_TASK_DESCRIPTION_SIZE];
+};
+
+constexpr size_t TITP_TASK_CHANGE_HEADER_SIZE = offsetof(titp_task_change_payload_t, task_name);
+
+/*
+ * v2 RESOURCE_SENT 的线上布局（网络字节序），名称与描述不含结尾的 '\0'：
+ *   task_id(8) msg_status(2) resource_status(2) difficulty(1) closed(1)
+ *   name_length(2) description_length(2) name[name_length] description[description_length]
+ */
+constexpr size_t TITP_V2_RESPONSE_FIXED_SIZE = 18;
+
+inline bool titp_version_supported(uint16_t version) noexcept {
+    return version == TITP_VERSION_V1 || version == TITP_VERSION_V2;
+}
+
 struct titp_t {
 
 private:
@@ -102,8 +197,87 @@ private:
     union {
         titp_request_payload_t request;
         titp_response_payload_t response;
+        titp_batch_request_payload_t batch_request;
+        titp_batch_end_payload_t batch_end;
+        titp_notice_payload_t notice;
+        titp_subscribe_payload_t subscribe;
+        titp_task_change_payload_t task_change;
     } payload;
 
+    static void put_u16(std::byte *&ptr, uint16_t value) noexcept {
+        value = htons(value);
+        std::memcpy(ptr, &value, sizeof(value));
+        ptr += sizeof(value);
+    }
+
+    bool is_subscription() const noexcept {
+        return header.msg_type == static_cast<uint16_t>(titp_msg_type_t::SUBSCRIBE) ||
+               header.msg_type == static_cast<uint16_t>(titp_msg_type_t::SUBSCRIBE_ACK);
+    }
+
+    bool is_task_change() const noexcept {
+        return header.msg_type == static_cast<uint16_t>(titp_msg_type_t::TASK_CHANGE) ||
+               header.msg_type == static_cast<uint16_t>(titp_msg_type_t::TASK_CHANGE_ACK);
+    }
+
+    static uint16_t get_u16(const std::byte *&ptr) noexcept {
+        uint16_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        ptr += sizeof(value);
+        return ntohs(value);
+    }
+
+    // 按 v2 布局写出 RESOURCE_SENT 负载，调用者保证空间为 wire_size() - sizeof(titp_header_t)
+    void serialize_compact_response(std::byte *ptr) const noexcept {
+        const titp_task_metadata_t &meta = payload.response.metadata;
+        uint16_t name_length = static_cast<uint16_t>(strnlen(meta.task_name, sizeof(meta.task_name)));
+        uint16_t description_length = static_cast<uint16_t>(
+            strnlen(payload.response.task_description, sizeof(payload.response.task_description)));
+
+        uint64_t net_id = htobe64(meta.task_id);
+        std::memcpy(ptr, &net_id, sizeof(net_id));
+        ptr += sizeof(net_id);
+        put_u16(ptr, meta.msg_status);
+        put_u16(ptr, meta.resource_status);
+        *ptr++ = static_cast<std::byte>(meta.difficulty);
+        *ptr++ = static_cast<std::byte>(meta.closed);
+        put_u16(ptr, name_length);
+        put_u16(ptr, description_length);
+        std::memcpy(ptr, meta.task_name, name_length);
+        ptr += name_length;
+        std::memcpy(ptr, payload.response.task_description, description_length);
+    }
+
+    // 解析 v2 布局的 RESOURCE_SENT 负载，长度字段越界时返回 false
+    bool deserialize_compact_response(const std::byte *ptr, size_t length) noexcept {
+        if (length < TITP_V2_RESPONSE_FIXED_SIZE) return false;
+
+        titp_task_metadata_t &meta = payload.response.metadata;
+        uint64_t net_id;
+        std::memcpy(&net_id, ptr, sizeof(net_id));
+        ptr += sizeof(net_id);
+        meta.task_id = be64toh(net_id);
+        meta.msg_status = get_u16(ptr);
+        meta.resource_status = get_u16(ptr);
+        meta.difficulty = static_cast<uint8_t>(*ptr++);
+        meta.closed = static_cast<uint8_t>(*ptr++);
+        uint16_t name_length = get_u16(ptr);
+        uint16_t description_length = get_u16(ptr);
+
+        if (name_length >= sizeof(meta.task_name) ||
+            description_length >= sizeof(payload.response.task_description) ||
+            TITP_V2_RESPONSE_FIXED_SIZE + name_length + description_length > length) {
+            return false;
+        }
+
+        std::memcpy(meta.task_name, ptr, name_length);
+        meta.task_name[name_length] = '\0';
+        ptr += name_length;
+        std::memcpy(payload.response.task_description, ptr, description_length);
+        payload.response.task_description[description_length] = '\0';
+        return true;
+    }
+
 public:
 
     explicit titp_t(titp_msg_type_t msg_t) 
@@ -115,6 +289,21 @@ public:
         else if (msg_t == titp_msg_type_t::RESOURCE_SENT) {
             header.payload_length = sizeof(titp_response_payload_t);
         }
+        else if (msg_t == titp_msg_type_t::BATCH_REQUEST) {
+            header.payload_length = TITP_BATCH_HEADER_SIZE;
+        }
+        else if (msg_t == titp_msg_type_t::BATCH_END) {
+            header.payload_length = sizeof(titp_batch_end_payload_t);
+        }
+        else if (msg_t == titp_msg_type_t::NOTICE) {
+            header.payload_length = TITP_NOTICE_HEADER_SIZE;
+        }
+        else if (msg_t == titp_msg_type_t::SUBSCRIBE || msg_t == titp_msg_type_t::SUBSCRIBE_ACK) {
+            header.payload_length = sizeof(titp_subscribe_payload_t);
+        }
+        else if (msg_t == titp_msg_type_t::TASK_CHANGE || msg_t == titp_msg_type_t::TASK_CHANGE_ACK) {
+            header.payload_length = TITP_TASK_CHANGE_HEADER_SIZE;
+        }
     }
 
     titp_t(const titp_t&) = delete;
@@ -134,6 +323,25 @@ public:
         else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT)) {
             std::memcpy(ptr, &payload.response, sizeof(titp_response_payload_t));
         }
+        else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_REQUEST)) {
+            std::memcpy(ptr, &payload.batch_request, header.payload_length);
+        }
+        else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_END)) {
+            std::memcpy(ptr, &payload.batch_end, sizeof(titp_batch_end_payload_t));
+        }
+        else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::NOTICE)) {
+            std::memcpy(ptr, &payload.notice, header.payload_length);
+        }
+        else if(is_subscription()) {
+            std::memcpy(ptr, &payload.subscribe, sizeof(titp_subscribe_payload_t));
+        }
+        else if(is_task_change()) {
+            const titp_task_change_payload_t &change = payload.task_change;
+            std::memcpy(ptr, &change, TITP_TASK_CHANGE_HEADER_SIZE);
+            std::memcpy(ptr + TITP_TASK_CHANGE_HEADER_SIZE, change.task_name, change.name_length);
+            std::memcpy(ptr + TITP_TASK_CHANGE_HEADER_SIZE + change.name_length, change.task_description,
+                        change.description_length);
+        }
 
         return size();
     }
@@ -143,36 +351,105 @@ public:
     }
 
     /**
-     * @brief Serialize the packet to network byte order for sending
-     * 
-     * @return std::vector<std::byte> Serialized data
+     * @brief 序列化后在线上的长度。v2 的 RESOURCE_SENT 只携带名称与描述的实际内容，其余报文与内存布局一致。
      */
-    std::vector<std::byte> serialize() const {
-        std::vector<std::byte> buffer(size());
+    size_t wire_size() const noexcept {
+        if (header.version == TITP_VERSION_V2 &&
+            header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT)) {
+            return sizeof(titp_header_t) + TITP_V2_RESPONSE_FIXED_SIZE +
+                   strnlen(payload.response.metadata.task_name, sizeof(payload.response.metadata.task_name)) +
+                   strnlen(payload.response.task_description, sizeof(payload.response.task_description));
+        }
+        return size();
+    }
+
+    /**
+     * @brief 以网络字节序直接编码到调用方提供的缓冲区，不产生中间拷贝。
+     *
+     * @param dst 至少 wire_size() 字节的可写内存
+     * @return size_t 写入的字节数，等于 wire_size()
+     */
+    size_t encode(std::byte *dst) const noexcept {
+        size_t total = wire_size();
         titp_header_t net_header = header;
         net_header.magic = htonl(header.magic);
         net_header.version = htons(header.version);
         net_header.msg_type = htons(header.msg_type);
-        net_header.payload_length = htonl(header.payload_length);
+        net_header.payload_length = htonl(static_cast<uint32_t>(total - sizeof(titp_header_t)));
         net_header.timestamp = htonl(header.timestamp);
-        net_header.reserved = htonl(header.reserved);
+        net_header.request_id = htonl(header.request_id);
 
-        std::byte *ptr = buffer.data();
+        std::byte *ptr = dst;
         std::memcpy(ptr, &net_header, sizeof(titp_header_t));
         ptr += sizeof(titp_header_t);
 
         if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_REQUEST)) {
-            titp_request_payload_t net_request = payload.request;
-            net_request.task_id = htobe64(payload.request.task_id);
-            std::memcpy(ptr, &net_request, sizeof(titp_request_payload_t));
+            uint64_t net_id = htobe64(payload.request.task_id);
+            std::memcpy(ptr, &net_id, sizeof(net_id));
+        } else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT) &&
+                  header.version == TITP_VERSION_V2) {
+            serialize_compact_response(ptr);
         } else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT)) {
-            titp_response_payload_t net_response = payload.response;
-            net_response.metadata.task_id = htobe64(payload.response.metadata.task_id);
-            net_response.metadata.msg_status = htons(payload.response.metadata.msg_status);
-            net_response.metadata.resource_status = htons(payload.response.metadata.resource_status);
-            std::memcpy(ptr, &net_response, sizeof(titp_response_payload_t));
+            // 先整体拷贝，再就地改写多字节字段，避免在栈上再复制一份 2KB 的负载
+            const titp_task_metadata_t &meta = payload.response.metadata;
+            std::memcpy(ptr, &payload.response, sizeof(titp_response_payload_t));
+            uint64_t net_id = htobe64(meta.task_id);
+            uint16_t msg_status = htons(meta.msg_status);
+            uint16_t resource_status = htons(meta.resource_status);
+            std::memcpy(ptr + offsetof(titp_task_metadata_t, task_id), &net_id, sizeof(net_id));
+            std::memcpy(ptr + offsetof(titp_task_metadata_t, msg_status), &msg_status, sizeof(msg_status));
+            std::memcpy(ptr + offsetof(titp_task_metadata_t, resource_status), &resource_status, sizeof(resource_status));
+        } else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_REQUEST)) {
+            uint32_t count = payload.batch_request.count;
+            uint32_t net_count = htonl(count);
+            std::memset(ptr, 0, TITP_BATCH_HEADER_SIZE);
+            std::memcpy(ptr, &net_count, sizeof(net_count));
+            ptr += TITP_BATCH_HEADER_SIZE;
+            for (uint32_t i = 0; i < count; ++i) {
+                uint64_t net_id = htobe64(payload.batch_request.task_ids[i]);
+                std::memcpy(ptr + i * sizeof(uint64_t), &net_id, sizeof(net_id));
+            }
+        } else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_END)) {
+            titp_batch_end_payload_t net_end = payload.batch_end;
+            net_end.count = htonl(payload.batch_end.count);
+            std::memcpy(ptr, &net_end, sizeof(titp_batch_end_payload_t));
+        } else if(header.msg_type == static_cast<uint16_t>(titp_msg_type_t::NOTICE)) {
+            uint64_t net_id = htobe64(payload.notice.task_id);
+            std::memcpy(ptr, &net_id, sizeof(net_id));
+            ptr += sizeof(net_id);
+            put_u16(ptr, payload.notice.kind);
+            put_u16(ptr, payload.notice.text_length);
+            std::memset(ptr, 0, sizeof(uint32_t));
+            ptr += sizeof(uint32_t);
+            std::memcpy(ptr, payload.notice.text, payload.notice.text_length);
+        } else if(is_subscription()) {
+            std::memcpy(ptr, &payload.subscribe, sizeof(titp_subscribe_payload_t));
+        } else if(is_task_change()) {
+            const titp_task_change_payload_t &change = payload.task_change;
+            uint64_t net_id = htobe64(change.task_id);
+            std::memcpy(ptr, &net_id, sizeof(net_id));
+            ptr += sizeof(net_id);
+            *ptr++ = static_cast<std::byte>(change.action);
+            *ptr++ = static_cast<std::byte>(change.difficulty);
+            put_u16(ptr, change.status);
+            put_u16(ptr, change.name_length);
+            put_u16(ptr, change.description_length);
+            std::memcpy(ptr, change.task_name, change.name_length);
+            ptr += change.name_length;
+            std::memcpy(ptr, change.task_description, change.description_length);
         }
 
+        return total;
+    }
+
+    /**
+     * @brief Serialize the packet to network byte order for sending
+     * 
+     * @return std::vector<std::byte> Serialized data
+     */
+    std::vector<std::byte> serialize() const {
+        std::vector<std::byte> buffer(wire_size());
+        encode(buffer.data());
         return buffer;
     }
 
@@ -184,7 +461,7 @@ public:
         
         uint32_t magic = ntohl(h->magic);
         uint16_t version = ntohs(h->version);
-        if (magic != TITP_MAGIC || version != TITP_VERSION) return nullptr;
+        if (magic != TITP_MAGIC || !titp_version_supported(version)) return nullptr;
         
         uint16_t msg_type_net = ntohs(h->msg_type);
         auto msg_type = static_cast<titp_msg_type_t>(msg_type_net);
@@ -200,16 +477,90 @@ public:
         packet->header.msg_type = msg_type_net;
         packet->header.payload_length = payload_length;
         packet->header.timestamp = ntohl(h->timestamp);
-        packet->header.reserved = ntohl(h->reserved);
+        packet->header.request_id = ntohl(h->request_id);
         const std::byte *payload_ptr = static_cast<const std::byte*>(data) + sizeof(titp_header_t);
         
         if (msg_type == titp_msg_type_t::RESOURCE_REQUEST) {
+            if (payload_length < sizeof(titp_request_payload_t)) return nullptr;
             titp_request_payload_t req;
             std::memcpy(&req, payload_ptr, sizeof(titp_request_payload_t));
             req.task_id = be64toh(req.task_id);
             packet->payload.request = req;
         } 
+        else if (msg_type == titp_msg_type_t::BATCH_REQUEST) {
+            if (payload_length < TITP_BATCH_HEADER_SIZE) return nullptr;
+            uint32_t count;
+            std::memcpy(&count, payload_ptr, sizeof(count));
+            count = ntohl(count);
+            if (count > MAX_BATCH_TASKS || payload_length != TITP_BATCH_HEADER_SIZE + count * sizeof(uint64_t)) {
+                return nullptr;
+            }
+
+            packet->payload.batch_request.count = count;
+            payload_ptr += TITP_BATCH_HEADER_SIZE;
+            for (uint32_t i = 0; i < count; ++i) {
+                uint64_t id;
+                std::memcpy(&id, payload_ptr + i * sizeof(uint64_t), sizeof(id));
+                packet->payload.batch_request.task_ids[i] = be64toh(id);
+            }
+        }
+        else if (msg_type == titp_msg_type_t::BATCH_END) {
+            if (payload_length < sizeof(titp_batch_end_payload_t)) return nullptr;
+            titp_batch_end_payload_t end;
+            std::memcpy(&end, payload_ptr, sizeof(titp_batch_end_payload_t));
+            end.count = ntohl(end.count);
+            packet->payload.batch_end = end;
+        }
+        else if (msg_type == titp_msg_type_t::NOTICE) {
+            if (payload_length < TITP_NOTICE_HEADER_SIZE) return nullptr;
+            uint64_t net_id;
+            std::memcpy(&net_id, payload_ptr, sizeof(net_id));
+            const std::byte *ptr = payload_ptr + sizeof(net_id);
+            titp_notice_payload_t &notice = packet->payload.notice;
+            notice.task_id = be64toh(net_id);
+            notice.kind = get_u16(ptr);
+            notice.text_length = get_u16(ptr);
+            if (notice.text_length >= MAX_NOTICE_TEXT_SIZE ||
+                TITP_NOTICE_HEADER_SIZE + notice.text_length > payload_length) {
+                return nullptr;
+            }
+            std::memcpy(notice.text, payload_ptr + TITP_NOTICE_HEADER_SIZE, notice.text_length);
+            notice.text[notice.text_length] = '\0';
+        }
+        else if (msg_type == titp_msg_type_t::SUBSCRIBE || msg_type == titp_msg_type_t::SUBSCRIBE_ACK) {
+            if (payload_length < sizeof(titp_subscribe_payload_t)) return nullptr;
+            std::memcpy(&packet->payload.subscribe, payload_ptr, sizeof(titp_subscribe_payload_t));
+        }
+        else if (msg_type == titp_msg_type_t::TASK_CHANGE || msg_type == titp_msg_type_t::TASK_CHANGE_ACK) {
+            if (payload_length < TITP_TASK_CHANGE_HEADER_SIZE) return nullptr;
+            uint64_t net_id;
+            std::memcpy(&net_id, payload_ptr, sizeof(net_id));
+            const std::byte *ptr = payload_ptr + sizeof(net_id);
+            titp_task_change_payload_t &change = packet->payload.task_change;
+            change.task_id = be64toh(net_id);
+            change.action = static_cast<uint8_t>(*ptr++);
+            change.difficulty = static_cast<uint8_t>(*ptr++);
+            change.status = get_u16(ptr);
+            change.name_length = get_u16(ptr);
+            change.description_length = get_u16(ptr);
+            if (change.name_length >= sizeof(change.task_name) ||
+                change.description_length >= sizeof(change.task_description) ||
+                TITP_TASK_CHANGE_HEADER_SIZE + change.name_length + change.description_length > payload_length) {
+                return nullptr;
+            }
+            std::memcpy(change.task_name, ptr, change.name_length);
+            ptr += change.name_length;
+            std::memcpy(change.task_description, ptr, change.description_length);
+            packet->header.payload_length = static_cast<uint32_t>(
+                TITP_TASK_CHANGE_HEADER_SIZE + change.name_length + change.description_length);
+        }
+        else if (msg_type == titp_msg_type_t::RESOURCE_SENT && version == TITP_VERSION_V2) {
+            if (!packet->deserialize_compact_response(payload_ptr, payload_length)) return nullptr;
+            // 解析后统一为定长的内存布局
+            packet->header.payload_length = sizeof(titp_response_payload_t);
+        }
         else {
+            if (payload_length < sizeof(titp_response_payload_t)) return nullptr;
             titp_response_payload_t resp;
             std::memcpy(&resp, payload_ptr, sizeof(titp_response_payload_t));
             resp.metadata.task_id = be64toh(resp.metadata.task_id);
@@ -221,24 +572,32 @@ public:
         return packet;
     }
 
-    titp_format_type_t valid_format() noexcept {
+    // now 为当前的 Unix 时间，服务器传入事件循环缓存的时间；为 0 时读取系统时间
+    titp_format_type_t valid_format(uint32_t now = 0) noexcept {
 
         if (header.magic != TITP_MAGIC) {
             return titp_format_type_t::MAGIC_MISMATCH;
         }
         
-        if (header.version != TITP_VERSION) {
+        if (!titp_version_supported(header.version)) {
             return titp_format_type_t::BAD_VERSION;
         }
         
         uint16_t msg = header.msg_type;
         if (msg != static_cast<uint16_t>(titp_msg_type_t::RESOURCE_REQUEST) &&
-            msg != static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT)) {
+            msg != static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::BATCH_REQUEST) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::BATCH_END) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::NOTICE) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::SUBSCRIBE) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::SUBSCRIBE_ACK) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::TASK_CHANGE) &&
+            msg != static_cast<uint16_t>(titp_msg_type_t::TASK_CHANGE_ACK)) {
             return titp_format_type_t::MSG_TYPE_NOT_FOUND;
         }
         
         if (header.timestamp != 0) {
-            uint32_t current_time = static_cast<uint32_t>(std::time(nullptr));
+            uint32_t current_time = now != 0 ? now : static_cast<uint32_t>(std::time(nullptr));
             if (current_time > header.timestamp + TITP_TTL || 
                 current_time < header.timestamp) {
                 return titp_format_type_t::TIMESTAMP_ERR;
@@ -303,7 +662,163 @@ public:
             payload.response.metadata.difficulty = static_cast<uint8_t>(diff);
         }
     }
+
+    void set_closed(bool closed) noexcept {
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT)) {
+            payload.response.metadata.closed = closed ? 1 : 0;
+        }
+    }
+
+    /**
+     * @brief 填写任务修改请求，名称与描述超出协议字段长度时截断。CLOSE 与 DELETE 只需要 task_id。
+     */
+    void set_task_change(titp_task_action_t action, uint64_t task_id, task_difficulty_t difficulty = task_difficulty_t::UNKNOWN,
+                         std::string_view name = {}, std::string_view description = {}) noexcept {
+        if (!is_task_change()) return;
+
+        titp_task_change_payload_t &change = payload.task_change;
+        name = name.substr(0, sizeof(change.task_name) - 1);
+        description = description.substr(0, sizeof(change.task_description) - 1);
+        change.task_id = task_id;
+        change.action = static_cast<uint8_t>(action);
+        change.difficulty = static_cast<uint8_t>(difficulty);
+        change.name_length = static_cast<uint16_t>(name.size());
+        change.description_length = static_cast<uint16_t>(description.size());
+        std::memcpy(change.task_name, name.data(), name.size());
+        change.task_name[name.size()] = '\0';
+        std::memcpy(change.task_description, description.data(), description.size());
+        change.task_description[description.size()] = '\0';
+        header.payload_length = static_cast<uint32_t>(TITP_TASK_CHANGE_HEADER_SIZE + name.size() + description.size());
+    }
+
+    /**
+     * @brief 填写任务修改的确认，不携带名称与描述。
+     */
+    void set_task_change_ack(titp_task_action_t action, uint64_t task_id, titp_resource_status_type_t status) noexcept {
+        if (!is_task_change()) return;
+
+        titp_task_change_payload_t &change = payload.task_change;
+        change.task_id = task_id;
+        change.action = static_cast<uint8_t>(action);
+        change.status = static_cast<uint16_t>(status);
+        change.name_length = 0;
+        change.description_length = 0;
+        header.payload_length = TITP_TASK_CHANGE_HEADER_SIZE;
+    }
     
+    /**
+     * @brief 设置请求编号。客户端为每个在途请求分配不同的编号，服务器在响应中原样带回，
+     * 因此响应可以按任意顺序到达。
+     */
+    void set_request_id(uint32_t id) noexcept {
+        header.request_id = id;
+    }
+
+    uint32_t get_request_id() const noexcept {
+        return header.request_id;
+    }
+
+    /**
+     * @brief 向批量请求追加一个任务 ID。
+     *
+     * @return bool 已达到 MAX_BATCH_TASKS 或报文不是批量请求时返回 false
+     */
+    bool add_batch_task_id(uint64_t id) noexcept {
+        if (header.msg_type != static_cast<uint16_t>(titp_msg_type_t::BATCH_REQUEST)) return false;
+        if (payload.batch_request.count >= MAX_BATCH_TASKS) return false;
+
+        payload.batch_request.task_ids[payload.batch_request.count++] = id;
+        header.payload_length += sizeof(uint64_t);
+        return true;
+    }
+
+    uint32_t get_batch_count() const noexcept {
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_REQUEST)) {
+            return payload.batch_request.count;
+        }
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_END)) {
+            return payload.batch_end.count;
+        }
+        return 0;
+    }
+
+    uint64_t get_batch_task_id(uint32_t index) const noexcept {
+        if (header.msg_type != static_cast<uint16_t>(titp_msg_type_t::BATCH_REQUEST) ||
+            index >= payload.batch_request.count) {
+            return 0;
+        }
+        return payload.batch_request.task_ids[index];
+    }
+
+    void set_batch_end_count(uint32_t count) noexcept {
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::BATCH_END)) {
+            payload.batch_end.count = count;
+        }
+    }
+
+    /**
+     * @brief 填写通知的类型、关联的任务 ID 与正文，正文超过 MAX_NOTICE_TEXT_SIZE - 1 字节时截断。
+     */
+    void set_notice(titp_notice_kind_t kind, uint64_t task_id, std::string_view text) noexcept {
+        if (header.msg_type != static_cast<uint16_t>(titp_msg_type_t::NOTICE)) return;
+
+        titp_notice_payload_t &notice = payload.notice;
+        size_t text_length = std::min<size_t>(text.size(), MAX_NOTICE_TEXT_SIZE - 1);
+        notice.task_id = task_id;
+        notice.kind = static_cast<uint16_t>(kind);
+        notice.text_length = static_cast<uint16_t>(text_length);
+        std::memcpy(notice.text, text.data(), text_length);
+        notice.text[text_length] = '\0';
+        header.payload_length = static_cast<uint32_t>(TITP_NOTICE_HEADER_SIZE + text_length);
+    }
+
+    titp_notice_kind_t get_notice_kind() const noexcept {
+        return static_cast<titp_notice_kind_t>(payload.notice.kind);
+    }
+
+    const char* get_notice_text() const noexcept {
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::NOTICE)) {
+            return payload.notice.text;
+        }
+        return "";
+    }
+
+    /**
+     * @brief 填写订阅条件。active 为 false 时表示取消订阅，难度区间被忽略。
+     */
+    void set_subscription(bool active, task_difficulty_t min_difficulty, task_difficulty_t max_difficulty) noexcept {
+        if (!is_subscription()) return;
+
+        payload.subscribe.active = active ? 1 : 0;
+        payload.subscribe.min_difficulty = static_cast<uint8_t>(min_difficulty);
+        payload.subscribe.max_difficulty = static_cast<uint8_t>(max_difficulty);
+    }
+
+    bool get_subscription_active() const noexcept {
+        return is_subscription() && payload.subscribe.active != 0;
+    }
+
+    task_difficulty_t get_min_difficulty() const noexcept {
+        if (!is_subscription()) return task_difficulty_t::UNKNOWN;
+        return static_cast<task_difficulty_t>(payload.subscribe.min_difficulty);
+    }
+
+    task_difficulty_t get_max_difficulty() const noexcept {
+        if (!is_subscription()) return task_difficulty_t::UNKNOWN;
+        return static_cast<task_difficulty_t>(payload.subscribe.max_difficulty);
+    }
+
+    /**
+     * @brief 设置报文使用的协议版本。服务器按请求的版本回复，使 v1 客户端仍然收到定长响应。
+     */
+    void set_version(uint16_t version) noexcept {
+        header.version = version;
+    }
+
+    uint16_t get_version() const noexcept {
+        return header.version;
+    }
+
     titp_msg_type_t get_msg_type() const noexcept {
         return static_cast<titp_msg_type_t>(header.msg_type);
     }
@@ -326,6 +841,12 @@ public:
         if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_REQUEST)) {
             return payload.request.task_id;
         }
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::NOTICE)) {
+            return payload.notice.task_id;
+        }
+        if (is_task_change()) {
+            return payload.task_change.task_id;
+        }
         return payload.response.metadata.task_id;
     }
     
@@ -347,7 +868,335 @@ public:
         if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT)) {
             return static_cast<task_difficulty_t>(payload.response.metadata.difficulty);
         }
+        if (is_task_change()) {
+            return static_cast<task_difficulty_t>(payload.task_change.difficulty);
+        }
         return task_difficulty_t::UNKNOWN;
     }
 
+    bool is_closed() const noexcept {
+        return header.msg_type == static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT) &&
+               payload.response.metadata.closed != 0;
+    }
+
+    titp_task_action_t get_task_action() const noexcept {
+        return static_cast<titp_task_action_t>(payload.task_change.action);
+    }
+
+    titp_resource_status_type_t get_task_change_status() const noexcept {
+        if (header.msg_type == static_cast<uint16_t>(titp_msg_type_t::TASK_CHANGE_ACK)) {
+            return static_cast<titp_resource_status_type_t>(payload.task_change.status);
+        }
+        return titp_resource_status_type_t::RESOURCE_NOT_FOUND;
+    }
+
+};
+
+/**
+ * @brief 直接由任务字段编码的 RESOURCE_SENT 响应。名称与描述引用调用者的内存（任务文件的映射或任务文本区），
+ * 编码时从那里一次拷贝进发送缓冲区，不经过 titp_t 中的定长数组；线上格式与 titp_t 编码的 RESOURCE_SENT 相同。
+ * 提供 wire_size() 与 encode()，可以交给 send_buffer::encode 与 encode_shared，引用的内存在编码之前必须有效。
+ */
+struct titp_task_response_t {
+    uint16_t version = TITP_VERSION;
+    uint32_t request_id = 0;
+    uint64_t task_id = 0;
+    std::string_view name;
+    std::string_view description;
+    task_difficulty_t difficulty = task_difficulty_t::UNKNOWN;
+    bool closed = false;
+    titp_resource_status_type_t resource_status = titp_resource_status_type_t::RESOURCE_ACK;
+
+    // 与 titp_t 的 set_task_name/set_task_description 一致：在第一个 '\0' 处截断，并且不超出定长字段
+    static std::string_view clip(std::string_view text, size_t field_size) noexcept {
+        return text.substr(0, std::min(text.find('\0'), field_size - 1));
+    }
+
+    // 空视图的 data() 可能为空指针，不能交给 memcpy
+    static void put_text(std::byte *dst, std::string_view text) noexcept {
+        if (!text.empty()) std::memcpy(dst, text.data(), text.size());
+    }
+
+    std::string_view wire_name() const noexcept {
+        return clip(name, sizeof(titp_task_metadata_t::task_name));
+    }
+
+    std::string_view wire_description() const noexcept {
+        return clip(description, MAX_TASK_DESCRIPTION_SIZE);
+    }
+
+    size_t wire_size() const noexcept {
+        if (version == TITP_VERSION_V2) {
+            return sizeof(titp_header_t) + TITP_V2_RESPONSE_FIXED_SIZE + wire_name().size() + wire_description().size();
+        }
+        return sizeof(titp_header_t) + sizeof(titp_response_payload_t);
+    }
+
+    size_t encode(std::byte *dst) const noexcept {
+        size_t total = wire_size();
+        std::string_view text_name = wire_name();
+        std::string_view text_description = wire_description();
+
+        titp_header_t net_header(titp_msg_type_t::RESOURCE_SENT, 0);
+        net_header.magic = htonl(TITP_MAGIC);
+        net_header.version = htons(version);
+        net_header.msg_type = htons(static_cast<uint16_t>(titp_msg_type_t::RESOURCE_SENT));
+        net_header.payload_length = htonl(static_cast<uint32_t>(total - sizeof(titp_header_t)));
+        net_header.request_id = htonl(request_id);
+        std::memcpy(dst, &net_header, sizeof(net_header));
+        std::byte *ptr = dst + sizeof(titp_header_t);
+
+        uint64_t net_id = htobe64(task_id);
+        uint16_t msg_status = htons(static_cast<uint16_t>(titp_format_type_t::FORMAT_OK));
+        uint16_t status = htons(static_cast<uint16_t>(resource_status));
+        if (version == TITP_VERSION_V2) {
+            uint16_t name_length = htons(static_cast<uint16_t>(text_name.size()));
+            uint16_t description_length = htons(static_cast<uint16_t>(text_description.size()));
+            std::memcpy(ptr, &net_id, sizeof(net_id));
+            std::memcpy(ptr + 8, &msg_status, sizeof(msg_status));
+            std::memcpy(ptr + 10, &status, sizeof(status));
+            ptr[12] = static_cast<std::byte>(difficulty);
+            ptr[13] = static_cast<std::byte>(closed ? 1 : 0);
+            std::memcpy(ptr + 14, &name_length, sizeof(name_length));
+            std::memcpy(ptr + 16, &description_length, sizeof(description_length));
+            ptr += TITP_V2_RESPONSE_FIXED_SIZE;
+            put_text(ptr, text_name);
+            put_text(ptr + text_name.size(), text_description);
+            return total;
+        }
+
+        // v1 的定长字段：未使用的字节与结尾的 '\0' 都为 0
+        std::memset(ptr, 0, sizeof(titp_response_payload_t));
+        std::memcpy(ptr + offsetof(titp_task_metadata_t, task_id), &net_id, sizeof(net_id));
+        put_text(ptr + offsetof(titp_task_metadata_t, task_name), text_name);
+        ptr[offsetof(titp_task_metadata_t, difficulty)] = static_cast<std::byte>(difficulty);
+        ptr[offsetof(titp_task_metadata_t, closed)] = static_cast<std::byte>(closed ? 1 : 0);
+        std::memcpy(ptr + offsetof(titp_task_metadata_t, msg_status), &msg_status, sizeof(msg_status));
+        std::memcpy(ptr + offsetof(titp_task_metadata_t, resource_status), &status, sizeof(status));
+        put_text(ptr + offsetof(titp_response_payload_t, task_description), text_description);
+        return total;
+    }
+};
+
+/**
+ * @brief 只读的 TITP 报文视图，直接引用接收缓冲区中网络字节序的报文，不分配内存也不拷贝载荷。
+ * 构造时校验首部以及当前消息类型所需的载荷长度，字段在访问时才转换字节序，
+ * 名称与描述以 std::string_view 的形式指向报文内部。
+ */
+class titp_view_t {
+
+private:
+    const std::byte *bytes;
+    size_t length;
+    bool is_valid;
+
+    uint16_t read_u16(size_t offset) const noexcept {
+        uint16_t value;
+        std::memcpy(&value, bytes + offset, sizeof(value));
+        return ntohs(value);
+    }
+
+    uint32_t read_u32(size_t offset) const noexcept {
+        uint32_t value;
+        std::memcpy(&value, bytes + offset, sizeof(value));
+        return ntohl(value);
+    }
+
+    uint64_t read_u64(size_t offset) const noexcept {
+        uint64_t value;
+        std::memcpy(&value, bytes + offset, sizeof(value));
+        return be64toh(value);
+    }
+
+    static constexpr size_t payload_offset = sizeof(titp_header_t);
+
+    bool compact() const noexcept {
+        return get_version() == TITP_VERSION_V2;
+    }
+
+    // 按消息类型检查载荷长度，保证之后的字段访问不会越界
+    bool check_payload(uint16_t ver, titp_msg_type_t type, size_t payload_length) const noexcept {
+        switch (type) {
+            case titp_msg_type_t::RESOURCE_REQUEST:
+                return payload_length >= sizeof(titp_request_payload_t);
+            case titp_msg_type_t::BATCH_REQUEST: {
+                if (payload_length < TITP_BATCH_HEADER_SIZE) return false;
+                uint32_t count = read_u32(payload_offset);
+                return count <= MAX_BATCH_TASKS && payload_length == TITP_BATCH_HEADER_SIZE + count * sizeof(uint64_t);
+            }
+            case titp_msg_type_t::BATCH_END:
+                return payload_length >= sizeof(titp_batch_end_payload_t);
+            case titp_msg_type_t::NOTICE: {
+                if (payload_length < TITP_NOTICE_HEADER_SIZE) return false;
+                size_t text_length = read_u16(payload_offset + 10);
+                return text_length < MAX_NOTICE_TEXT_SIZE && TITP_NOTICE_HEADER_SIZE + text_length <= payload_length;
+            }
+            case titp_msg_type_t::SUBSCRIBE:
+            case titp_msg_type_t::SUBSCRIBE_ACK:
+                return payload_length >= sizeof(titp_subscribe_payload_t);
+            case titp_msg_type_t::TASK_CHANGE:
+            case titp_msg_type_t::TASK_CHANGE_ACK: {
+                if (payload_length < TITP_TASK_CHANGE_HEADER_SIZE) return false;
+                size_t name_length = read_u16(payload_offset + offsetof(titp_task_change_payload_t, name_length));
+                size_t description_length =
+                    read_u16(payload_offset + offsetof(titp_task_change_payload_t, description_length));
+                return name_length < sizeof(titp_task_change_payload_t::task_name) &&
+                       description_length < MAX_TASK_DESCRIPTION_SIZE &&
+                       TITP_TASK_CHANGE_HEADER_SIZE + name_length + description_length <= payload_length;
+            }
+            case titp_msg_type_t::RESOURCE_SENT: {
+                if (ver == TITP_VERSION_V1) return payload_length >= sizeof(titp_response_payload_t);
+                if (payload_length < TITP_V2_RESPONSE_FIXED_SIZE) return false;
+                size_t name_length = read_u16(payload_offset + 14);
+                size_t description_length = read_u16(payload_offset + 16);
+                return name_length < sizeof(titp_task_metadata_t::task_name) &&
+                       description_length < MAX_TASK_DESCRIPTION_SIZE &&
+                       TITP_V2_RESPONSE_FIXED_SIZE + name_length + description_length <= payload_length;
+            }
+            default:
+                // 未知类型只允许访问首部
+                return true;
+        }
+    }
+
+public:
+    titp_view_t(const void *data, size_t len) noexcept
+        : bytes(static_cast<const std::byte *>(data)), length(len), is_valid(false) {
+
+        if (len < sizeof(titp_header_t)) return;
+        if (read_u32(offsetof(titp_header_t, magic)) != TITP_MAGIC) return;
+
+        uint16_t ver = read_u16(offsetof(titp_header_t, version));
+        if (!titp_version_supported(ver)) return;
+
+        size_t payload_length = read_u32(offsetof(titp_header_t, payload_length));
+        if (len < sizeof(titp_header_t) + payload_length) return;
+
+        is_valid = check_payload(ver, static_cast<titp_msg_type_t>(read_u16(offsetof(titp_header_t, msg_type))),
+                                 payload_length);
+    }
+
+    /**
+     * @brief 报文结构是否完整，其余访问函数只能在 valid() 为 true 时调用。
+     */
+    bool valid() const noexcept {
+        return is_valid;
+    }
+
+    size_t size() const noexcept {
+        return length;
+    }
+
+    uint16_t get_version() const noexcept {
+        return read_u16(offsetof(titp_header_t, version));
+    }
+
+    titp_msg_type_t get_msg_type() const noexcept {
+        return static_cast<titp_msg_type_t>(read_u16(offsetof(titp_header_t, msg_type)));
+    }
+
+    uint32_t get_request_id() const noexcept {
+        return read_u32(offsetof(titp_header_t, request_id));
+    }
+
+    uint64_t get_task_id() const noexcept {
+        // RESOURCE_REQUEST、RESOURCE_SENT（两个版本）、NOTICE 与任务修改的 task_id 都位于载荷开头
+        return read_u64(payload_offset);
+    }
+
+    uint32_t get_batch_count() const noexcept {
+        return read_u32(payload_offset);
+    }
+
+    uint64_t get_batch_task_id(uint32_t index) const noexcept {
+        return read_u64(payload_offset + TITP_BATCH_HEADER_SIZE + index * sizeof(uint64_t));
+    }
+
+    titp_format_type_t get_format_status() const noexcept {
+        size_t offset = compact() ? 8 : offsetof(titp_task_metadata_t, msg_status);
+        return static_cast<titp_format_type_t>(read_u16(payload_offset + offset));
+    }
+
+    titp_resource_status_type_t get_resource_status() const noexcept {
+        size_t offset = compact() ? 10 : offsetof(titp_task_metadata_t, resource_status);
+        return static_cast<titp_resource_status_type_t>(read_u16(payload_offset + offset));
+    }
+
+    task_difficulty_t get_difficulty() const noexcept {
+        size_t offset = compact() ? 12 : offsetof(titp_task_metadata_t, difficulty);
+        return static_cast<task_difficulty_t>(bytes[payload_offset + offset]);
+    }
+
+    bool is_closed() const noexcept {
+        size_t offset = compact() ? 13 : offsetof(titp_task_metadata_t, closed);
+        return bytes[payload_offset + offset] != std::byte{0};
+    }
+
+    std::string_view get_task_name() const noexcept {
+        if (compact()) {
+            const char *name = reinterpret_cast<const char *>(bytes + payload_offset + TITP_V2_RESPONSE_FIXED_SIZE);
+            return std::string_view(name, read_u16(payload_offset + 14));
+        }
+        const char *name = reinterpret_cast<const char *>(bytes + payload_offset + offsetof(titp_task_metadata_t, task_name));
+        return std::string_view(name, strnlen(name, sizeof(titp_task_metadata_t::task_name)));
+    }
+
+    std::string_view get_task_description() const noexcept {
+        if (compact()) {
+            size_t name_length = read_u16(payload_offset + 14);
+            const char *description = reinterpret_cast<const char *>(
+                bytes + payload_offset + TITP_V2_RESPONSE_FIXED_SIZE + name_length);
+            return std::string_view(description, read_u16(payload_offset + 16));
+        }
+        const char *description = reinterpret_cast<const char *>(
+            bytes + payload_offset + offsetof(titp_response_payload_t, task_description));
+        return std::string_view(description, strnlen(description, MAX_TASK_DESCRIPTION_SIZE));
+    }
+
+    titp_notice_kind_t get_notice_kind() const noexcept {
+        return static_cast<titp_notice_kind_t>(read_u16(payload_offset + 8));
+    }
+
+    std::string_view get_notice_text() const noexcept {
+        const char *text = reinterpret_cast<const char *>(bytes + payload_offset + TITP_NOTICE_HEADER_SIZE);
+        return std::string_view(text, read_u16(payload_offset + 10));
+    }
+
+    bool get_subscription_active() const noexcept {
+        return bytes[payload_offset + offsetof(titp_subscribe_payload_t, active)] != std::byte{0};
+    }
+
+    titp_task_action_t get_task_action() const noexcept {
+        return static_cast<titp_task_action_t>(bytes[payload_offset + offsetof(titp_task_change_payload_t, action)]);
+    }
+
+    task_difficulty_t get_task_change_difficulty() const noexcept {
+        return static_cast<task_difficulty_t>(bytes[payload_offset + offsetof(titp_task_change_payload_t, difficulty)]);
+    }
+
+    titp_resource_status_type_t get_task_change_status() const noexcept {
+        return static_cast<titp_resource_status_type_t>(
+            read_u16(payload_offset + offsetof(titp_task_change_payload_t, status)));
+    }
+
+    std::string_view get_task_change_name() const noexcept {
+        const char *name = reinterpret_cast<const char *>(bytes + payload_offset + TITP_TASK_CHANGE_HEADER_SIZE);
+        return std::string_view(name, read_u16(payload_offset + offsetof(titp_task_change_payload_t, name_length)));
+    }
+
+    std::string_view get_task_change_description() const noexcept {
+        size_t name_length = read_u16(payload_offset + offsetof(titp_task_change_payload_t, name_length));
+        const char *description = reinterpret_cast<const char *>(
+            bytes + payload_offset + TITP_TASK_CHANGE_HEADER_SIZE + name_length);
+        return std::string_view(description,
+                                read_u16(payload_offset + offsetof(titp_task_change_payload_t, description_length)));
+    }
+
+    task_difficulty_t get_min_difficulty() const noexcept {
+        return static_cast<task_difficulty_t>(bytes[payload_offset + offsetof(titp_subscribe_payload_t, min_difficulty)]);
+    }
+
+    task_difficulty_t get_max_difficulty() const noexcept {
+        return static_cast<task_difficulty_t>(bytes[payload_offset + offsetof(titp_subscribe_payload_t, max_difficulty)]);
+    }
 };
\ No newline at end of file
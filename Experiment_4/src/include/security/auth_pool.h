@@ -0,0 +1,116 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 认证队列的默认上限：排队的任务超过这么多时直接拒绝，登录风暴不会让排队时间无限增长
+constexpr size_t AUTH_QUEUE_LIMIT = 256;
+
+/**
+ * @brief 执行密码哈希等耗时认证工作的线程池，使 Reactor 线程不被 PBKDF2 阻塞。
+ * 队列是构造时按上限分配好的环形缓冲区，submit() 在队列已满时立即返回 false，由调用者回复 SERVER_UNAVAILABLE；
+ * 任务在工作线程中执行，结果由任务自己通过 event_loop::post() 送回发起请求的 Reactor。
+ *
+ */
+class auth_pool{
+
+        public:
+        using job_t = std::function<void()>;
+
+        private:
+        std::mutex lock;
+        std::condition_variable ready;
+        std::vector<job_t> jobs;                // 环形缓冲区，共 limit 个槽，入队出队都不分配内存
+        size_t head;                            // 队首所在的槽
+        size_t count;                           // 排队中的任务数
+        size_t limit;
+        bool stopping;
+        std::vector<std::thread> workers;
+
+        void worker_main() {
+            while (true) {
+                job_t job;
+                {
+                    std::unique_lock guard(lock);
+                    ready.wait(guard, [this]() { return stopping || count > 0; });
+                    if (stopping) return;
+                    job = std::move(jobs[head]);
+                    jobs[head] = nullptr;
+                    head = (head + 1) % limit;
+                    --count;
+                }
+                job();
+            }
+        }
+
+        public:
+        explicit auth_pool(size_t queue_limit = AUTH_QUEUE_LIMIT)
+        : jobs(queue_limit > 0 ? queue_limit : 1), head(0), count(0), limit(jobs.size()), stopping(false) {}
+
+        ~auth_pool() {
+            stop();
+        }
+
+        auth_pool(const auth_pool&) = delete;
+        auth_pool& operator=(const auth_pool&) = delete;
+
+        /**
+         * @brief 启动工作线程，只能调用一次。
+         */
+        void start(size_t thread_count) {
+            if (thread_count == 0) thread_count = 1;
+            workers.reserve(thread_count);
+            for (size_t i = 0; i < thread_count; ++i) {
+                workers.emplace_back(&auth_pool::worker_main, this);
+            }
+        }
+
+        /**
+         * @brief 停止并等待全部工作线程退出，尚未开始的任务直接丢弃。
+         * 任务会向事件循环投递结果，必须在事件循环销毁之前调用。
+         */
+        void stop() {
+            {
+                std::lock_guard guard(lock);
+                if (stopping && workers.empty()) return;
+                stopping = true;
+                for (auto &job : jobs) job = nullptr;
+                head = 0;
+                count = 0;
+            }
+            ready.notify_all();
+            for (auto &worker : workers) {
+                if (worker.joinable()) worker.join();
+            }
+            workers.clear();
+        }
+
+        /**
+         * @brief 提交一个任务，可以在任意线程调用。
+         *
+         * @return bool 队列已满或线程池已停止时返回 false，任务不会执行
+         */
+        bool submit(job_t job) {
+            {
+                std::lock_guard guard(lock);
+                if (stopping || count >= limit) return false;
+                jobs[(head + count) % limit] = std::move(job);
+                ++count;
+            }
+            ready.notify_one();
+            return true;
+        }
+
+        size_t queued() {
+            std::lock_guard guard(lock);
+            return count;
+        }
+
+        size_t thread_count() const noexcept {
+            return workers.size();
+        }
+};
\ No newline at end of file
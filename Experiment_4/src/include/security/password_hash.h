@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/random.h>
+
+// PBKDF2 的迭代次数：开启优化时单次校验约数十毫秒，在线登录可以接受，离线暴力破解的代价随之放大
+constexpr uint32_t PASSWORD_HASH_ITERATIONS = 10000;
+// 每个密码独立的随机盐长度
+constexpr size_t PASSWORD_SALT_BYTES = 16;
+
+/**
+ * @brief SHA-256（FIPS 180-4）。对象可以复制，HMAC 借此缓存已经吸收了密钥块的中间状态。
+ */
+class sha256{
+
+        public:
+        static constexpr size_t DIGEST_BYTES = 32;
+        static constexpr size_t BLOCK_BYTES = 64;
+        using digest_t = std::array<uint8_t, DIGEST_BYTES>;
+
+        private:
+        uint32_t state[8];
+        uint64_t total_bytes;
+        uint8_t block[BLOCK_BYTES];
+        size_t block_used;
+
+        static constexpr uint32_t ROUND_CONSTANTS[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        static uint32_t rotr(uint32_t x, int n) noexcept {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        static void compress(uint32_t *state, const uint8_t *data) noexcept {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i) {
+                w[i] = static_cast<uint32_t>(data[4 * i]) << 24 | static_cast<uint32_t>(data[4 * i + 1]) << 16 |
+                       static_cast<uint32_t>(data[4 * i + 2]) << 8 | static_cast<uint32_t>(data[4 * i + 3]);
+            }
+            for (int i = 16; i < 64; ++i) {
+                uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+
+        public:
+        sha256() noexcept {
+            reset();
+        }
+
+        void reset() noexcept {
+            static constexpr uint32_t INITIAL[8] = {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+            };
+            std::memcpy(state, INITIAL, sizeof(state));
+            total_bytes = 0;
+            block_used = 0;
+        }
+
+        void update(const void *data, size_t size) noexcept {
+            const uint8_t *ptr = static_cast<const uint8_t*>(data);
+            total_bytes += size;
+            if (block_used > 0) {
+                size_t n = std::min(size, BLOCK_BYTES - block_used);
+                std::memcpy(block + block_used, ptr, n);
+                block_used += n;
+                ptr += n;
+                size -= n;
+                if (block_used < BLOCK_BYTES) return;
+                compress(state, block);
+                block_used = 0;
+            }
+            for (; size >= BLOCK_BYTES; ptr += BLOCK_BYTES, size -= BLOCK_BYTES) {
+                compress(state, ptr);
+            }
+            std::memcpy(block, ptr, size);
+            block_used = size;
+        }
+
+        digest_t finish() noexcept {
+            uint64_t bit_length = total_bytes * 8;
+            static constexpr uint8_t PADDING[BLOCK_BYTES] = {0x80};
+            update(PADDING, block_used < 56 ? 56 - block_used : BLOCK_BYTES + 56 - block_used);
+
+            uint8_t length[8];
+            for (int i = 0; i < 8; ++i) length[i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+            update(length, sizeof(length));
+
+            return to_digest(state);
+        }
+
+        /**
+         * @brief 在已吸收整块的状态之后追加一段不超过 55 字节的消息并结束，状态本身不变。
+         * 只有一次压缩且不复制对象，HMAC 迭代中定长的短消息走这里。
+         */
+        digest_t finish_short(const uint8_t *data, size_t size) const noexcept {
+            uint8_t last[BLOCK_BYTES] = {};
+            std::memcpy(last, data, size);
+            last[size] = 0x80;
+            uint64_t bit_length = (total_bytes + size) * 8;
+            for (int i = 0; i < 8; ++i) last[56 + i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+
+            uint32_t result[8];
+            std::memcpy(result, state, sizeof(result));
+            compress(result, last);
+            return to_digest(result);
+        }
+
+        private:
+        static digest_t to_digest(const uint32_t *state) noexcept {
+            digest_t digest;
+            for (int i = 0; i < 8; ++i) {
+                digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+                digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+                digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+                digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+            }
+            return digest;
+        }
+};
+
+/**
+ * @brief HMAC-SHA256（RFC 2104）。构造时吸收一次密钥，之后每次计算只需要复制两份中间状态，
+ * PBKDF2 的每一轮因此只有两次压缩。
+ */
+class hmac_sha256{
+
+        private:
+        sha256 inner;
+        sha256 outer;
+
+        public:
+        hmac_sha256(const void *key, size_t key_size) noexcept {
+            uint8_t key_block[sha256::BLOCK_BYTES] = {};
+            if (key_size > sha256::BLOCK_BYTES) {
+                sha256 hashed;
+                hashed.update(key, key_size);
+                sha256::digest_t digest = hashed.finish();
+                std::memcpy(key_block, digest.data(), digest.size());
+            } else {
+                std::memcpy(key_block, key, key_size);
+            }
+
+            uint8_t pad[sha256::BLOCK_BYTES];
+            for (size_t i = 0; i < sizeof(pad); ++i) pad[i] = key_block[i] ^ 0x36;
+            inner.update(pad, sizeof(pad));
+            for (size_t i = 0; i < sizeof(pad); ++i) pad[i] = key_block[i] ^ 0x5c;
+            outer.update(pad, sizeof(pad));
+        }
+
+        // 对一个摘要计算 HMAC：内外两层都只剩一次压缩，是 PBKDF2 迭代的热点
+        sha256::digest_t compute(const sha256::digest_t &message) const noexcept {
+            sha256::digest_t inner_digest = inner.finish_short(message.data(), message.size());
+            return outer.finish_short(inner_digest.data(), inner_digest.size());
+        }
+
+        // 对两段拼接起来的消息计算 HMAC，不需要先拷贝到一起
+        sha256::digest_t compute(const void *first, size_t first_size, const void *second, size_t second_size) const noexcept {
+            sha256 h = inner;
+            h.update(first, first_size);
+            h.update(second, second_size);
+            sha256::digest_t inner_digest = h.finish();
+            h = outer;
+            h.update(inner_digest.data(), inner_digest.size());
+            return h.finish();
+        }
+};
+
+/**
+ * @brief PBKDF2-HMAC-SHA256（RFC 8018），输出长度为一个摘要，足够用于密码校验。
+ */
+inline sha256::digest_t pbkdf2_hmac_sha256(std::string_view password, const uint8_t *salt, size_t salt_size,
+                                           uint32_t iterations) noexcept {
+    hmac_sha256 prf(password.data(), password.size());
+
+    // U1 = PRF(P, S || INT(1))
+    static constexpr uint8_t BLOCK_INDEX[4] = {0, 0, 0, 1};
+    sha256::digest_t u = prf.compute(salt, salt_size, BLOCK_INDEX, sizeof(BLOCK_INDEX));
+
+    sha256::digest_t result = u;
+    for (uint32_t i = 1; i < iterations; ++i) {
+        u = prf.compute(u);
+        for (size_t j = 0; j < result.size(); ++j) result[j] ^= u[j];
+    }
+    return result;
+}
+
+/**
+ * @brief 以 PBKDF2-HMAC-SHA256 加盐存储的密码，服务器只保存它而不保存明文。
+ * 迭代次数随记录保存，调高 PASSWORD_HASH_ITERATIONS 后旧记录仍然可以校验。
+ */
+struct password_hash {
+    std::array<uint8_t, PASSWORD_SALT_BYTES> salt{};
+    uint32_t iterations = 0;
+    sha256::digest_t digest{};
+
+    /**
+     * @brief 为密码生成新的随机盐并计算摘要，代价与一次校验相同。
+     */
+    static password_hash create(std::string_view password, uint32_t iterations = PASSWORD_HASH_ITERATIONS) {
+        password_hash hash;
+        size_t filled = 0;
+        while (filled < hash.salt.size()) {
+            ssize_t n = getrandom(hash.salt.data() + filled, hash.salt.size() - filled, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Error: Failed to generate password salt - ") + strerror(errno));
+            }
+            filled += static_cast<size_t>(n);
+        }
+        hash.iterations = iterations;
+        hash.digest = pbkdf2_hmac_sha256(password, hash.salt.data(), hash.salt.size(), iterations);
+        return hash;
+    }
+
+    /**
+     * @brief 校验密码，摘要按常量时间比较，耗时不泄露匹配了多少字节。
+     */
+    bool verify(std::string_view password) const noexcept {
+        sha256::digest_t computed = pbkdf2_hmac_sha256(password, salt.data(), salt.size(), iterations);
+        uint8_t diff = 0;
+        for (size_t i = 0; i < digest.size(); ++i) diff |= computed[i] ^ digest[i];
+        return diff == 0;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/random.h>
+#include "../network/timer_wheel.h"
+
+// 会话令牌的有效期：最后一次登录或恢复之后这么久没有再使用，令牌失效
+constexpr std::chrono::seconds SESSION_TTL{30 * 60};
+// 令牌的随机字节数，以十六进制下发，长度为其两倍，必须能放进 piap_payload_t::session
+constexpr size_t SESSION_TOKEN_BYTES = 16;
+constexpr size_t SESSION_TOKEN_LENGTH = SESSION_TOKEN_BYTES * 2;
+// 令牌过期的精度，令牌以分钟计的有效期不需要更细
+constexpr uint64_t SESSION_EXPIRY_TICK_MS = 1000;
+// 同时有效的令牌数量上限，令牌表按此一次分配，之后签发与恢复都不再分配内存
+constexpr size_t SESSION_TABLE_CAPACITY = 65536;
+// 令牌表为每个令牌保存的用户名长度上限，与 piap_payload_t::userID 一致
+constexpr size_t SESSION_USER_SIZE = 63;
+
+/**
+ * @brief 会话令牌的十六进制文本，定长保存在会话中，复制与清空都不分配内存。
+ */
+struct session_token {
+    char text[SESSION_TOKEN_LENGTH];
+    uint8_t length = 0;
+
+    // 长度不对的文本不可能是签发过的令牌，直接视为空
+    void assign(std::string_view value) noexcept {
+        length = value.size() == sizeof(text) ? static_cast<uint8_t>(sizeof(text)) : 0;
+        std::memcpy(text, value.data(), length);
+    }
+
+    std::string_view view() const noexcept {
+        return std::string_view(text, length);
+    }
+
+    bool empty() const noexcept {
+        return length == 0;
+    }
+
+    void clear() noexcept {
+        length = 0;
+    }
+};
+
+/**
+ * @brief 登录成功后下发的会话令牌表，令牌到期前客户端可以凭它恢复会话而不再发送密码。
+ * 令牌是不透明的随机串，只在服务器内存中与用户对应，服务器重启后全部失效。
+ * 所有 Reactor 线程共用一张表，内部以互斥锁保护。表项、索引与空闲表都在构造时按容量一次分配：
+ * 索引以令牌的前 8 个随机字节为哈希做线性探测，删除留下墓碑，墓碑过多时原地重建索引；
+ * 用户名定长保存在表项中，每个表项的定时器回调在构造时绑定，签发、恢复与作废都不分配内存。
+ * 令牌已满时不再签发，登录照常成功，只是这次登录不能恢复。
+ * 每个令牌在表内的时间轮上挂一个定时器，由某个事件循环定期调用 expire() 淘汰到期的令牌；
+ * 恢复会话只顺延到期时间，定时器到期时再按新的时间重新挂上。时间由调用者传入（事件循环缓存的粗粒度时钟），表内不读取时钟。
+ *
+ */
+class session_table{
+
+        private:
+        static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+        static constexpr uint32_t DELETED_SLOT = UINT32_MAX - 1;
+
+        struct entry {
+            unsigned char key[SESSION_TOKEN_BYTES];
+            char user[SESSION_USER_SIZE];
+            uint8_t user_length;
+            bool live;
+            uint32_t slot;              // 在 index 中的位置，删除时直接在那里留下墓碑
+            uint64_t expires_at;        // 毫秒，与调用者传入的时间同一时钟
+            timer_node timer;
+        };
+
+        mutable std::mutex lock;
+        uint64_t ttl_ms;
+        timer_wheel expiry;         // 先于表项构造、后于表项销毁，表项的定时器析构时仍可以从时间轮上摘下
+        size_t capacity;
+        std::unique_ptr<entry[]> entries;
+        std::unique_ptr<uint32_t[]> index;      // 容量的两倍，存放表项序号或 EMPTY_SLOT/DELETED_SLOT
+        size_t index_mask;
+        std::unique_ptr<uint32_t[]> free_entries;
+        size_t free_count;
+        size_t tombstones;
+
+        static uint64_t hash(const unsigned char *key) noexcept {
+            uint64_t value;
+            std::memcpy(&value, key, sizeof(value));
+            return value;
+        }
+
+        // 令牌文本还原为随机字节，不是 SESSION_TOKEN_LENGTH 个十六进制字符时返回 false
+        static bool decode(std::string_view token, unsigned char *key) noexcept {
+            if (token.size() != SESSION_TOKEN_LENGTH) return false;
+            for (size_t i = 0; i < SESSION_TOKEN_BYTES; ++i) {
+                int high = hex_value(token[2 * i]);
+                int low = hex_value(token[2 * i + 1]);
+                if (high < 0 || low < 0) return false;
+                key[i] = static_cast<unsigned char>(high << 4 | low);
+            }
+            return true;
+        }
+
+        static int hex_value(char c) noexcept {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        }
+
+        static void generate_key(unsigned char *key) {
+            size_t filled = 0;
+            while (filled < SESSION_TOKEN_BYTES) {
+                ssize_t n = getrandom(key + filled, SESSION_TOKEN_BYTES - filled, 0);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(std::string("Error: Failed to generate session token - ") + strerror(errno));
+                }
+                filled += static_cast<size_t>(n);
+            }
+        }
+
+        // 持锁调用，不存在时返回 capacity
+        size_t find(const unsigned char *key) const noexcept {
+            for (size_t slot = hash(key) & index_mask;; slot = (slot + 1) & index_mask) {
+                uint32_t id = index[slot];
+                if (id == EMPTY_SLOT) return capacity;
+                if (id != DELETED_SLOT && std::memcmp(entries[id].key, key, SESSION_TOKEN_BYTES) == 0) return id;
+            }
+        }
+
+        // 把表项挂到探测序列上第一个空槽或墓碑（持锁调用，调用者保证令牌不在表中）
+        void link(uint32_t id) noexcept {
+            for (size_t slot = hash(entries[id].key) & index_mask;; slot = (slot + 1) & index_mask) {
+                if (index[slot] == EMPTY_SLOT || index[slot] == DELETED_SLOT) {
+                    if (index[slot] == DELETED_SLOT) --tombstones;
+                    index[slot] = id;
+                    entries[id].slot = static_cast<uint32_t>(slot);
+                    return;
+                }
+            }
+        }
+
+        void remove(uint32_t id) noexcept {
+            entry &session = entries[id];
+            session.live = false;
+            session.timer.cancel();
+            index[session.slot] = DELETED_SLOT;
+            free_entries[free_count++] = id;
+            // 索引的大小是容量的两倍，墓碑不超过容量的一半时总留有空槽，探测一定会结束
+            if (++tombstones > capacity / 2) rebuild_index();
+        }
+
+        void rebuild_index() noexcept {
+            std::fill(index.get(), index.get() + index_mask + 1, EMPTY_SLOT);
+            tombstones = 0;
+            for (size_t id = 0; id < capacity; ++id) {
+                if (entries[id].live) link(static_cast<uint32_t>(id));
+            }
+        }
+
+        // 令牌的定时器到期（持锁调用）：期间被恢复过的按新的到期时间重新挂上，否则删除
+        void on_timer(uint32_t id) {
+            entry &session = entries[id];
+            if (!session.live) return;
+            uint64_t now = expiry.now_ms();
+            if (session.expires_at > now) {
+                expiry.schedule(session.timer, session.expires_at - now);
+            } else {
+                remove(id);
+            }
+        }
+
+        public:
+        /**
+         * @param now_ms 当前时间，与之后传入的时间同一时钟
+         * @param table_capacity 同时有效的令牌数量上限
+         */
+        explicit session_table(uint64_t now_ms, std::chrono::seconds ttl = SESSION_TTL,
+                               size_t table_capacity = SESSION_TABLE_CAPACITY)
+        : ttl_ms(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(ttl).count())),
+          expiry(now_ms, SESSION_EXPIRY_TICK_MS), capacity(std::max<size_t>(table_capacity, 1)),
+          entries(new entry[capacity]), index_mask(0), free_entries(new uint32_t[capacity]), free_count(capacity),
+          tombstones(0) {
+
+            size_t index_size = 1;
+            while (index_size < capacity * 2) index_size *= 2;
+            index.reset(new uint32_t[index_size]);
+            index_mask = index_size - 1;
+            std::fill(index.get(), index.get() + index_size, EMPTY_SLOT);
+
+            for (size_t id = 0; id < capacity; ++id) {
+                entries[id].live = false;
+                // 回调只捕获 this 与表项序号，放得进 std::function 的内部存储
+                entries[id].timer.callback = [this, id = static_cast<uint32_t>(id)]() {
+                    on_timer(id);
+                };
+                free_entries[id] = static_cast<uint32_t>(capacity - 1 - id);
+            }
+        }
+
+        session_table(const session_table&) = delete;
+        session_table& operator=(const session_table&) = delete;
+
+        /**
+         * @brief 为登录成功的用户签发一个新令牌，写入 token。
+         *
+         * @return bool 令牌表已满或用户名超出 SESSION_USER_SIZE 时返回 false，token 被清空
+         */
+        bool issue(std::string_view user, uint64_t now_ms, session_token &token) {
+            token.clear();
+            if (user.size() > SESSION_USER_SIZE) return false;
+
+            unsigned char key[SESSION_TOKEN_BYTES];
+            generate_key(key);
+
+            std::lock_guard guard(lock);
+            // 128 位随机数几乎不可能重复，真的重复时宁可不签发，也不能把两个会话混在一起
+            if (free_count == 0 || find(key) != capacity) return false;
+            expiry.set_time(now_ms);
+
+            uint32_t id = free_entries[--free_count];
+            entry &session = entries[id];
+            std::memcpy(session.key, key, sizeof(key));
+            std::memcpy(session.user, user.data(), user.size());
+            session.user_length = static_cast<uint8_t>(user.size());
+            session.live = true;
+            session.expires_at = now_ms + ttl_ms;
+            link(id);
+            expiry.schedule(session.timer, ttl_ms);
+
+            static constexpr char digits[] = "0123456789abcdef";
+            for (size_t i = 0; i < SESSION_TOKEN_BYTES; ++i) {
+                token.text[2 * i] = digits[key[i] >> 4];
+                token.text[2 * i + 1] = digits[key[i] & 0x0f];
+            }
+            token.length = static_cast<uint8_t>(SESSION_TOKEN_LENGTH);
+            return true;
+        }
+
+        /**
+         * @brief 凭令牌恢复会话，成功时顺延令牌的有效期，并在持锁期间以用户名调用 on_user(std::string_view)。
+         *
+         * @return bool 令牌不存在或已过期时返回 false
+         */
+        template<typename Visitor>
+        bool resume(std::string_view token, uint64_t now_ms, Visitor &&on_user) {
+            unsigned char key[SESSION_TOKEN_BYTES];
+            if (!decode(token, key)) return false;
+
+            std::lock_guard guard(lock);
+            size_t id = find(key);
+            if (id == capacity) return false;
+            entry &session = entries[id];
+            if (session.expires_at <= now_ms) {
+                remove(static_cast<uint32_t>(id));
+                return false;
+            }
+            session.expires_at = now_ms + ttl_ms;
+            on_user(std::string_view(session.user, session.user_length));
+            return true;
+        }
+
+        /**
+         * @brief 作废一个令牌，用于主动登出与强制下线。
+         */
+        void revoke(std::string_view token) {
+            unsigned char key[SESSION_TOKEN_BYTES];
+            if (!decode(token, key)) return;
+
+            std::lock_guard guard(lock);
+            size_t id = find(key);
+            if (id != capacity) remove(static_cast<uint32_t>(id));
+        }
+
+        /**
+         * @brief 作废一个用户的全部令牌，用于修改密码之后：旧密码换来的令牌不能再恢复会话。
+         * 遍历整张表，只在改密这类少见的操作上调用。
+         *
+         * @return size_t 作废的令牌数
+         */
+        size_t revoke_user(std::string_view user) {
+            std::lock_guard guard(lock);
+            size_t revoked = 0;
+            for (size_t id = 0; id < capacity; ++id) {
+                const entry &session = entries[id];
+                if (session.live && std::string_view(session.user, session.user_length) == user) {
+                    remove(static_cast<uint32_t>(id));
+                    ++revoked;
+                }
+            }
+            return revoked;
+        }
+
+        /**
+         * @brief 淘汰到期的令牌，代价只与到期（或需要顺延）的令牌数量有关。
+         */
+        void expire(uint64_t now_ms) {
+            std::lock_guard guard(lock);
+            expiry.set_time(now_ms);
+            expiry.expire();
+        }
+
+        size_t size() const {
+            std::lock_guard guard(lock);
+            return capacity - free_count;
+        }
+};
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 以 std::string 为键的无序容器使用的透明哈希，配合 std::equal_to<> 可以直接用 string_view 查找，
+ * 查找时不需要为了构造临时键而分配内存。与 std::hash<std::string> 的结果一致。
+ */
+struct string_hash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view key) const noexcept {
+        return std::hash<std::string_view>{}(key);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,455 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "password_hash.h"
+#include "string_hash.h"
+#include "../account.h"
+
+// 用户表的分片数，写入只锁一个分片
+constexpr size_t USER_STORE_SHARDS = 16;
+// 同时可以无锁读取的线程数，超出的线程退化为持有分片写锁读取
+constexpr size_t USER_STORE_READER_SLOTS = 128;
+// 每个分片初始的桶数，记录数超过桶数时加倍
+constexpr size_t USER_STORE_INITIAL_BUCKETS = 16;
+
+/**
+ * @brief 用户表中的一条记录，字段与 account 相同，只是密码以加盐哈希保存。
+ */
+struct user_record {
+    std::string usr_ID;
+    password_hash password;
+    std::string usr_name;
+    uint8_t level = MIN_LEVEL;
+};
+
+/**
+ * @brief 读端的纪元（epoch）登记表，所有 user_store 共用。
+ * 读线程进入读区时把当前纪元写进自己的槽，离开时清零；写线程摘下旧数据后推进纪元，以推进后的纪元为退休纪元，
+ * 之后只要没有槽停留在比退休纪元更早的纪元上，旧数据就不会再被任何读者访问，可以释放。
+ * 读端只有两次原子写，不加锁、不修改共享计数；写端只检查各槽，不等待读者。
+ *
+ */
+class read_epoch{
+
+        private:
+        struct alignas(64) slot {
+            std::atomic<uint64_t> epoch{0};         // 0 表示不在读区内
+            std::atomic<bool> claimed{false};
+        };
+
+        std::atomic<uint64_t> global_epoch{1};
+        std::atomic<uint64_t> releases{0};          // 归还槽的次数，认领失败的线程在它变化之后再试
+        slot slots[USER_STORE_READER_SLOTS];
+
+        // 线程第一次读取时认领一个槽，线程退出时归还
+        struct thread_slot {
+            slot *owned = nullptr;
+            bool exhausted = false;
+            uint64_t seen_releases = 0;             // 认领失败时的归还次数
+
+            ~thread_slot() {
+                if (owned) {
+                    owned->claimed.store(false, std::memory_order_release);
+                    instance().releases.fetch_add(1, std::memory_order_release);
+                }
+            }
+        };
+
+        slot *claim() noexcept {
+            static thread_local thread_slot local;
+            if (local.owned) return local.owned;
+            // 认领失败之后没有线程归还过槽，再扫一遍也不会成功
+            uint64_t released = releases.load(std::memory_order_acquire);
+            if (local.exhausted && released == local.seen_releases) return nullptr;
+            for (auto &candidate : slots) {
+                bool expected = false;
+                if (!candidate.claimed.load(std::memory_order_relaxed) &&
+                    candidate.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    local.owned = &candidate;
+                    local.exhausted = false;
+                    return local.owned;
+                }
+            }
+            local.exhausted = true;
+            local.seen_releases = released;
+            return nullptr;
+        }
+
+        read_epoch() = default;
+
+        public:
+        static read_epoch &instance() noexcept {
+            static read_epoch domain;
+            return domain;
+        }
+
+        /**
+         * @brief 读区的作用域守卫。没有空闲槽时 active() 为 false，调用者应改为加锁读取。读区不能嵌套。
+         */
+        class guard{
+
+                private:
+                slot *owned;
+
+                public:
+                guard() noexcept : owned(instance().claim()) {
+                    if (owned) owned->epoch.store(instance().global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                }
+
+                ~guard() {
+                    if (owned) owned->epoch.store(0, std::memory_order_release);
+                }
+
+                guard(const guard&) = delete;
+                guard& operator=(const guard&) = delete;
+
+                bool active() const noexcept {
+                    return owned != nullptr;
+                }
+        };
+
+        /**
+         * @brief 推进纪元，返回摘下数据的退休纪元。调用前必须已经摘下旧数据（seq_cst）。
+         */
+        uint64_t retire() noexcept {
+            return global_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        }
+
+        /**
+         * @brief 仍在读区内的读者中最早的纪元，没有读者时为 UINT64_MAX。退休纪元不超过它的数据可以释放。
+         */
+        uint64_t oldest_reader() const noexcept {
+            uint64_t oldest = UINT64_MAX;
+            for (const auto &s : slots) {
+                uint64_t observed = s.epoch.load(std::memory_order_seq_cst);
+                if (observed != 0 && observed < oldest) oldest = observed;
+            }
+            return oldest;
+        }
+};
+
+/**
+ * @brief 分片的用户凭据表：用户名到用户记录的映射。
+ * 每个分片是一张拉链哈希表，桶与链上的指针都是原子的，读者在纪元保护下沿链查找，不加锁；
+ * 写者持有分片的互斥锁，逐条发布：新增把新结点挂到链头，修改把记录的副本换进链中，删除把结点从链上摘下，
+ * 每次只有一次原子写，不复制分片。被换下的结点带着退休纪元进入分片的回收表，
+ * 之后的写入发现已经没有读者停留在更早的纪元上时才释放，写者从不等待读者。
+ * 记录数超过桶数时把全部记录复制到加倍的新桶表并整体替换，旧桶表连同其上的结点同样退休，摊销到每次插入是常数。
+ * 启动时的批量加载走 assign()，每个分片只构建一次。
+ *
+ */
+class user_store{
+
+        private:
+        struct node {
+            std::atomic<node*> next;
+            user_record record;
+
+            node(node *successor, user_record value)
+            : next(successor), record(std::move(value)) {}
+        };
+
+        struct table {
+            size_t mask;
+            std::unique_ptr<std::atomic<node*>[]> buckets;
+
+            explicit table(size_t bucket_count)
+            : mask(bucket_count - 1), buckets(new std::atomic<node*>[bucket_count]()) {}
+
+            // 桶表只拥有仍挂在链上的结点，单独退休的结点已经不在链上
+            ~table() {
+                for (size_t i = 0; i <= mask; ++i) {
+                    node *entry = buckets[i].load(std::memory_order_relaxed);
+                    while (entry) delete std::exchange(entry, entry->next.load(std::memory_order_relaxed));
+                }
+            }
+
+            std::atomic<node*> &bucket(size_t hash) const noexcept {
+                // 低位已经用来选分片
+                return buckets[(hash / USER_STORE_SHARDS) & mask];
+            }
+        };
+
+        // 等待释放的结点或桶表，二者只有一个不为空
+        struct retired {
+            uint64_t epoch;
+            node *entry;
+            table *buckets;
+        };
+
+        struct alignas(64) shard {
+            mutable std::mutex write_lock;
+            std::atomic<table*> current{nullptr};
+            std::atomic<size_t> count{0};
+            std::vector<retired> retired_list;      // 持写锁访问，退休纪元递增
+        };
+
+        shard shards[USER_STORE_SHARDS];
+
+        static size_t hash_of(std::string_view username) noexcept {
+            return string_hash{}(username);
+        }
+
+        // 读者的查找：链上的每个结点只读取一次，查找期间被换下的结点在读区结束前不会释放
+        static const node *find_node(const table &users, std::string_view username, size_t hash) noexcept {
+            for (const node *entry = users.bucket(hash).load(std::memory_order_acquire); entry;
+                 entry = entry->next.load(std::memory_order_acquire)) {
+                if (entry->record.usr_ID == username) return entry;
+            }
+            return nullptr;
+        }
+
+        // 写者的查找（持写锁调用），返回指向该记录所在结点的链接，不存在时返回 nullptr
+        static std::atomic<node*> *find_link(const table &users, std::string_view username, size_t hash) noexcept {
+            std::atomic<node*> *link = &users.bucket(hash);
+            for (node *entry = link->load(std::memory_order_relaxed); entry; entry = link->load(std::memory_order_relaxed)) {
+                if (entry->record.usr_ID == username) return link;
+                link = &entry->next;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief 在读区内对分片的当前桶表调用 reader。没有空闲的纪元槽时持有写锁读取，写者不会在此期间释放任何东西。
+         */
+        template<typename Reader>
+        auto read_shard(const shard &s, Reader &&reader) const {
+            read_epoch::guard epoch;
+            if (!epoch.active()) {
+                std::lock_guard guard(s.write_lock);
+                return reader(*s.current.load(std::memory_order_acquire));
+            }
+            // 纪元先于指针读取（seq_cst），写者推进纪元之前摘下的结点一定不会被看到
+            return reader(*s.current.load(std::memory_order_seq_cst));
+        }
+
+        // 持写锁调用：已经摘下的结点或桶表带着退休纪元进入回收表。发布前先预留位置，摘下之后不再可能失败
+        static void retire(shard &s, node *entry, table *buckets) noexcept {
+            s.retired_list.push_back(retired{read_epoch::instance().retire(), entry, buckets});
+        }
+
+        // 持写锁调用：释放已经没有读者可能访问的结点与桶表，只检查纪元槽，不等待
+        static void reclaim(shard &s) noexcept {
+            if (s.retired_list.empty()) return;
+            uint64_t oldest = read_epoch::instance().oldest_reader();
+            size_t freed = 0;
+            while (freed < s.retired_list.size() && s.retired_list[freed].epoch <= oldest) {
+                delete s.retired_list[freed].entry;
+                delete s.retired_list[freed].buckets;
+                ++freed;
+            }
+            s.retired_list.erase(s.retired_list.begin(), s.retired_list.begin() + static_cast<std::ptrdiff_t>(freed));
+        }
+
+        // 持写锁调用：把全部记录复制到加倍的新桶表并发布，旧桶表连同其上的结点退休
+        static table *grow(shard &s, table *users) {
+            auto bigger = std::make_unique<table>(2 * (users->mask + 1));
+            for (size_t i = 0; i <= users->mask; ++i) {
+                for (node *entry = users->buckets[i].load(std::memory_order_relaxed); entry;
+                     entry = entry->next.load(std::memory_order_relaxed)) {
+                    std::atomic<node*> &head = bigger->bucket(hash_of(entry->record.usr_ID));
+                    head.store(new node(head.load(std::memory_order_relaxed), entry->record), std::memory_order_relaxed);
+                }
+            }
+            s.retired_list.reserve(s.retired_list.size() + 1);
+            s.current.store(bigger.get(), std::memory_order_seq_cst);
+            retire(s, nullptr, users);
+            return bigger.release();
+        }
+
+        // 用户记录的修改钩子的默认值：什么也不做
+        struct no_hook {
+            void operator()(const user_record&) const noexcept {}
+        };
+
+        static void free_shard(shard &s) noexcept {
+            delete s.current.load(std::memory_order_relaxed);
+            for (auto &r : s.retired_list) {
+                delete r.entry;
+                delete r.buckets;
+            }
+            s.retired_list.clear();
+        }
+
+        public:
+        user_store() {
+            for (auto &s : shards) s.current.store(new table(USER_STORE_INITIAL_BUCKETS), std::memory_order_relaxed);
+        }
+
+        ~user_store() {
+            for (auto &s : shards) free_shard(s);
+        }
+
+        user_store(const user_store&) = delete;
+        user_store& operator=(const user_store&) = delete;
+
+        /**
+         * @brief 在读区内访问一条记录，找到时调用 visitor 并返回 true。visitor 中不能再读取或修改用户表。
+         */
+        template<typename Visitor>
+        bool visit(std::string_view username, Visitor &&visitor) const {
+            size_t hash = hash_of(username);
+            return read_shard(shards[hash % USER_STORE_SHARDS], [&](const table &users) {
+                const node *entry = find_node(users, username, hash);
+                if (!entry) return false;
+                visitor(entry->record);
+                return true;
+            });
+        }
+
+        /**
+         * @brief 只取出密码哈希，登录校验走这里，一次查找且不分配内存。
+         */
+        std::optional<password_hash> find_password(std::string_view username) const {
+            std::optional<password_hash> result;
+            visit(username, [&](const user_record &record) { result = record.password; });
+            return result;
+        }
+
+        std::optional<user_record> find(std::string_view username) const {
+            std::optional<user_record> result;
+            visit(username, [&](const user_record &record) { result = record; });
+            return result;
+        }
+
+        bool contains(std::string_view username) const {
+            return visit(username, [](const user_record&) {});
+        }
+
+        /**
+         * @brief 加入新用户。加入成功时在持有分片写锁期间以新记录调用 on_insert。
+         *
+         * @return bool 用户名已经存在时返回 false，不覆盖原有记录
+         */
+        template<typename Hook = no_hook>
+        bool insert(user_record record, Hook &&on_insert = Hook()) {
+            if (record.usr_ID.empty()) {
+                throw std::invalid_argument("Error: UserID cannot be empty.");
+            }
+            if (record.level < MIN_LEVEL || record.level > MAX_LEVEL) {
+                throw std::invalid_argument("Error: Level must be between 1 and 100.");
+            }
+            size_t hash = hash_of(record.usr_ID);
+            shard &s = shards[hash % USER_STORE_SHARDS];
+            std::lock_guard guard(s.write_lock);
+            table *users = s.current.load(std::memory_order_relaxed);
+            if (find_link(*users, record.usr_ID, hash)) return false;
+            if (s.count.load(std::memory_order_relaxed) > users->mask) users = grow(s, users);
+
+            std::atomic<node*> &head = users->bucket(hash);
+            node *added = new node(head.load(std::memory_order_relaxed), std::move(record));
+            head.store(added, std::memory_order_seq_cst);
+            s.count.fetch_add(1, std::memory_order_relaxed);
+            on_insert(added->record);
+            reclaim(s);
+            return true;
+        }
+
+        /**
+         * @brief 修改一条已有记录，mutator 作用在副本上，返回 false 时放弃修改；用户名不能修改。
+         * 修改成功时在持有分片写锁期间以新记录调用 on_modify。
+         *
+         * @return bool 用户不存在或 mutator 放弃修改时返回 false
+         */
+        template<typename Mutator, typename Hook = no_hook>
+        bool modify(std::string_view username, Mutator &&mutator, Hook &&on_modify = Hook()) {
+            size_t hash = hash_of(username);
+            shard &s = shards[hash % USER_STORE_SHARDS];
+            std::lock_guard guard(s.write_lock);
+            std::atomic<node*> *link = find_link(*s.current.load(std::memory_order_relaxed), username, hash);
+            if (!link) return false;
+            node *original = link->load(std::memory_order_relaxed);
+            user_record record = original->record;
+            if (!mutator(record)) return false;
+            record.usr_ID = original->record.usr_ID;
+
+            // 新结点接在原结点的后继上，正在原结点上的读者仍能沿旧链走完
+            node *modified = new node(original->next.load(std::memory_order_relaxed), std::move(record));
+            s.retired_list.reserve(s.retired_list.size() + 1);
+            link->store(modified, std::memory_order_seq_cst);
+            retire(s, original, nullptr);
+            on_modify(modified->record);
+            reclaim(s);
+            return true;
+        }
+
+        bool erase(std::string_view username) {
+            size_t hash = hash_of(username);
+            shard &s = shards[hash % USER_STORE_SHARDS];
+            std::lock_guard guard(s.write_lock);
+            std::atomic<node*> *link = find_link(*s.current.load(std::memory_order_relaxed), username, hash);
+            if (!link) return false;
+            node *removed = link->load(std::memory_order_relaxed);
+            s.retired_list.reserve(s.retired_list.size() + 1);
+            link->store(removed->next.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+            s.count.fetch_sub(1, std::memory_order_relaxed);
+            retire(s, removed, nullptr);
+            reclaim(s);
+            return true;
+        }
+
+        /**
+         * @brief 依次访问全部记录，每个分片在各自的读区内访问，访问期间写者照常修改，不等待。
+         * 得到的不是同一时刻的整体快照，访问期间修改的记录可能看到新值也可能看到旧值。visitor 中不能再读取或修改用户表。
+         */
+        template<typename Visitor>
+        void for_each(Visitor &&visitor) const {
+            for (const auto &s : shards) {
+                read_shard(s, [&](const table &users) {
+                    for (size_t i = 0; i <= users.mask; ++i) {
+                        for (const node *entry = users.buckets[i].load(std::memory_order_acquire); entry;
+                             entry = entry->next.load(std::memory_order_acquire)) {
+                            visitor(entry->record);
+                        }
+                    }
+                    return true;
+                });
+            }
+        }
+
+        /**
+         * @brief 以一组记录整体替换用户表，每个分片只构建一次，用于启动时从快照与日志恢复。
+         * 不能与其他读写并发调用。同名的记录以后出现的为准。
+         */
+        void assign(std::vector<user_record> records) {
+            std::unique_ptr<table> loaded[USER_STORE_SHARDS];
+            size_t counts[USER_STORE_SHARDS] = {};
+            size_t bucket_count = USER_STORE_INITIAL_BUCKETS;
+            while (bucket_count * USER_STORE_SHARDS < records.size()) bucket_count *= 2;
+            for (auto &users : loaded) users = std::make_unique<table>(bucket_count);
+
+            for (auto &record : records) {
+                size_t hash = hash_of(record.usr_ID);
+                size_t index = hash % USER_STORE_SHARDS;
+                std::atomic<node*> *link = find_link(*loaded[index], record.usr_ID, hash);
+                if (link) {
+                    link->load(std::memory_order_relaxed)->record = std::move(record);
+                    continue;
+                }
+                std::atomic<node*> &head = loaded[index]->bucket(hash);
+                head.store(new node(head.load(std::memory_order_relaxed), std::move(record)), std::memory_order_relaxed);
+                ++counts[index];
+            }
+            for (size_t i = 0; i < USER_STORE_SHARDS; ++i) {
+                free_shard(shards[i]);
+                shards[i].current.store(loaded[i].release(), std::memory_order_seq_cst);
+                shards[i].count.store(counts[i], std::memory_order_relaxed);
+            }
+        }
+
+        size_t size() const {
+            size_t total = 0;
+            for (const auto &s : shards) total += s.count.load(std::memory_order_relaxed);
+            return total;
+        }
+};
\ No newline at end of file
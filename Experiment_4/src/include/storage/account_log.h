@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+#include "group_commit_log.h"
+#include "../security/user_store.h"
+
+// 快照文件的魔数与格式版本
+constexpr char ACCOUNT_SNAPSHOT_MAGIC[8] = {'B', 'B', 'A', 'C', 'C', 'S', 'N', 'P'};
+constexpr uint32_t ACCOUNT_SNAPSHOT_VERSION = 1;
+// 距离上一次快照写入这么多条日志后自动做一次快照，恢复时最多重放这么多条
+constexpr uint64_t ACCOUNT_SNAPSHOT_INTERVAL = 100000;
+// 写快照失败后重试的间隔
+constexpr std::chrono::seconds SNAPSHOT_RETRY_INTERVAL{10};
+
+// 账户日志记录的类型，两种记录都携带账户的完整状态，重放时按顺序覆盖即可
+enum class account_change_t : uint8_t {
+    SIGNUP = 1,             // 注册新账户
+    PASSWORD_CHANGED = 2    // 修改密码
+};
+
+// 快照文件的首部，其后是与日志格式相同的记录帧
+struct account_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t next_segment;      // 快照之后的修改从这一段日志开始
+    uint64_t record_count;
+};
+
+/**
+ * @brief 恢复的结果，供启动时输出。
+ */
+struct account_recovery {
+    size_t accounts = 0;
+    size_t snapshot_records = 0;
+    size_t log_records = 0;
+    size_t log_segments = 0;
+    bool torn_tail = false;     // 有日志段以写了一半的记录结尾，它们从未确认给客户端，已丢弃
+};
+
+/**
+ * @brief 用户表的持久化：注册与改密先写入成组提交的预写日志，落盘后才回复客户端；
+ * 日志每增长 ACCOUNT_SNAPSHOT_INTERVAL 条，后台线程把整张用户表写成一个紧凑的快照并删除旧日志段。
+ * 启动时读取快照、按顺序重放其后的日志段，恢复时间只与账户数和最近一次快照之后的日志长度有关。
+ * 日志中只保存密码的加盐哈希，与用户表本身一致。
+ *
+ * 快照不读取内存中的用户表：内存中的注册与改密在落盘之前就已经可见，落盘失败时还会被撤销。
+ * 切换日志段之后，旧段中的每条记录都已经落盘并回调完毕，快照由上一个快照加上这些旧段重放得到，
+ * 恰好是新段序号之前已经提交的状态；之后的修改只在新段里。每条记录都携带账户的完整状态，重放只是按顺序覆盖。
+ *
+ */
+class account_log{
+
+        private:
+        user_store &users;
+        std::string directory;
+        group_commit_log log;
+        uint64_t snapshot_interval;
+
+        std::atomic<uint64_t> since_snapshot;
+        std::atomic<uint64_t> snapshot_count;
+        std::mutex snapshot_lock;           // 同一时间只写一个快照
+        std::mutex wait_lock;
+        std::condition_variable wake;
+        bool stopping;
+        std::thread snapshotter;
+
+        std::string snapshot_path() const {
+            return directory + "/accounts.snapshot";
+        }
+
+        /*
+         * 记录内容（主机字节序）：
+         *   type(1) level(1) id_length(1) name_length(1) iterations(4) salt(16) digest(32) usr_ID usr_name
+         */
+        static constexpr size_t RECORD_FIXED_SIZE = 4 + 4 + PASSWORD_SALT_BYTES + sha256::DIGEST_BYTES;
+
+        static std::string encode(account_change_t change, const user_record &record) {
+            std::string_view id = std::string_view(record.usr_ID).substr(0, UINT8_MAX);
+            std::string_view name = std::string_view(record.usr_name).substr(0, UINT8_MAX);
+            std::string bytes(RECORD_FIXED_SIZE, '\0');
+            bytes[0] = static_cast<char>(change);
+            bytes[1] = static_cast<char>(record.level);
+            bytes[2] = static_cast<char>(id.size());
+            bytes[3] = static_cast<char>(name.size());
+            std::memcpy(bytes.data() + 4, &record.password.iterations, 4);
+            std::memcpy(bytes.data() + 8, record.password.salt.data(), PASSWORD_SALT_BYTES);
+            std::memcpy(bytes.data() + 8 + PASSWORD_SALT_BYTES, record.password.digest.data(), sha256::DIGEST_BYTES);
+            bytes.append(id);
+            bytes.append(name);
+            return bytes;
+        }
+
+        static std::optional<user_record> decode(std::string_view bytes) {
+            if (bytes.size() < RECORD_FIXED_SIZE) return std::nullopt;
+            uint8_t type = static_cast<uint8_t>(bytes[0]);
+            size_t id_length = static_cast<uint8_t>(bytes[2]);
+            size_t name_length = static_cast<uint8_t>(bytes[3]);
+            if ((type != static_cast<uint8_t>(account_change_t::SIGNUP) &&
+                 type != static_cast<uint8_t>(account_change_t::PASSWORD_CHANGED)) ||
+                bytes.size() != RECORD_FIXED_SIZE + id_length + name_length || id_length == 0) {
+                return std::nullopt;
+            }
+
+            user_record record;
+            record.level = static_cast<uint8_t>(bytes[1]);
+            std::memcpy(&record.password.iterations, bytes.data() + 4, 4);
+            std::memcpy(record.password.salt.data(), bytes.data() + 8, PASSWORD_SALT_BYTES);
+            std::memcpy(record.password.digest.data(), bytes.data() + 8 + PASSWORD_SALT_BYTES, sha256::DIGEST_BYTES);
+            record.usr_ID = bytes.substr(RECORD_FIXED_SIZE, id_length);
+            record.usr_name = bytes.substr(RECORD_FIXED_SIZE + id_length, name_length);
+            if (record.level < MIN_LEVEL || record.level > MAX_LEVEL) return std::nullopt;
+            return record;
+        }
+
+        // 读取快照，返回其后的第一个日志段序号；没有快照时返回 0
+        uint64_t load_snapshot(std::vector<user_record> &records, account_recovery &result) const {
+            std::string path = snapshot_path();
+            FILE *file = std::fopen(path.c_str(), "rb");
+            if (!file) {
+                if (errno == ENOENT) return 0;
+                throw std::runtime_error("Error: Failed to open '" + path + "' - " + strerror(errno));
+            }
+
+            account_snapshot_header header{};
+            bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                         std::memcmp(header.magic, ACCOUNT_SNAPSHOT_MAGIC, sizeof(ACCOUNT_SNAPSHOT_MAGIC)) == 0 &&
+                         header.version == ACCOUNT_SNAPSHOT_VERSION && header.byte_order == LOG_BYTE_ORDER;
+            std::string body;
+            for (uint64_t i = 0; valid && i < header.record_count; ++i) {
+                log_record_header frame{};
+                valid = std::fread(&frame, sizeof(frame), 1, file) == 1 && frame.length <= LOG_MAX_RECORD_SIZE;
+                if (!valid) break;
+                body.resize(frame.length);
+                valid = std::fread(body.data(), 1, body.size(), file) == body.size() &&
+                        crc32c(body.data(), body.size()) == frame.checksum;
+                if (!valid) break;
+                std::optional<user_record> record = decode(body);
+                valid = record.has_value();
+                if (valid) records.push_back(std::move(*record));
+            }
+            std::fclose(file);
+            // 快照是 rename 上去的，不会写了一半；损坏时旧日志已经删除，不能带着缺失的账户启动
+            if (!valid) {
+                throw std::runtime_error("Error: Account snapshot '" + path + "' is corrupted.");
+            }
+            result.snapshot_records = header.record_count;
+            return header.next_segment;
+        }
+
+        /**
+         * @brief 读取快照与序号小于 end 的日志段，记录按提交顺序追加到 records，同名账户以后出现的为准。
+         *
+         * @return uint64_t 最后一个读取的日志段之后的序号，没有日志段时为快照之后的第一段
+         */
+        uint64_t load_committed(uint64_t end, std::vector<user_record> &records, account_recovery &result) const {
+            uint64_t first_segment = load_snapshot(records, result);
+            uint64_t next_segment = first_segment;
+            for (uint64_t sequence : log.list_segments()) {
+                if (sequence >= end) break;
+                next_segment = sequence + 1;
+                if (sequence < first_segment) continue;
+                ++result.log_segments;
+                bool complete = log.replay(sequence, [&](std::string_view bytes) {
+                    std::optional<user_record> record = decode(bytes);
+                    if (!record) return;
+                    records.push_back(std::move(*record));
+                    ++result.log_records;
+                });
+                if (!complete) result.torn_tail = true;
+            }
+            return next_segment;
+        }
+
+        void snapshot_main() {
+            std::unique_lock guard(wait_lock);
+            while (true) {
+                wake.wait(guard, [this]() {
+                    return stopping || since_snapshot.load(std::memory_order_relaxed) >= snapshot_interval;
+                });
+                if (stopping) return;
+                guard.unlock();
+                bool written = snapshot();
+                guard.lock();
+                // 写快照失败（例如磁盘已满）时过一段时间再试，日志照常写入
+                if (!written) wake.wait_for(guard, SNAPSHOT_RETRY_INTERVAL, [this]() { return stopping; });
+            }
+        }
+
+        public:
+        /**
+         * @param store 被持久化的用户表
+         * @param data_directory 日志与快照所在的目录，不存在时创建
+         */
+        account_log(user_store &store, std::string data_directory, uint64_t interval = ACCOUNT_SNAPSHOT_INTERVAL)
+        : users(store), directory(std::move(data_directory)), log(directory, "accounts"),
+          snapshot_interval(interval > 0 ? interval : 1), since_snapshot(0), snapshot_count(0), stopping(false) {}
+
+        ~account_log() {
+            stop();
+        }
+
+        account_log(const account_log&) = delete;
+        account_log& operator=(const account_log&) = delete;
+
+        /**
+         * @brief 从快照与日志恢复用户表，然后打开新的日志段并启动快照线程。在用户表被访问之前调用一次。
+         */
+        account_recovery recover() {
+            ensure_directory(directory);
+            account_recovery result;
+            std::vector<user_record> records;
+            uint64_t next_segment = load_committed(UINT64_MAX, records, result);
+
+            users.assign(std::move(records));
+            result.accounts = users.size();
+            since_snapshot.store(result.log_records, std::memory_order_relaxed);
+
+            log.open(next_segment);
+            snapshotter = std::thread(&account_log::snapshot_main, this);
+            return result;
+        }
+
+        /**
+         * @brief 把一次账户修改追加到日志，应当在 user_store 的修改钩子中调用，保证同一账户的记录与修改顺序一致。
+         * 记录落盘后在日志的写线程中调用 done(true)，写入失败时调用 done(false)。
+         *
+         * @return bool 日志不可用时返回 false，done 不会被调用，调用者应当撤销修改
+         */
+        bool append(account_change_t change, const user_record &record, group_commit_log::completion_t done) {
+            if (!log.append(encode(change, record), std::move(done))) return false;
+            if (since_snapshot.fetch_add(1, std::memory_order_relaxed) + 1 == snapshot_interval) {
+                // 先取得锁再通知，快照线程不会在检查条件之后、进入等待之前错过这次通知
+                std::lock_guard guard(wait_lock);
+                wake.notify_one();
+            }
+            return true;
+        }
+
+        /**
+         * @brief 立即写一个快照：切换日志段，把新段之前已经提交的账户写入临时文件并 fsync，
+         * rename 为快照后删除已经包含在内的日志段。期间注册与改密照常进行，写入新段。
+         *
+         * @return bool 是否成功，失败时旧的快照与日志都保持不变
+         */
+        bool snapshot() {
+            std::lock_guard guard(snapshot_lock);
+            std::optional<uint64_t> next_segment = log.rotate();
+            if (!next_segment) return false;
+            since_snapshot.store(0, std::memory_order_relaxed);
+            // 出过写错误的日志段里可能留有未确认的记录，不能把它们合进快照
+            if (!log.healthy()) return false;
+
+            std::vector<user_record> records;
+            account_recovery loaded;
+            try {
+                load_committed(*next_segment, records, loaded);
+            } catch (const std::runtime_error &) {
+                return false;
+            }
+            std::unordered_map<std::string_view, size_t> latest;
+            for (size_t i = 0; i < records.size(); ++i) latest[records[i].usr_ID] = i;
+
+            std::string path = snapshot_path();
+            std::string temp_path = path + ".tmp";
+            FILE *file = std::fopen(temp_path.c_str(), "wb");
+            if (!file) return false;
+
+            account_snapshot_header header{};
+            std::memcpy(header.magic, ACCOUNT_SNAPSHOT_MAGIC, sizeof(ACCOUNT_SNAPSHOT_MAGIC));
+            header.version = ACCOUNT_SNAPSHOT_VERSION;
+            header.byte_order = LOG_BYTE_ORDER;
+            header.next_segment = *next_segment;
+            bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+            for (size_t i = 0; i < records.size() && ok; ++i) {
+                if (latest[records[i].usr_ID] != i) continue;
+                std::string bytes = encode(account_change_t::SIGNUP, records[i]);
+                log_record_header frame{static_cast<uint32_t>(bytes.size()), crc32c(bytes.data(), bytes.size())};
+                ok = std::fwrite(&frame, sizeof(frame), 1, file) == 1 &&
+                     std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+                ++header.record_count;
+            }
+            // 记录数写完之后才知道，回填首部
+            ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+            ok = std::fclose(file) == 0 && ok;
+            if (!ok || std::rename(temp_path.c_str(), path.c_str()) < 0 || !sync_directory(directory)) {
+                unlink(temp_path.c_str());
+                return false;
+            }
+
+            log.remove_before(*next_segment);
+            snapshot_count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief 写出日志中剩余的记录并停止快照线程。日志的完成回调会向事件循环投递结果，必须在事件循环销毁之前调用。
+         */
+        void stop() {
+            {
+                std::lock_guard guard(wait_lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            if (snapshotter.joinable()) snapshotter.join();
+            log.stop();
+        }
+
+        bool healthy() const noexcept {
+            return log.healthy();
+        }
+
+        uint64_t records() const noexcept {
+            return log.records();
+        }
+
+        uint64_t batches() const noexcept {
+            return log.batches();
+        }
+
+        uint64_t snapshots() const noexcept {
+            return snapshot_count.load(std::memory_order_relaxed);
+        }
+};
\ No newline at end of file
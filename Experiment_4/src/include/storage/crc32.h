@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 以查表法计算 CRC-32C（Castagnoli），用于发现日志与快照中写了一半或损坏的记录。
+ * 表在编译期生成；crc 参数可以传入上一段的结果，分段计算与一次计算的结果相同。
+ */
+inline uint32_t crc32c(const void *data, size_t size, uint32_t crc = 0) noexcept {
+    static constexpr std::array<uint32_t, 256> TABLE = []() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) value = (value >> 1) ^ (value & 1 ? 0x82f63b78u : 0);
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    const uint8_t *ptr = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = TABLE[(crc ^ ptr[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
\ No newline at end of file
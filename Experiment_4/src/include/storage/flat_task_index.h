@@ -0,0 +1,298 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief 以 uint64_t 任务 ID 为键的开放寻址哈希表，取代 std::unordered_map 的按节点分配。
+ * 控制字节、键与值分别存放在三个连续数组中（SoA）：每个槽一个控制字节，满槽存放哈希的低 7 位，
+ * 空槽与删除标记的最高位为 1。查找按 16 个槽一组探测，SSE2 一条比较同时检查一组的控制字节，
+ * 只有控制字节匹配的槽才读取键，值数组只在命中时访问，一次查找通常只触及两三条缓存行。
+ * 删除留下墓碑，探测链不断开；墓碑与满槽合计超过 7/8 时按需扩容或原地重建。
+ * 本身不加锁，并发访问由调用者保护；插入可能重建整个表，之前取得的指针随之失效。
+ *
+ */
+template<typename Value>
+class flat_task_index{
+
+        private:
+        static constexpr size_t GROUP_SIZE = 16;
+        static constexpr uint8_t EMPTY = 0x80;
+        static constexpr uint8_t DELETED = 0xFE;
+        static constexpr size_t MIN_CAPACITY = GROUP_SIZE;
+
+        uint8_t *control;
+        uint64_t *keys;
+        Value *values;              // 只有满槽上构造了对象
+        size_t capacity;            // 0 或 GROUP_SIZE 乘以 2 的幂
+        size_t count;
+        size_t tombstones;
+
+        // 任务 ID 通常是连续分配的，先打散再取位：高位选组，低 7 位存进控制字节
+        static uint64_t mix(uint64_t key) noexcept {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return key;
+        }
+
+        static uint8_t fingerprint(uint64_t hash) noexcept {
+            return static_cast<uint8_t>(hash & 0x7f);
+        }
+
+        // 一组控制字节中等于 byte 的槽位掩码，第 i 位对应组内第 i 个槽
+        static uint32_t match(const uint8_t *group, uint8_t byte) noexcept {
+#ifdef __SSE2__
+            __m128i slots = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+            __m128i wanted = _mm_set1_epi8(static_cast<char>(byte));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(slots, wanted)));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) mask |= uint32_t{group[i] == byte} << i;
+            return mask;
+#endif
+        }
+
+        // 空槽或墓碑（最高位为 1）的槽位掩码
+        static uint32_t match_free(const uint8_t *group) noexcept {
+#ifdef __SSE2__
+            __m128i slots = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+            return static_cast<uint32_t>(_mm_movemask_epi8(slots));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP_SIZE; ++i) mask |= uint32_t{(group[i] & 0x80) != 0} << i;
+            return mask;
+#endif
+        }
+
+        size_t group_mask() const noexcept {
+            return capacity / GROUP_SIZE - 1;
+        }
+
+        /**
+         * @brief 沿探测序列查找 key，命中时返回槽位；未命中时返回 capacity。
+         * 组序号按三角数递增，容量为 2 的幂时会访问到每一组；遇到含空槽的组即可确定 key 不存在。
+         */
+        size_t locate(uint64_t key) const noexcept {
+            if (capacity == 0) return capacity;
+            uint64_t hash = mix(key);
+            uint8_t wanted = fingerprint(hash);
+            size_t group = static_cast<size_t>(hash >> 7) & group_mask();
+            for (size_t step = 1;; ++step) {
+                const uint8_t *slots = control + group * GROUP_SIZE;
+                for (uint32_t hits = match(slots, wanted); hits != 0; hits &= hits - 1) {
+                    size_t slot = group * GROUP_SIZE + static_cast<size_t>(__builtin_ctz(hits));
+                    if (keys[slot] == key) return slot;
+                }
+                if (match(slots, EMPTY) != 0) return capacity;
+                group = (group + step) & group_mask();
+            }
+        }
+
+        // key 不在表中且表中有空位时，取探测序列上第一个空槽或墓碑
+        size_t free_slot(uint64_t key) const noexcept {
+            size_t group = static_cast<size_t>(mix(key) >> 7) & group_mask();
+            for (size_t step = 1;; ++step) {
+                uint32_t free = match_free(control + group * GROUP_SIZE);
+                if (free != 0) return group * GROUP_SIZE + static_cast<size_t>(__builtin_ctz(free));
+                group = (group + step) & group_mask();
+            }
+        }
+
+        void release() noexcept {
+            if (!control) return;
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                if (!(control[slot] & 0x80)) values[slot].~Value();
+            }
+            delete[] control;
+            delete[] keys;
+            std::allocator<Value>().deallocate(values, capacity);
+            control = nullptr;
+            keys = nullptr;
+            values = nullptr;
+        }
+
+        // 以新的容量重建，墓碑随之清除；值按移动构造搬到新位置
+        void rehash(size_t new_capacity) {
+            flat_task_index rebuilt;
+            rebuilt.allocate(new_capacity);
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                if (control[slot] & 0x80) continue;
+                size_t target = rebuilt.free_slot(keys[slot]);
+                rebuilt.control[target] = control[slot];
+                rebuilt.keys[target] = keys[slot];
+                ::new (static_cast<void*>(rebuilt.values + target)) Value(std::move(values[slot]));
+                ++rebuilt.count;
+            }
+            swap(rebuilt);
+        }
+
+        void allocate(size_t new_capacity) {
+            control = new uint8_t[new_capacity];
+            std::memset(control, EMPTY, new_capacity);
+            keys = new uint64_t[new_capacity];
+            values = std::allocator<Value>().allocate(new_capacity);
+            capacity = new_capacity;
+        }
+
+        // 为一次插入预留空位：满槽与墓碑合计不超过容量的 7/8
+        void reserve_one() {
+            if (capacity == 0) {
+                allocate(MIN_CAPACITY);
+            } else if ((count + tombstones + 1) * 8 > capacity * 7) {
+                // 墓碑占了大半时原地重建即可，否则翻倍
+                rehash(count * 2 + 2 > capacity ? capacity * 2 : capacity);
+            }
+        }
+
+        void swap(flat_task_index &other) noexcept {
+            std::swap(control, other.control);
+            std::swap(keys, other.keys);
+            std::swap(values, other.values);
+            std::swap(capacity, other.capacity);
+            std::swap(count, other.count);
+            std::swap(tombstones, other.tombstones);
+        }
+
+        public:
+        flat_task_index() noexcept
+        : control(nullptr), keys(nullptr), values(nullptr), capacity(0), count(0), tombstones(0) {}
+
+        ~flat_task_index() {
+            release();
+        }
+
+        flat_task_index(const flat_task_index&) = delete;
+        flat_task_index& operator=(const flat_task_index&) = delete;
+
+        flat_task_index(flat_task_index &&other) noexcept
+        : flat_task_index() {
+            swap(other);
+        }
+
+        flat_task_index& operator=(flat_task_index &&other) noexcept {
+            if (this != &other) {
+                release();
+                capacity = count = tombstones = 0;
+                swap(other);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief 一次探测取得 key 对应的值，不存在时返回 nullptr。
+         */
+        Value *find(uint64_t key) noexcept {
+            size_t slot = locate(key);
+            return slot == capacity ? nullptr : values + slot;
+        }
+
+        const Value *find(uint64_t key) const noexcept {
+            size_t slot = locate(key);
+            return slot == capacity ? nullptr : values + slot;
+        }
+
+        bool contains(uint64_t key) const noexcept {
+            return locate(key) != capacity;
+        }
+
+        /**
+         * @brief 写入 key 对应的值，已经存在时覆盖。
+         *
+         * @return Value& 表中的值，下一次插入之前有效
+         */
+        template<typename V>
+        Value &assign(uint64_t key, V &&value) {
+            size_t slot = locate(key);
+            if (slot != capacity) {
+                values[slot] = std::forward<V>(value);
+                return values[slot];
+            }
+            reserve_one();
+            slot = free_slot(key);
+            if (control[slot] == DELETED) --tombstones;
+            ::new (static_cast<void*>(values + slot)) Value(std::forward<V>(value));
+            keys[slot] = key;
+            control[slot] = fingerprint(mix(key));
+            ++count;
+            return values[slot];
+        }
+
+        /**
+         * @brief 删除 key，留下墓碑。
+         *
+         * @return bool key 是否存在
+         */
+        bool erase(uint64_t key) noexcept {
+            size_t slot = locate(key);
+            if (slot == capacity) return false;
+            values[slot].~Value();
+            control[slot] = DELETED;
+            --count;
+            ++tombstones;
+            return true;
+        }
+
+        /**
+         * @brief 删除 predicate(key, value) 为 true 的全部项，返回删除的个数。
+         */
+        template<typename Predicate>
+        size_t erase_if(Predicate &&predicate) {
+            size_t erased = 0;
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                if ((control[slot] & 0x80) || !predicate(keys[slot], values[slot])) continue;
+                values[slot].~Value();
+                control[slot] = DELETED;
+                ++erased;
+            }
+            count -= erased;
+            tombstones += erased;
+            return erased;
+        }
+
+        /**
+         * @brief 按槽位顺序（不是 ID 顺序）访问全部项，visitor 的参数为 (uint64_t, const Value&)。
+         */
+        template<typename Visitor>
+        void for_each(Visitor &&visitor) const {
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                if (!(control[slot] & 0x80)) visitor(keys[slot], values[slot]);
+            }
+        }
+
+        // 同上，visitor 可以就地修改值，参数为 (uint64_t, Value&)
+        template<typename Visitor>
+        void for_each(Visitor &&visitor) {
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                if (!(control[slot] & 0x80)) visitor(keys[slot], values[slot]);
+            }
+        }
+
+        /**
+         * @brief 预留至少 n 项的空间，批量载入前调用可以避免逐次扩容。
+         */
+        void reserve(size_t n) {
+            size_t wanted = MIN_CAPACITY;
+            while (wanted * 7 < n * 8) wanted *= 2;
+            if (wanted > capacity) {
+                if (capacity == 0) allocate(wanted);
+                else rehash(wanted);
+            }
+        }
+
+        void clear() noexcept {
+            release();
+            capacity = count = tombstones = 0;
+        }
+
+        size_t size() const noexcept {
+            return count;
+        }
+};
\ No newline at end of file
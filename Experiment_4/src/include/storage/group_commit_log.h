@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "crc32.h"
+
+// 日志段文件的魔数与格式版本
+constexpr char LOG_SEGMENT_MAGIC[8] = {'B', 'B', 'W', 'A', 'L', 'O', 'G', '\0'};
+constexpr uint32_t LOG_SEGMENT_VERSION = 1;
+// 日志与快照按主机字节序写入，字节序不同的机器拒绝读取
+constexpr uint32_t LOG_BYTE_ORDER = 0x01020304;
+// 单条记录的上限，超过的长度字段视为损坏
+constexpr uint32_t LOG_MAX_RECORD_SIZE = 1 << 20;
+
+// 日志段的首部
+struct log_segment_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+};
+
+// 每条记录之前的帧首部，校验和覆盖记录内容
+struct log_record_header {
+    uint32_t length;
+    uint32_t checksum;
+};
+
+/**
+ * @brief 同步目录本身。新建、rename 或删除文件之后，目录项的变化要同步目录才算持久。
+ */
+inline bool sync_directory(const std::string &directory) noexcept {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief 确保目录存在，不存在时创建（只创建最后一级）。
+ */
+inline void ensure_directory(const std::string &directory) {
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        throw std::runtime_error("Error: Failed to create directory '" + directory + "' - " + strerror(errno));
+    }
+}
+
+/**
+ * @brief 成组提交的预写日志（write-ahead log）。
+ * 任意线程调用 append() 把记录放进队列后立即返回；唯一的写线程每次取走队列中的全部记录，
+ * 以 writev 一次写入、一次 fdatasync 落盘，然后依次调用各条记录的完成回调。
+ * 写线程落盘期间到达的记录自然成为下一批，并发越高每批越大，每秒提交的记录数不受单次 fsync 延迟限制。
+ * 日志按段存放在 <directory>/<name>-<序号>.wal 中，rotate() 切换到新的一段，快照写完后删除旧段，
+ * 恢复时间因此只与最近一次快照之后的记录数有关。每次打开都从新的一段开始，不续写旧段。
+ *
+ */
+class group_commit_log{
+
+        public:
+        using completion_t = std::function<void(bool durable)>;
+
+        private:
+        struct entry {
+            std::string bytes;          // 帧首部与记录内容
+            completion_t done;
+        };
+
+        std::string directory;
+        std::string name;
+
+        std::mutex lock;
+        std::condition_variable ready;
+        std::vector<entry> pending;
+        bool stopping;
+        std::thread writer;
+
+        // 当前段的文件，写线程写入与 rotate() 切换时持有
+        std::mutex io_lock;
+        int fd;
+        uint64_t segment;
+        std::atomic<bool> failed;
+
+        std::atomic<uint64_t> record_count;
+        std::atomic<uint64_t> batch_count;
+
+        bool open_segment(uint64_t sequence) {
+            std::string path = segment_path(sequence);
+            int new_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+            if (new_fd < 0) return false;
+
+            log_segment_header header{};
+            std::memcpy(header.magic, LOG_SEGMENT_MAGIC, sizeof(LOG_SEGMENT_MAGIC));
+            header.version = LOG_SEGMENT_VERSION;
+            header.byte_order = LOG_BYTE_ORDER;
+            if (::write(new_fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) ||
+                fdatasync(new_fd) < 0 || !sync_directory(directory)) {
+                close(new_fd);
+                return false;
+            }
+            if (fd >= 0) close(fd);
+            fd = new_fd;
+            segment = sequence;
+            return true;
+        }
+
+        // 把一批记录写入当前段并落盘，调用者持有 io_lock
+        bool write_batch(std::vector<entry> &batch) {
+            std::vector<iovec> iov;
+            iov.reserve(std::min<size_t>(batch.size(), IOV_MAX));
+            size_t next = 0;
+            while (next < batch.size()) {
+                iov.clear();
+                size_t total = 0;
+                for (; next < batch.size() && iov.size() < IOV_MAX; ++next) {
+                    iov.push_back({batch[next].bytes.data(), batch[next].bytes.size()});
+                    total += batch[next].bytes.size();
+                }
+                // 普通文件的 writev 只在出错时才会短写，短写按失败处理，该段从此不再写入
+                ssize_t n;
+                do {
+                    n = writev(fd, iov.data(), static_cast<int>(iov.size()));
+                } while (n < 0 && errno == EINTR);
+                if (n != static_cast<ssize_t>(total)) return false;
+            }
+            return fdatasync(fd) == 0;
+        }
+
+        void writer_main() {
+            std::vector<entry> batch;
+            while (true) {
+                {
+                    std::unique_lock guard(lock);
+                    ready.wait(guard, [this]() { return stopping || !pending.empty(); });
+                    if (pending.empty()) return;
+                    batch.swap(pending);
+                }
+
+                // 完成回调同样在持有 io_lock 时调用：rotate() 返回时，旧段中的记录都已经回调完毕
+                {
+                    std::lock_guard guard(io_lock);
+                    bool durable = !failed.load(std::memory_order_relaxed) && write_batch(batch);
+                    if (!durable) failed.store(true, std::memory_order_relaxed);
+                    record_count.fetch_add(batch.size(), std::memory_order_relaxed);
+                    batch_count.fetch_add(1, std::memory_order_relaxed);
+                    for (auto &e : batch) {
+                        if (e.done) e.done(durable);
+                    }
+                }
+                batch.clear();
+            }
+        }
+
+        public:
+        group_commit_log(std::string log_directory, std::string log_name)
+        : directory(std::move(log_directory)), name(std::move(log_name)), stopping(false), fd(-1), segment(0),
+          failed(false), record_count(0), batch_count(0) {}
+
+        ~group_commit_log() {
+            stop();
+        }
+
+        group_commit_log(const group_commit_log&) = delete;
+        group_commit_log& operator=(const group_commit_log&) = delete;
+
+        std::string segment_path(uint64_t sequence) const {
+            char suffix[32];
+            std::snprintf(suffix, sizeof(suffix), "-%016lx.wal", static_cast<unsigned long>(sequence));
+            return directory + "/" + name + suffix;
+        }
+
+        /**
+         * @brief 目录中已有的日志段序号，按升序排列。
+         */
+        std::vector<uint64_t> list_segments() const {
+            std::vector<uint64_t> segments;
+            DIR *dir = opendir(directory.c_str());
+            if (!dir) return segments;
+            std::string prefix = name + "-";
+            while (dirent *item = readdir(dir)) {
+                std::string_view file(item->d_name);
+                if (file.size() != prefix.size() + 16 + 4 || file.substr(0, prefix.size()) != prefix ||
+                    file.substr(file.size() - 4) != ".wal") {
+                    continue;
+                }
+                uint64_t sequence = 0;
+                bool valid = true;
+                for (char c : file.substr(prefix.size(), 16)) {
+                    int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+                    if (digit < 0) valid = false;
+                    sequence = sequence << 4 | static_cast<uint64_t>(digit & 0xf);
+                }
+                if (valid) segments.push_back(sequence);
+            }
+            closedir(dir);
+            std::sort(segments.begin(), segments.end());
+            return segments;
+        }
+
+        /**
+         * @brief 按顺序读出一个日志段中的记录。遇到写了一半或校验失败的记录时停止，之后的内容被忽略：
+         * 它们从未落盘成功，也就从未确认给任何客户端。
+         *
+         * @return bool 整段是否完整读完
+         */
+        template<typename Visitor>
+        bool replay(uint64_t sequence, Visitor &&visitor) const {
+            std::string path = segment_path(sequence);
+            FILE *file = std::fopen(path.c_str(), "rb");
+            if (!file) {
+                throw std::runtime_error("Error: Failed to open log segment '" + path + "' - " + strerror(errno));
+            }
+            log_segment_header header{};
+            if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+                std::memcmp(header.magic, LOG_SEGMENT_MAGIC, sizeof(LOG_SEGMENT_MAGIC)) != 0 ||
+                header.version != LOG_SEGMENT_VERSION || header.byte_order != LOG_BYTE_ORDER) {
+                std::fclose(file);
+                return false;
+            }
+
+            std::string body;
+            bool complete = true;
+            while (true) {
+                log_record_header record{};
+                size_t n = std::fread(&record, 1, sizeof(record), file);
+                if (n == 0) break;
+                if (n != sizeof(record) || record.length > LOG_MAX_RECORD_SIZE) {
+                    complete = false;
+                    break;
+                }
+                body.resize(record.length);
+                if (std::fread(body.data(), 1, body.size(), file) != body.size() ||
+                    crc32c(body.data(), body.size()) != record.checksum) {
+                    complete = false;
+                    break;
+                }
+                visitor(std::string_view(body));
+            }
+            std::fclose(file);
+            return complete;
+        }
+
+        /**
+         * @brief 以序号 sequence 新建一段日志并启动写线程，只能调用一次。
+         */
+        void open(uint64_t sequence) {
+            std::lock_guard guard(io_lock);
+            if (!open_segment(sequence)) {
+                throw std::runtime_error("Error: Failed to create log segment '" + segment_path(sequence) + "' - " +
+                                         strerror(errno));
+            }
+            writer = std::thread(&group_commit_log::writer_main, this);
+        }
+
+        /**
+         * @brief 追加一条记录，可以在任意线程调用。记录所在的一批落盘后在写线程中调用 done。
+         * 同一线程先后追加的记录按顺序写入；调用者需要跨线程的顺序时，应在同一把锁下修改状态并追加。
+         *
+         * @return bool 日志已经停止或出过写错误时返回 false，此时 done 不会被调用
+         */
+        bool append(std::string_view record, completion_t done) {
+            if (failed.load(std::memory_order_relaxed)) return false;
+            entry e;
+            log_record_header header{static_cast<uint32_t>(record.size()), crc32c(record.data(), record.size())};
+            e.bytes.reserve(sizeof(header) + record.size());
+            e.bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+            e.bytes.append(record);
+            e.done = std::move(done);
+            {
+                std::lock_guard guard(lock);
+                if (stopping) return false;
+                pending.push_back(std::move(e));
+            }
+            ready.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief 切换到新的一段，之后写出的记录都在新段中。正在写出的一批连同它的完成回调结束后才切换，
+         * 因此返回时旧段中每条记录的回调都已经执行过。不能在完成回调所需的锁内调用。
+         *
+         * @return std::optional<uint64_t> 新段的序号，创建失败时为空，日志继续写入原来的段
+         */
+        std::optional<uint64_t> rotate() {
+            std::lock_guard guard(io_lock);
+            if (!open_segment(segment + 1)) return std::nullopt;
+            return segment;
+        }
+
+        /**
+         * @brief 删除序号小于 sequence 的日志段，它们的内容已经包含在快照中。
+         */
+        void remove_before(uint64_t sequence) {
+            for (uint64_t old : list_segments()) {
+                if (old < sequence) unlink(segment_path(old).c_str());
+            }
+            sync_directory(directory);
+        }
+
+        /**
+         * @brief 写出队列中剩余的记录并停止写线程，之后的 append() 返回 false。
+         */
+        void stop() {
+            {
+                std::lock_guard guard(lock);
+                stopping = true;
+            }
+            ready.notify_all();
+            if (writer.joinable()) writer.join();
+            std::lock_guard guard(io_lock);
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+
+        bool healthy() const noexcept {
+            return !failed.load(std::memory_order_relaxed);
+        }
+
+        // 已经写出的记录数与批次数，两者之比即平均每次 fsync 提交的记录数
+        uint64_t records() const noexcept {
+            return record_count.load(std::memory_order_relaxed);
+        }
+
+        uint64_t batches() const noexcept {
+            return batch_count.load(std::memory_order_relaxed);
+        }
+};
\ No newline at end of file
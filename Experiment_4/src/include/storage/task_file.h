@@ -0,0 +1,333 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../protocols/TITP.h"
+
+// 任务文件的魔数与格式版本
+constexpr char TASK_FILE_MAGIC[8] = {'B', 'B', 'T', 'A', 'S', 'K', 'S', '\0'};
+constexpr uint32_t TASK_FILE_VERSION = 1;
+// 写入时的字节序标记：文件按主机字节序直接映射使用，字节序不同的机器拒绝打开
+constexpr uint32_t TASK_FILE_BYTE_ORDER = 0x01020304;
+// 任务名称的最大长度（不含结尾的 '\0'），与 TITP 响应中的名称字段一致
+constexpr size_t MAX_TASK_NAME_LENGTH = 63;
+
+/**
+ * @brief 任务文件的首部，位于文件开头，固定 64 字节。
+ */
+struct task_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint64_t record_count;      // 记录槽的数量，等于最大任务 ID + 1，0 号槽不使用
+    uint64_t task_count;        // 实际存在的任务数
+    uint64_t records_offset;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+};
+static_assert(sizeof(task_file_header) == 64, "task_file_header must be 64 bytes");
+
+/**
+ * @brief 一个任务的定长元数据，记录数组以任务 ID 为下标。
+ * 名称与描述依次存放在字符串堆中，各自以 '\0' 结尾，长度不含结尾的 '\0'。
+ */
+struct task_file_record {
+    uint64_t text_offset;       // 名称在字符串堆中的偏移，描述紧随其后
+    uint16_t name_length;
+    uint16_t description_length;
+    uint8_t difficulty;
+    uint8_t flags;
+    uint8_t reserved[2];
+};
+static_assert(sizeof(task_file_record) == 16, "task_file_record must be 16 bytes");
+
+// task_file_record::flags：该槽存放着一个任务
+constexpr uint8_t TASK_RECORD_PRESENT = 0x01;
+// task_file_record::flags：任务已关闭
+constexpr uint8_t TASK_RECORD_CLOSED = 0x02;
+
+/**
+ * @brief 从任务文件中读出的一个任务，字符串直接指向映射的内存，文件关闭后失效。
+ */
+struct task_view {
+    uint64_t task_id;
+    std::string_view name;              // 以 '\0' 结尾，可以直接当作 C 字符串使用
+    std::string_view description;
+    task_difficulty_t difficulty;
+    bool closed;
+};
+
+/**
+ * @brief 只读映射的任务文件：首部、以任务 ID 为下标的定长记录数组、字符串堆。
+ * 打开时只校验首部与各区段的边界，不读取记录，启动时间与任务数量无关；
+ * 查找是一次数组下标运算，数据按需由缺页从页缓存读入，多个进程打开同一个文件时共享同一份物理页。
+ * 映射只读，可以被多个线程同时读取。替换文件应当写入新文件后 rename，已经打开的映射仍然指向旧文件。
+ *
+ */
+class task_file{
+
+        private:
+        void *mapping;
+        size_t mapping_size;
+        const task_file_header *header;
+        const task_file_record *records;
+        const char *heap;
+
+        void unmap() noexcept {
+            if (mapping) munmap(mapping, mapping_size);
+            mapping = nullptr;
+            mapping_size = 0;
+            header = nullptr;
+            records = nullptr;
+            heap = nullptr;
+        }
+
+        // 区段 [offset, offset + size) 是否在文件之内，不会溢出
+        static bool within(uint64_t offset, uint64_t size, uint64_t total) noexcept {
+            return offset <= total && size <= total - offset;
+        }
+
+        public:
+        task_file() noexcept
+        : mapping(nullptr), mapping_size(0), header(nullptr), records(nullptr), heap(nullptr) {}
+
+        ~task_file() {
+            unmap();
+        }
+
+        task_file(const task_file&) = delete;
+        task_file& operator=(const task_file&) = delete;
+
+        task_file(task_file &&other) noexcept
+        : mapping(other.mapping), mapping_size(other.mapping_size), header(other.header), records(other.records),
+          heap(other.heap) {
+            other.mapping = nullptr;
+            other.unmap();
+        }
+
+        task_file& operator=(task_file &&other) noexcept {
+            if (this != &other) {
+                unmap();
+                mapping = other.mapping;
+                mapping_size = other.mapping_size;
+                header = other.header;
+                records = other.records;
+                heap = other.heap;
+                other.mapping = nullptr;
+                other.unmap();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief 映射一个任务文件，格式不正确时抛出异常。
+         */
+        void open(const std::string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw std::runtime_error("Error: Failed to open task file '" + path + "' - " + strerror(errno));
+            }
+            struct stat st{};
+            if (fstat(fd, &st) < 0) {
+                int err = errno;
+                close(fd);
+                throw std::runtime_error("Error: Failed to stat task file '" + path + "' - " + strerror(err));
+            }
+            size_t size = static_cast<size_t>(st.st_size);
+            if (size < sizeof(task_file_header)) {
+                close(fd);
+                throw std::runtime_error("Error: Task file '" + path + "' is truncated.");
+            }
+            void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            int err = errno;
+            close(fd);
+            if (mapped == MAP_FAILED) {
+                throw std::runtime_error("Error: Failed to map task file '" + path + "' - " + strerror(err));
+            }
+            // 查找按任务 ID 随机访问，预读相邻页面没有意义
+            madvise(mapped, size, MADV_RANDOM);
+
+            unmap();
+            mapping = mapped;
+            mapping_size = size;
+            header = static_cast<const task_file_header*>(mapped);
+            if (std::memcmp(header->magic, TASK_FILE_MAGIC, sizeof(TASK_FILE_MAGIC)) != 0 ||
+                header->version != TASK_FILE_VERSION || header->byte_order != TASK_FILE_BYTE_ORDER ||
+                header->header_size != sizeof(task_file_header) || header->record_size != sizeof(task_file_record) ||
+                header->record_count > size / sizeof(task_file_record) ||
+                header->records_offset % alignof(task_file_record) != 0 ||
+                !within(header->records_offset, header->record_count * sizeof(task_file_record), size) ||
+                !within(header->heap_offset, header->heap_size, size)) {
+                unmap();
+                throw std::runtime_error("Error: '" + path + "' is not a valid task file.");
+            }
+            const auto *base = static_cast<const char*>(mapped);
+            records = reinterpret_cast<const task_file_record*>(base + header->records_offset);
+            heap = base + header->heap_offset;
+        }
+
+        bool is_open() const noexcept {
+            return mapping != nullptr;
+        }
+
+        /**
+         * @brief 按任务 ID 查找任务，记录的字符串越界时视为不存在。
+         *
+         * @return bool 任务是否存在
+         */
+        bool find(uint64_t task_id, task_view &task) const noexcept {
+            if (!records || task_id == 0 || task_id >= header->record_count) return false;
+            const task_file_record &record = records[task_id];
+            if (!(record.flags & TASK_RECORD_PRESENT)) return false;
+            // 名称、描述与两个结尾的 '\0' 都要落在字符串堆内
+            uint64_t text_size = uint64_t{record.name_length} + record.description_length + 2;
+            if (!within(record.text_offset, text_size, header->heap_size)) return false;
+
+            const char *name = heap + record.text_offset;
+            task.task_id = task_id;
+            task.name = std::string_view(name, record.name_length);
+            task.description = std::string_view(name + record.name_length + 1, record.description_length);
+            task.difficulty = static_cast<task_difficulty_t>(record.difficulty);
+            task.closed = (record.flags & TASK_RECORD_CLOSED) != 0;
+            return true;
+        }
+
+        bool contains(uint64_t task_id) const noexcept {
+            return records && task_id > 0 && task_id < header->record_count &&
+                   (records[task_id].flags & TASK_RECORD_PRESENT);
+        }
+
+        /**
+         * @brief 按任务 ID 升序访问全部任务，visitor 的参数为 const task_view&。
+         */
+        template<typename Visitor>
+        void for_each(Visitor &&visitor) const {
+            if (!records) return;
+            task_view task{};
+            for (uint64_t id = 1; id < header->record_count; ++id) {
+                if (find(id, task)) visitor(task);
+            }
+        }
+
+        // 文件中最大的任务 ID，新任务从它之后分配
+        uint64_t max_task_id() const noexcept {
+            return records && header->record_count > 0 ? header->record_count - 1 : 0;
+        }
+
+        uint64_t size() const noexcept {
+            return header ? header->task_count : 0;
+        }
+};
+
+/**
+ * @brief 生成任务文件：在内存中收集记录与字符串堆，commit() 时写入临时文件、fsync 后 rename 到目标路径，
+ * 写到一半崩溃不会留下损坏的任务文件，正在使用旧文件的映射也不受影响。
+ * 任务 ID 即记录数组的下标，文件大小与最大任务 ID 成正比，ID 应当连续分配。
+ *
+ */
+class task_file_writer{
+
+        private:
+        std::vector<task_file_record> records;
+        std::string heap;
+        uint64_t task_count;
+
+        static void write_all(int fd, const void *data, size_t size) {
+            const char *ptr = static_cast<const char*>(data);
+            while (size > 0) {
+                ssize_t n = ::write(fd, ptr, size);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(std::string("Error: Failed to write task file - ") + strerror(errno));
+                }
+                ptr += n;
+                size -= static_cast<size_t>(n);
+            }
+        }
+
+        public:
+        task_file_writer() : records(1), task_count(0) {}
+
+        /**
+         * @brief 加入一个任务，名称与描述超出协议字段长度时截断。同一个 ID 加入两次时以后一次为准。
+         */
+        void add(uint64_t task_id, std::string_view name, std::string_view description, task_difficulty_t difficulty,
+                 bool closed = false) {
+            if (task_id == 0) {
+                throw std::invalid_argument("Error: Task ID 0 is reserved.");
+            }
+            if (task_id >= records.size()) records.resize(task_id + 1);
+            name = name.substr(0, MAX_TASK_NAME_LENGTH);
+            description = description.substr(0, MAX_TASK_DESCRIPTION_SIZE - 1);
+
+            task_file_record &record = records[task_id];
+            if (!(record.flags & TASK_RECORD_PRESENT)) ++task_count;
+            record.text_offset = heap.size();
+            record.name_length = static_cast<uint16_t>(name.size());
+            record.description_length = static_cast<uint16_t>(description.size());
+            record.difficulty = static_cast<uint8_t>(difficulty);
+            record.flags = closed ? TASK_RECORD_PRESENT | TASK_RECORD_CLOSED : TASK_RECORD_PRESENT;
+
+            heap.append(name);
+            heap.push_back('\0');
+            heap.append(description);
+            heap.push_back('\0');
+        }
+
+        uint64_t size() const noexcept {
+            return task_count;
+        }
+
+        /**
+         * @brief 把收集的任务写成任务文件，原子地替换 path。
+         */
+        void commit(const std::string &path) const {
+            task_file_header header{};
+            std::memcpy(header.magic, TASK_FILE_MAGIC, sizeof(TASK_FILE_MAGIC));
+            header.version = TASK_FILE_VERSION;
+            header.byte_order = TASK_FILE_BYTE_ORDER;
+            header.header_size = sizeof(task_file_header);
+            header.record_size = sizeof(task_file_record);
+            header.record_count = records.size();
+            header.task_count = task_count;
+            header.records_offset = sizeof(task_file_header);
+            header.heap_offset = header.records_offset + records.size() * sizeof(task_file_record);
+            header.heap_size = heap.size();
+
+            std::string temp_path = path + ".tmp";
+            int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                throw std::runtime_error("Error: Failed to create '" + temp_path + "' - " + strerror(errno));
+            }
+            try {
+                write_all(fd, &header, sizeof(header));
+                write_all(fd, records.data(), records.size() * sizeof(task_file_record));
+                write_all(fd, heap.data(), heap.size());
+                if (fsync(fd) < 0) {
+                    throw std::runtime_error(std::string("Error: Failed to sync task file - ") + strerror(errno));
+                }
+            } catch (...) {
+                close(fd);
+                unlink(temp_path.c_str());
+                throw;
+            }
+            close(fd);
+            if (rename(temp_path.c_str(), path.c_str()) < 0) {
+                int err = errno;
+                unlink(temp_path.c_str());
+                throw std::runtime_error("Error: Failed to replace '" + path + "' - " + strerror(err));
+            }
+        }
+};
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "group_commit_log.h"
+#include "task_file.h"
+
+// 距离上一次写任务文件追加了这么多条任务日志后自动压缩一次，恢复时最多重放这么多条
+constexpr uint64_t TASK_COMPACTION_INTERVAL = 100000;
+// 压缩失败后重试的间隔
+constexpr std::chrono::seconds TASK_COMPACTION_RETRY_INTERVAL{10};
+
+/**
+ * @brief 一次任务修改，也是任务日志中的一条记录。CLOSE 与 DELETE 只使用 task_id，
+ * 重放时 CREATE 按给定的 ID 写入，已经存在时覆盖。
+ */
+struct task_change {
+    titp_task_action_t action = titp_task_action_t::CREATE;
+    uint64_t task_id = 0;
+    task_difficulty_t difficulty = task_difficulty_t::UNKNOWN;
+    std::string name;
+    std::string description;
+};
+
+/**
+ * @brief 任务修改的预写日志。每次修改先追加到成组提交的日志，落盘后才在日志的写线程中应用到内存并确认给客户端，
+ * 应用的顺序就是日志中的顺序，重放时以同样的规则依次应用即可得到相同的结果。
+ * 压缩由后台线程调用 compactor 完成：compactor 切换日志段（rotate），把当前全部任务写成任务文件，
+ * 之后删除旧的日志段（remove_before）。任务文件的状态不早于旧段的末尾，新段开头可能有几条已经包含在文件中的修改，
+ * 每条修改都写入任务的完整字段，再应用一次结果不变。恢复时从任务文件开始，应用目录中剩余的全部日志段。
+ *
+ */
+class task_log{
+
+        public:
+        using compactor_t = std::function<bool()>;
+
+        private:
+        std::string directory;
+        group_commit_log log;
+        uint64_t compaction_interval;
+        compactor_t compactor;
+
+        std::atomic<uint64_t> since_compaction;
+        std::mutex wait_lock;
+        std::condition_variable wake;
+        bool stopping;
+        std::thread compaction_thread;
+
+        /*
+         * 记录内容（主机字节序）：
+         *   action(1) difficulty(1) name_length(2) description_length(2) reserved(2) task_id(8) name description
+         */
+        static constexpr size_t RECORD_FIXED_SIZE = 16;
+
+        static std::string encode(const task_change &change) {
+            std::string_view name = std::string_view(change.name).substr(0, MAX_TASK_NAME_LENGTH);
+            std::string_view description = std::string_view(change.description).substr(0, MAX_TASK_DESCRIPTION_SIZE - 1);
+            uint16_t name_length = static_cast<uint16_t>(name.size());
+            uint16_t description_length = static_cast<uint16_t>(description.size());
+
+            std::string bytes(RECORD_FIXED_SIZE, '\0');
+            bytes[0] = static_cast<char>(change.action);
+            bytes[1] = static_cast<char>(change.difficulty);
+            std::memcpy(bytes.data() + 2, &name_length, sizeof(name_length));
+            std::memcpy(bytes.data() + 4, &description_length, sizeof(description_length));
+            std::memcpy(bytes.data() + 8, &change.task_id, sizeof(change.task_id));
+            bytes.append(name);
+            bytes.append(description);
+            return bytes;
+        }
+
+        static std::optional<task_change> decode(std::string_view bytes) {
+            if (bytes.size() < RECORD_FIXED_SIZE) return std::nullopt;
+            uint16_t name_length, description_length;
+            task_change change;
+            change.action = static_cast<titp_task_action_t>(bytes[0]);
+            change.difficulty = static_cast<task_difficulty_t>(bytes[1]);
+            std::memcpy(&name_length, bytes.data() + 2, sizeof(name_length));
+            std::memcpy(&description_length, bytes.data() + 4, sizeof(description_length));
+            std::memcpy(&change.task_id, bytes.data() + 8, sizeof(change.task_id));
+            if (change.action < titp_task_action_t::CREATE || change.action > titp_task_action_t::DELETE ||
+                bytes.size() != RECORD_FIXED_SIZE + name_length + description_length) {
+                return std::nullopt;
+            }
+            change.name = bytes.substr(RECORD_FIXED_SIZE, name_length);
+            change.description = bytes.substr(RECORD_FIXED_SIZE + name_length, description_length);
+            return change;
+        }
+
+        void compaction_main() {
+            std::unique_lock guard(wait_lock);
+            while (true) {
+                wake.wait(guard, [this]() {
+                    return stopping || since_compaction.load(std::memory_order_relaxed) >= compaction_interval;
+                });
+                if (stopping) return;
+                guard.unlock();
+                bool compacted = compactor && compactor();
+                guard.lock();
+                if (compacted) {
+                    since_compaction.store(0, std::memory_order_relaxed);
+                } else {
+                    wake.wait_for(guard, TASK_COMPACTION_RETRY_INTERVAL, [this]() { return stopping; });
+                }
+            }
+        }
+
+        public:
+        task_log(std::string log_directory, uint64_t interval = TASK_COMPACTION_INTERVAL)
+        : directory(log_directory), log(std::move(log_directory), "tasks"), compaction_interval(interval > 0 ? interval : 1), since_compaction(0),
+          stopping(false) {}
+
+        ~task_log() {
+            stop();
+        }
+
+        task_log(const task_log&) = delete;
+        task_log& operator=(const task_log&) = delete;
+
+        /**
+         * @brief 按顺序把日志中的全部修改交给 apply，然后打开新的日志段并启动压缩线程。
+         * 在任务文件映射之后、Reactor 线程启动之前调用一次。
+         *
+         * @return size_t 重放的记录数
+         */
+        template<typename Apply>
+        size_t recover(Apply &&apply, compactor_t compact) {
+            ensure_directory(directory);
+            size_t replayed = 0;
+            uint64_t next_segment = 0;
+            for (uint64_t sequence : log.list_segments()) {
+                next_segment = sequence + 1;
+                log.replay(sequence, [&](std::string_view bytes) {
+                    std::optional<task_change> change = decode(bytes);
+                    if (!change) return;
+                    apply(*change);
+                    ++replayed;
+                });
+            }
+            since_compaction.store(replayed, std::memory_order_relaxed);
+            compactor = std::move(compact);
+            log.open(next_segment);
+            compaction_thread = std::thread(&task_log::compaction_main, this);
+            return replayed;
+        }
+
+        /**
+         * @brief 追加一次修改，落盘后在日志的写线程中调用 done(true)，写入失败时调用 done(false)。
+         *
+         * @return bool 日志不可用时返回 false，done 不会被调用
+         */
+        bool append(const task_change &change, group_commit_log::completion_t done) {
+            if (!log.append(encode(change), std::move(done))) return false;
+            if (since_compaction.fetch_add(1, std::memory_order_relaxed) + 1 == compaction_interval) {
+                std::lock_guard guard(wait_lock);
+                wake.notify_one();
+            }
+            return true;
+        }
+
+        // 压缩时由 compactor 调用，见 group_commit_log 的同名函数
+        std::optional<uint64_t> rotate() {
+            return log.rotate();
+        }
+
+        void remove_before(uint64_t sequence) {
+            log.remove_before(sequence);
+        }
+
+        /**
+         * @brief 停止压缩线程，写出日志中剩余的记录。完成回调会向事件循环投递确认，必须在事件循环销毁之前调用。
+         */
+        void stop() {
+            {
+                std::lock_guard guard(wait_lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            if (compaction_thread.joinable()) compaction_thread.join();
+            log.stop();
+        }
+
+        bool healthy() const noexcept {
+            return log.healthy();
+        }
+
+        uint64_t records() const noexcept {
+            return log.records();
+        }
+
+        uint64_t batches() const noexcept {
+            return log.batches();
+        }
+};
\ No newline at end of file
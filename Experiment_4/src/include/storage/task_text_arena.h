@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 任务名称与描述的追加式存储区。文本按顺序写进 1 MiB 的大块，块一经分配不再移动也不单独释放，
+ * 任务记录只保存文本的位置与长度，不再为每个任务分配两个 std::string，
+ * 百万量级的任务不会产生百万次小块分配及其分配器开销。
+ * 每段文本写作 name '\0' description '\0'，一段不跨块，视图与任务文件中的字符串一样可以当作 C 字符串使用。
+ * 修改任务只追加新文本，旧文本成为垃圾，由持有者在合适的时机把仍在使用的文本搬到新的存储区（见 used()）。
+ * 本身不加锁，与任务记录由同一把锁保护；追加不会移动已有文本，已经取得的视图在存储区销毁或被替换之前有效。
+ *
+ */
+class task_text_arena{
+
+        private:
+        static constexpr size_t CHUNK_SHIFT = 20;
+        static constexpr size_t CHUNK_SIZE = size_t{1} << CHUNK_SHIFT;
+
+        std::vector<std::unique_ptr<char[]>> chunks;
+        size_t tail;                // 最后一块中已经使用的字节数
+        uint64_t used_bytes;        // 追加过的全部文本，包括已经不再引用的
+
+        public:
+        task_text_arena() noexcept
+        : tail(CHUNK_SIZE), used_bytes(0) {}
+
+        task_text_arena(const task_text_arena&) = delete;
+        task_text_arena& operator=(const task_text_arena&) = delete;
+
+        task_text_arena(task_text_arena &&other) noexcept
+        : chunks(std::move(other.chunks)), tail(std::exchange(other.tail, CHUNK_SIZE)), used_bytes(std::exchange(other.used_bytes, 0)) {}
+
+        task_text_arena& operator=(task_text_arena &&other) noexcept {
+            chunks = std::move(other.chunks);
+            tail = std::exchange(other.tail, CHUNK_SIZE);
+            used_bytes = std::exchange(other.used_bytes, 0);
+            return *this;
+        }
+
+        /**
+         * @brief 追加一个任务的名称与描述。
+         *
+         * @return uint64_t 名称的位置，描述从 offset + name.size() + 1 开始
+         */
+        uint64_t append(std::string_view name, std::string_view description) {
+            size_t length = name.size() + description.size() + 2;
+            if (length > CHUNK_SIZE) {
+                throw std::runtime_error("Error: Task text exceeds the arena chunk size.");
+            }
+            if (CHUNK_SIZE - tail < length) {
+                chunks.emplace_back(new char[CHUNK_SIZE]);
+                tail = 0;
+            }
+            uint64_t offset = (static_cast<uint64_t>(chunks.size() - 1) << CHUNK_SHIFT) | tail;
+            char *bytes = chunks.back().get() + tail;
+            if (!name.empty()) std::memcpy(bytes, name.data(), name.size());
+            bytes[name.size()] = '\0';
+            if (!description.empty()) std::memcpy(bytes + name.size() + 1, description.data(), description.size());
+            bytes[length - 1] = '\0';
+            tail += length;
+            used_bytes += length;
+            return offset;
+        }
+
+        /**
+         * @brief 取得 append() 写入的一段文本，后面紧跟 '\0'。
+         */
+        std::string_view view(uint64_t offset, size_t length) const noexcept {
+            return std::string_view(chunks[offset >> CHUNK_SHIFT].get() + (offset & (CHUNK_SIZE - 1)), length);
+        }
+
+        // 追加过的文本字节数（含结尾的 '\0'），与仍在使用的字节数相比即可判断是否值得重建
+        uint64_t used() const noexcept {
+            return used_bytes;
+        }
+
+        // 已经分配的内存，实际驻留的只有写过的页
+        size_t reserved() const noexcept {
+            return chunks.size() * CHUNK_SIZE;
+        }
+
+        void clear() noexcept {
+            chunks.clear();
+            tail = CHUNK_SIZE;
+            used_bytes = 0;
+        }
+};
\ No newline at end of file
@@ -1,14 +1,38 @@
 #include "include/communication_config.h"
 #include "include/network/tcp_server.h"
+#include "include/network/event_loop.h"
+#include "include/network/frame_decoder.h"
+#include "include/network/uring_transport.h"
+#include "include/network/tcp_connection.h"
+#include "include/network/coroutine.h"
+#include "include/network/response_cache.h"
+#include "include/network/subscription_queue.h"
+#include "include/security/session_table.h"
+#include "include/security/password_hash.h"
+#include "include/security/user_store.h"
+#include "include/security/auth_pool.h"
+#include "include/storage/task_file.h"
+#include "include/storage/flat_task_index.h"
+#include "include/storage/task_text_arena.h"
+#include "include/storage/account_log.h"
+#include "include/storage/task_log.h"
 #include <string>
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <map>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <pthread.h>
+#include <csignal>
 #include "include/protocols/PIAP.h"
 #include "include/protocols/TITP.h"
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -31,133 +55,1439 @@ void println(const std::string &format, Args... args) {
     printf("\n");
 }
 
-// 封装发送控制包函数
-bool send_ctrl_packet(tcp_server &server, int client_fd, std::unique_ptr<piap_t> packet) {
-    return server.send_ctrl_packet(client_fd, packet);
+// 用户数据库为空（首次启动）时写入的初始账户与等级，admin 可以修改任务
+struct initial_user {
+    const char *username;
+    const char *password;
+    uint8_t level;
+};
+
+const initial_user initial_users[] = {
+        {"admin", "admin123", MAX_LEVEL},
+        {"user1", "password1", MIN_LEVEL},
+        {"user2", "password2", MIN_LEVEL}
+};
+
+// 简单的用户数据库模拟，只保存加盐的密码哈希；认证线程无锁读取，注册时按分片写入
+user_store user_database;
+
+// 账户日志与快照的默认目录，可以用 --data-dir 指定
+constexpr const char *DEFAULT_DATA_DIRECTORY = "data";
+
+// 用户数据库的预写日志：注册与改密落盘后才回复客户端，启动时据此恢复用户数据库
+std::unique_ptr<account_log> account_journal;
+
+// 计算密码哈希的认证线程池，Reactor 线程只负责收发
+auth_pool auth_workers;
+
+// 运行期间修改过的任务，名称与描述存放在 task_texts 中；deleted 为墓碑，遮住任务文件中的同 ID 任务
+struct task_record {
+    uint64_t text;                      // 名称在 task_texts 中的位置，描述紧跟在名称的 '\0' 之后
+    uint16_t name_length;
+    uint16_t description_length;
+    task_difficulty_t difficulty;
+    bool closed;
+    bool deleted;
+};
+
+// 以 --tasks 指定的任务文件（默认为数据目录中的 tasks.snapshot），只读映射，查找直接读取页缓存；文件不存在时为空。
+// 路径在启动时确定，压缩总是写回这个文件，重启时也从它开始重放任务日志
+task_file task_store;
+std::string task_store_path;
+
+// 没有 --tasks 时，任务日志压缩写出的任务文件，位于数据目录中
+constexpr const char *TASK_SNAPSHOT_FILE = "tasks.snapshot";
+
+// 没有任务文件时启动的示例任务
+struct sample_task {
+    uint64_t task_id;
+    const char *name;
+    const char *description;
+    task_difficulty_t difficulty;
+};
+
+const sample_task sample_tasks[] = {
+        {1, "收集资源", "前往森林收集10个木材和5个石头", task_difficulty_t::MEDIUM},
+        {2, "击败怪物", "前往东边的山洞击败5只哥布林", task_difficulty_t::MEDIUM},
+        {3, "护送任务", "护送商人安全抵达下一个城镇", task_difficulty_t::MEDIUM}
+};
+
+// 运行期间新增、修改或删除的任务，覆盖任务文件中的同 ID 任务，一次探测即可得到结果；
+// 压缩后与新文件一致的记录被移除
+flat_task_index<task_record> task_database;
+
+// task_database 中任务的名称与描述，只追加；压缩后垃圾多于仍在使用的文本时整体重建
+task_text_arena task_texts;
+
+// 预先编码的响应：task_database 中的任务与 not found 响应，任务文件中的任务在请求时直接从映射编码
+response_cache task_responses;
+
+// 保护任务文件、task_database、task_texts 与 task_responses：Reactor 线程查找时持有读锁，
+// 任务日志的写线程应用修改、压缩替换任务文件时持有写锁
+std::shared_mutex task_lock;
+
+// 任务修改的预写日志：修改落盘后才应用并确认，启动时在任务文件之上重放
+std::unique_ptr<task_log> task_journal;
+
+// 最近分配的任务 ID，新建任务在任意线程中原子地取下一个
+std::atomic<uint64_t> last_task_id{0};
+
+// 串行化自动压缩与控制台的 task save
+std::mutex compaction_lock;
+
+// 可以通过 TITP 修改任务的最低用户等级
+constexpr uint8_t TASK_EDITOR_LEVEL = MAX_LEVEL;
+
+// 单个连接上等待落盘的任务修改上限，达到时会话停止读取新请求，确认回落到一半后继续，磁盘变慢时内存不会无限增长
+constexpr uint32_t MAX_PENDING_TASK_CHANGES = 4096;
+
+// 登录成功后下发的会话令牌，客户端断线重连时凭令牌恢复会话；到期由 0 号 Reactor 的定时器驱动
+session_table login_sessions{coarse_clock().now_ms()};
+
+// 会话令牌表检查过期的间隔
+constexpr uint64_t SESSION_EXPIRY_INTERVAL_MS = 1000;
+
+// 连接在服务器中所处的阶段
+enum class session_state_t {
+    AUTHENTICATING,     // 已建立 TCP 连接，等待 PIAP 登录请求
+    ESTABLISHED         // 认证通过，允许收发 TITP 数据包
+};
+
+// 会话的任务事件订阅，只在所属 Reactor 线程中访问
+struct task_subscription {
+    bool active = false;
+    task_difficulty_t min_difficulty = task_difficulty_t::UNKNOWN;
+    task_difficulty_t max_difficulty = task_difficulty_t::EXTREMELY_HARD;
+    subscription_queue events;              // 连接写不动时暂存的事件，同一任务的事件在这里合并
+
+    bool matches(task_difficulty_t difficulty) const noexcept {
+        return active && difficulty >= min_difficulty && difficulty <= max_difficulty;
+    }
+};
+
+// 凭据字段的定长副本：PIAP 各版本的用户名与密码都不超过 255 字节，复制进协程帧或会话不需要分配内存
+struct credential_field {
+    char data[UINT8_MAX + 1];       // 以 '\0' 结尾，可以直接打印
+    uint8_t length = 0;
+
+    void assign(std::string_view value) noexcept {
+        length = static_cast<uint8_t>(std::min(value.size(), size_t{UINT8_MAX}));
+        std::memcpy(data, value.data(), length);
+        data[length] = '\0';
+    }
+
+    std::string_view view() const noexcept {
+        return std::string_view(data, length);
+    }
+
+    const char *c_str() const noexcept {
+        return length > 0 ? data : "";
+    }
+};
+
+// 每个客户端连接的上下文，由事件循环按 fd 索引
+struct client_session {
+    session_state_t state;
+    uint16_t piap_version;                  // 登录时使用的 PIAP 版本，服务器主动下发的 PIAP 报文（强制下线）按它编码
+    uint16_t titp_version;                  // 会话协商的 TITP 版本，即最近一个 TITP 请求的版本；推送的 TITP 报文按它编码
+    tcp_connection conn;
+    std::coroutine_handle<> coroutine;      // 处理该连接的顶层协程，连接关闭前一直挂起在 conn 上
+    credential_field user;
+    session_token token;                    // 本次登录的会话令牌，登出或被强制下线时作废
+    task_subscription subscription;
+    uint64_t serial;                        // Reactor 内唯一的连接序号，fd 被新连接复用后据此认出旧连接的回调
+    uint32_t pending_task_changes;          // 已经提交、尚未确认的任务修改
+    std::coroutine_handle<> change_waiter;  // 因在途修改达到上限而挂起的会话协程
+
+    client_session(int client_fd, uring_transport *uring, timer_wheel *timers, uint64_t session_serial)
+        : state(session_state_t::AUTHENTICATING), piap_version(PIAP_VERSION_V1), titp_version(TITP_VERSION_V1),
+          conn(client_fd, uring, timers),
+          serial(session_serial), pending_task_changes(0) {}
+};
+
+// 连接收发所使用的内核接口
+enum class io_backend_t {
+    EPOLL,          // 边缘触发 epoll + 非阻塞 readv/send
+    IO_URING        // multishot accept/recv + provided buffer ring + 链接发送
+};
+
+/**
+ * @brief 一个 Reactor 线程的全部状态：独占的监听套接字、事件循环与会话表。
+ * 多个 Reactor 通过 SO_REUSEPORT 监听同一端口，由内核分配新连接，彼此之间不共享任何连接状态。
+ */
+struct reactor {
+    int id;
+    tcp_server server;
+    event_loop loop;
+    std::unique_ptr<uring_transport> uring;     // 仅 io_uring 后端使用，完成队列通过 loop 等待
+    std::unordered_map<int, client_session> sessions;
+    std::coroutine_handle<> acceptor;           // epoll 后端的 accept 协程
+    timer_node session_expiry;                  // 仅 0 号 Reactor 使用，定期淘汰过期的会话令牌
+    std::vector<std::unique_ptr<reactor>> *peers; // 全部 Reactor（包括自己），会话发起的任务修改据此通知所有订阅者
+
+    // 由控制台线程读取，因此使用原子计数而不是 sessions.size()
+    std::atomic<size_t> active_connections;
+    std::atomic<uint64_t> accepted_connections;
+
+    std::thread worker;
+
+    reactor(int reactor_id, bool reuse_port, io_backend_t backend)
+        : id(reactor_id), server(PORT, reuse_port),
+          uring(backend == io_backend_t::IO_URING ? std::make_unique<uring_transport>() : nullptr),
+          peers(nullptr), active_connections(0), accepted_connections(0) {}
+};
+
+// 账户修改的结果回调，在日志的写线程（或认证线程）中调用
+using auth_reply_t = std::function<void(piap_auth_type_t)>;
+
+/**
+ * @brief 首次启动时为初始账户计算密码哈希并写入日志，在认证线程启动之前调用。
+ */
+void build_user_database() {
+    if (user_database.size() > 0) return;
+    for (const auto &[username, password, level] : initial_users) {
+        user_database.insert(user_record{username, password_hash::create(password), username, level},
+                             [](const user_record &added) {
+                                 account_journal->append(account_change_t::SIGNUP, added, nullptr);
+                             });
+    }
+}
+
+/**
+ * @brief 校验用户名与密码，在认证线程中调用。一次查找取得哈希记录的副本，PBKDF2 在锁外计算，不分配内存。
+ */
+piap_auth_type_t check_credentials(std::string_view username, std::string_view password) {
+    std::optional<password_hash> stored = user_database.find_password(username);
+    if (!stored) return piap_auth_type_t::USER_NOT_FOUND;
+    return stored->verify(password) ? piap_auth_type_t::LOGIN_SUCCESS : piap_auth_type_t::WRONG_PASSWORD;
 }
 
-// 封装发送数据包函数
-bool send_data_packet(tcp_server &server, int client_fd, std::unique_ptr<titp_t> packet) {
-    return server.send_data_packet(client_fd, packet);
+/**
+ * @brief 注册新用户，在认证线程中调用。先检查用户名避免白算哈希，写入时再检查一次，并发注册同名账户只有一个成功。
+ * 新账户写入用户数据库后追加到日志，记录所在的一批落盘后才以 SIGNUP_SUCCESS 调用 reply；
+ * 落盘失败时撤销注册并回复 SERVER_ERR_RESPONSE。认证线程不等待磁盘，立即返回处理下一个请求。
+ */
+void register_user(std::string_view username, std::string_view password, auth_reply_t reply) {
+    if (user_database.contains(username)) {
+        reply(piap_auth_type_t::USER_ALREADY_EXISTS);
+        return;
+    }
+    password_hash hash = password_hash::create(password);
+    // 注册请求只携带用户名与密码，角色名默认与用户名相同
+    user_record record{std::string(username), hash, std::string(username), MIN_LEVEL};
+    bool logged = false;
+    bool inserted = user_database.insert(std::move(record), [&](const user_record &added) {
+        logged = account_journal->append(account_change_t::SIGNUP, added, [reply, name = added.usr_ID](bool durable) {
+            if (!durable) user_database.erase(name);
+            reply(durable ? piap_auth_type_t::SIGNUP_SUCCESS : piap_auth_type_t::SERVER_ERR_RESPONSE);
+        });
+    });
+    if (!inserted) {
+        reply(piap_auth_type_t::USER_ALREADY_EXISTS);
+    } else if (!logged) {
+        user_database.erase(username);
+        reply(piap_auth_type_t::SERVER_ERR_RESPONSE);
+    }
 }
 
-// 简单的用户数据库模拟
-std::unordered_map<std::string, std::string> user_database = {
-        {"admin", "admin123"},
-        {"user1", "password1"},
-        {"user2", "password2"}
+/**
+ * @brief 修改密码，在认证线程中调用，语义与 account::chg_password 相同：当前密码正确才替换为新密码。
+ * 与注册一样先写日志，落盘后作废该用户的全部会话令牌，再以 PASSWORD_CHANGED 调用 reply；落盘失败时恢复原来的密码。
+ */
+void change_password(std::string_view username, std::string_view old_password, std::string_view new_password,
+                     auth_reply_t reply) {
+    std::optional<password_hash> stored = user_database.find_password(username);
+    if (!stored) {
+        reply(piap_auth_type_t::USER_NOT_FOUND);
+        return;
+    }
+    if (!stored->verify(old_password)) {
+        reply(piap_auth_type_t::WRONG_PASSWORD);
+        return;
+    }
+    password_hash hash = password_hash::create(new_password);
+    password_hash previous = *stored;
+    bool logged = false;
+    // 校验期间密码可能已经被另一个请求改掉，只在密码仍是校验过的那一个时替换
+    bool changed = user_database.modify(username, [&](user_record &record) {
+        if (record.password.digest != previous.digest || record.password.salt != previous.salt) return false;
+        record.password = hash;
+        return true;
+    }, [&](const user_record &modified) {
+        logged = account_journal->append(account_change_t::PASSWORD_CHANGED, modified,
+                                         [reply, previous, hash, name = modified.usr_ID](bool durable) {
+            if (!durable) {
+                user_database.modify(name, [&](user_record &record) {
+                    if (record.password.digest != hash.digest) return false;
+                    record.password = previous;
+                    return true;
+                });
+            } else {
+                // 旧密码换来的令牌全部作废，之后只能凭新密码登录
+                login_sessions.revoke_user(name);
+            }
+            reply(durable ? piap_auth_type_t::PASSWORD_CHANGED : piap_auth_type_t::SERVER_ERR_RESPONSE);
+        });
+    });
+    if (!changed) {
+        reply(piap_auth_type_t::WRONG_PASSWORD);
+    } else if (!logged) {
+        user_database.modify(username, [&](user_record &record) {
+            record.password = previous;
+            return true;
+        });
+        reply(piap_auth_type_t::SERVER_ERR_RESPONSE);
+    }
+}
+
+// 交给认证线程池的请求
+enum class auth_operation_t {
+    LOGIN,
+    SIGNUP,
+    CHANGE_PASSWORD
 };
 
-// 任务数据库
-std::unordered_map<uint64_t, std::pair<std::string, std::string>> task_database = {
-        {1, {"收集资源", "前往森林收集10个木材和5个石头"}},
-        {2, {"击败怪物", "前往东边的山洞击败5只哥布林"}},
-        {3, {"护送任务", "护送商人安全抵达下一个城镇"}}
+/**
+ * @brief 把注册、登录或改密的凭据校验交给认证线程池，结果投递回发起请求的 Reactor 后恢复协程。
+ * 队列已满时不挂起，直接得到 SERVER_UNAVAILABLE。注册与改密的结果在日志落盘后才由日志的写线程投递。
+ * 协程挂起期间 awaitable 保存在协程帧中，工作线程可以直接引用它；服务器关闭时先停止线程池与日志再销毁事件循环。
+ * 回调都只捕获 this，能放进 std::function 的内部存储，登录的任务与结果都不需要分配内存。
+ */
+struct auth_awaitable {
+    event_loop &loop;
+    auth_operation_t operation;
+    credential_field username;
+    credential_field password;
+    credential_field new_password;
+    piap_auth_type_t result = piap_auth_type_t::SERVER_UNAVAILABLE;
+    std::atomic<bool> completed{false};
+    std::coroutine_handle<> waiting;
+
+    auth_awaitable(event_loop &reactor_loop, auth_operation_t op) noexcept
+        : loop(reactor_loop), operation(op) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    // 协程在结果投递回去之前不会恢复，这里写入 result 不会与它竞争；只有第一次调用生效，协程只恢复一次
+    void complete(piap_auth_type_t status) {
+        if (completed.exchange(true, std::memory_order_acq_rel)) return;
+        result = status;
+        loop.post([this]() {
+            waiting.resume();
+        });
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        waiting = h;
+        return auth_workers.submit([this]() {
+            auto reply = [this](piap_auth_type_t status) {
+                complete(status);
+            };
+            // 工作线程中没有别的地方接住异常（如生成盐值失败），逃出任务会终止整个进程
+            try {
+                switch (operation) {
+                    case auth_operation_t::LOGIN:
+                        complete(check_credentials(username.view(), password.view()));
+                        break;
+                    case auth_operation_t::SIGNUP:
+                        register_user(username.view(), password.view(), reply);
+                        break;
+                    case auth_operation_t::CHANGE_PASSWORD:
+                        change_password(username.view(), password.view(), new_password.view(), reply);
+                        break;
+                }
+            } catch (const std::exception &e) {
+                println("Exception during authentication job: %s", e.what());
+                complete(piap_auth_type_t::SERVER_ERR_RESPONSE);
+            }
+        });
+    }
+
+    piap_auth_type_t await_resume() const noexcept {
+        return result;
+    }
 };
 
-// 处理客户端认证请求
-bool handle_authentication(tcp_server &server, int client_fd) {
+bool auth_succeeded(piap_auth_type_t status) noexcept {
+    return status == piap_auth_type_t::LOGIN_SUCCESS || status == piap_auth_type_t::SIGNUP_SUCCESS;
+}
+
+/**
+ * @brief 处理客户端认证请求：等待注册、登录或恢复会话的报文并回复认证结果。
+ * 注册与登录的密码哈希交给认证线程池，协程挂起期间 Reactor 线程继续服务其他连接；
+ * 注册成功即视为登录。成功时签发会话令牌；恢复请求只校验令牌，不再计算哈希。
+ * 成功后会话的版本、用户与令牌写入 session。
+ */
+task<bool> handle_authentication(reactor &r, client_session &session) {
+    tcp_server &server = r.server;
+    tcp_connection &conn = session.conn;
     try {
-        auto request = server.recv_ctrl_packet(client_fd);
-        if (!request) {
+        // 报文视图直接引用接收缓冲区，只在下一次 co_await 之前有效
+        auto frame = co_await server.async_recv_frame(conn);
+        if (!frame || frame->kind != frame_kind_t::PIAP) {
             println("Error: Failed to receive authentication packet.");
-            return false;
+            co_return false;
         }
+        piap_view_t request(frame->data, frame->size);
+        if (!request.valid()) {
+            println("Error: Failed to receive authentication packet.");
+            co_return false;
+        }
+        uint16_t version = request.get_version();
+        session.piap_version = version;
+        // 发出第一个 TITP 请求之前，按登录的版本推定：v1 客户端的两种协议都只认识定长布局
+        session.titp_version = version == PIAP_VERSION_V1 ? TITP_VERSION_V1 : TITP_VERSION_V2;
+        piap_msg_type_t request_type = request.get_msg_type();
+        bool resuming = request_type == piap_msg_type_t::RESUME_REQUEST;
+        bool signing_up = request_type == piap_msg_type_t::SIGNUP_REQUEST;
+        piap_msg_type_t response_type = resuming ? piap_msg_type_t::RESUME_RESPONSE :
+                                        signing_up ? piap_msg_type_t::SIGNUP_RESPONSE : piap_msg_type_t::LOGIN_RESPONSE;
 
-        auto format_status = request->valid_format();
+        // 响应直接编码进发送缓冲区，用户名与令牌都是定长字段，认证路径上不分配内存
+        auto format_status = request.valid_format(r.loop.unix_time());
         if (format_status != piap_format_type_t::FORMAT_OK) {
-            auto response = std::make_unique<piap_t>(piap_msg_type_t::LOGIN_RESPONSE);
-            response->set_format_status(format_status);
-            send_ctrl_packet(server, client_fd, std::move(response));
+            piap_response_t response(version, response_type);
+            response.set_format_status(format_status);
+            co_await server.async_send_ctrl_packet(conn, response);
             println("Authentication format error: %d", static_cast<int>(format_status));
-            return false;
+            co_return false;
         }
 
-        const char *username = request->get_userID();
-        const char *password = request->get_password();
+        credential_field username;
         piap_auth_type_t auth_status;
-
-        // 检查用户是否存在并验证密码
-        if (user_database.find(username) != user_database.end()) {
-            if (user_database[username] == password) {
-                auth_status = piap_auth_type_t::LOGIN_SUCCESS;
-            } else {
-                auth_status = piap_auth_type_t::WRONG_PASSWORD;
+        if (resuming) {
+            // 令牌已经证明了身份，恢复会话只需要一次查表
+            std::string_view presented = request.get_session();
+            bool resumed = login_sessions.resume(presented, r.loop.now_ms(), [&](std::string_view user) {
+                username.assign(user);
+            });
+            auth_status = resumed ? piap_auth_type_t::LOGIN_SUCCESS : piap_auth_type_t::SESSION_EXPIRED;
+            if (resumed) session.token.assign(presented);
+        } else if (signing_up || request_type == piap_msg_type_t::LOGIN_REQUEST) {
+            // 请求视图在挂起后失效，凭据先复制进 awaitable；awaitable 放在具名变量中，保证它在协程帧里原地构造
+            auth_awaitable verification(r.loop, signing_up ? auth_operation_t::SIGNUP : auth_operation_t::LOGIN);
+            verification.username.assign(request.get_userID());
+            verification.password.assign(request.get_password());
+            auth_status = co_await verification;
+            username = verification.username;
+            // 等待期间连接可能已经超时或被强制下线
+            if (conn.close_requested) co_return false;
+            if (auth_succeeded(auth_status) && !login_sessions.issue(username.view(), r.loop.now_ms(), session.token)) {
+                println("Warning: Session table is full, %s cannot resume this session.", username.c_str());
             }
         } else {
-            auth_status = piap_auth_type_t::USER_NOT_FOUND;
+            auth_status = piap_auth_type_t::BAD_REQUEST;
         }
 
         // 发送认证响应
-        auto response = std::make_unique<piap_t>(piap_msg_type_t::LOGIN_RESPONSE);
-        response->set_auth_status(auth_status);
-        send_ctrl_packet(server, client_fd, std::move(response));
+        // 按请求的版本回复，v2 客户端只收到状态码与令牌
+        piap_response_t response(version, response_type);
+        response.set_auth_status(auth_status);
+        if (auth_succeeded(auth_status)) response.session = session.token.view();
+        if (!co_await server.async_send_ctrl_packet(conn, response)) {
+            println("Error: Failed to send authentication response to client %d", conn.fd);
+            co_return false;
+        }
 
-        if (auth_status == piap_auth_type_t::LOGIN_SUCCESS) {
-            println("User %s logged in successfully.", username);
-            return true;
+        if (auth_succeeded(auth_status)) {
+            session.user = username;
+            println("User %s %s successfully.", session.user.c_str(),
+                    resuming ? "resumed the session" : signing_up ? "signed up" : "logged in");
+            co_return true;
         } else {
-            println("Authentication failed for user %s", username);
-            return false;
+            session.token.clear();
+            println("Authentication failed for %s", resuming ? "session resume" : username.c_str());
+            co_return false;
         }
 
     } catch (const std::exception &e) {
         println("Exception during authentication: %s", e.what());
-        return false;
+        co_return false;
+    }
+}
+
+// 运行期间任务的视图，名称与描述直接指向 task_texts（调用者持有 task_lock）
+task_view record_view(uint64_t task_id, const task_record &record) {
+    return task_view{task_id, task_texts.view(record.text, record.name_length),
+                     task_texts.view(record.text + record.name_length + 1, record.description_length),
+                     record.difficulty, record.closed};
+}
+
+// 把名称与描述追加到 task_texts，得到一条运行期间的任务记录，调用者持有 task_lock 的写锁
+task_record store_task_record(std::string_view name, std::string_view description, task_difficulty_t difficulty, bool closed) {
+    name = name.substr(0, MAX_TASK_NAME_LENGTH);
+    description = description.substr(0, MAX_TASK_DESCRIPTION_SIZE - 1);
+    return task_record{task_texts.append(name, description), static_cast<uint16_t>(name.size()),
+                       static_cast<uint16_t>(description.size()), difficulty, closed, false};
+}
+
+/**
+ * @brief 按任务 ID 查找任务，运行期间的修改优先于任务文件。调用者持有 task_lock（或者 Reactor 线程尚未启动）。
+ *
+ * @return bool 任务是否存在
+ */
+bool find_task(uint64_t task_id, task_view &task) {
+    if (const task_record *record = task_database.find(task_id)) {
+        if (record->deleted) return false;
+        task = record_view(task_id, *record);
+        return true;
+    }
+    return task_store.find(task_id, task);
+}
+
+// 按任务 ID 升序访问任务文件中没有被覆盖的任务，再访问运行期间新增或修改的任务（调用者持有 task_lock）
+template<typename Visitor>
+void for_each_task(Visitor &&visitor) {
+    task_store.for_each([&](const task_view &task) {
+        if (!task_database.contains(task.task_id)) visitor(task);
+    });
+    task_database.for_each([&](uint64_t task_id, const task_record &record) {
+        if (!record.deleted) visitor(record_view(task_id, record));
+    });
+}
+
+/**
+ * @brief 由任务视图构造 RESOURCE_SENT 响应，名称与描述引用任务文件的映射或 task_texts，编码时才拷贝一次，
+ * 调用者持有 task_lock 直到编码完成。task 为空时为 not found 响应。
+ */
+titp_task_response_t make_task_response(const task_view *task, uint16_t version, uint32_t request_id = 0) {
+    titp_task_response_t response;
+    response.version = version;
+    response.request_id = request_id;
+    if (!task) {
+        response.resource_status = titp_resource_status_type_t::RESOURCE_NOT_FOUND;
+        return response;
+    }
+    response.task_id = task->task_id;
+    response.name = task->name;
+    response.description = task->description;
+    response.difficulty = task->difficulty;
+    response.closed = task->closed;
+    return response;
+}
+
+// 重新编码一个任务的两种响应，调用者持有写锁（或者 Reactor 线程尚未启动）。
+// 任务文件中的任务被删除时同样缓存一份 not found 响应，遮住文件中的记录
+void cache_task_response(uint64_t task_id) {
+    task_view task{};
+    bool exists = find_task(task_id, task);
+    for (uint16_t version : {TITP_VERSION_V1, TITP_VERSION_V2}) {
+        task_responses.store(task_id, version, make_task_response(exists ? &task : nullptr, version));
+    }
+}
+
+/**
+ * @brief 为运行期间的任务预先编码 v1 与 v2 两种 RESOURCE_SENT 响应，以及任务不存在时的响应。
+ * 任务文件中的任务不预先编码，启动时间与任务文件的大小无关。
+ */
+void build_response_cache() {
+    task_database.for_each([](uint64_t task_id, const task_record &record) {
+        if (!record.deleted) cache_task_response(task_id);
+    });
+    for (uint16_t version : {TITP_VERSION_V1, TITP_VERSION_V2}) {
+        task_responses.store_not_found(version, make_task_response(nullptr, version));
+    }
+}
+
+/**
+ * @brief 把一个任务的响应追加到发送缓冲区，调用者持有 task_lock 的读锁。
+ * 缓存中有的（运行期间修改或删除过的任务）引用共享报文，只探测一次；任务文件中的任务从映射的内存直接编码进发送缓冲区，
+ * 都没有时引用缓存的 not found 响应。
+ */
+void enqueue_task_response(send_buffer &out, uint64_t task_id, uint16_t version, uint32_t request_id) {
+    if (const shared_frame *cached = task_responses.lookup(task_id, version)) {
+        response_cache::enqueue(out, *cached, request_id);
+        return;
+    }
+    task_view task{};
+    if (task_store.find(task_id, task)) {
+        out.encode(make_task_response(&task, version, request_id));
+        return;
+    }
+    response_cache::enqueue(out, task_responses.not_found_response(version), request_id);
+}
+
+// 批量响应的结束报文，count 为之前发送的 RESOURCE_SENT 数量
+void encode_batch_end(send_buffer &out, uint16_t version, uint32_t request_id, uint32_t count) {
+    titp_t end(titp_msg_type_t::BATCH_END);
+    end.set_request_id(request_id);
+    end.set_version(version);
+    end.set_batch_end_count(count);
+    out.encode(end);
+}
+
+/**
+ * @brief 构造携带任务 ID 列表的批量请求的全部响应：每个 ID 一个 RESOURCE_SENT，最后一个 BATCH_END。
+ * 列表最多 MAX_BATCH_TASKS 个 ID，一次持有读锁编码完即可；列表为空的请求由 encode_board_chunk 分段处理。
+ */
+void encode_batch_response(const titp_view_t &request, send_buffer &out) {
+    uint32_t request_id = request.get_request_id();
+    uint16_t version = request.get_version();
+    uint32_t count = request.get_batch_count();
+    {
+        std::shared_lock lock(task_lock);
+        for (uint32_t i = 0; i < count; ++i) {
+            enqueue_task_response(out, request.get_batch_task_id(i), version, request_id);
+        }
+    }
+    encode_batch_end(out, version, request_id, count);
+}
+
+// 分段返回整个任务板时，每段最多检查的任务 ID 数，限制一次持有读锁的时间
+constexpr uint64_t BOARD_CHUNK_IDS = 4096;
+
+// 返回整个任务板的批量请求的进度，协程在各段之间挂起时保存在协程帧中
+struct board_cursor {
+    uint16_t version;
+    uint32_t request_id;
+    uint64_t next_task_id = 1;
+    uint32_t sent = 0;
+};
+
+/**
+ * @brief 按任务 ID 升序编码整个任务板的下一段：每段最多检查 BOARD_CHUNK_IDS 个 ID，
+ * 发送积压超过高水位时提前结束，调用者等积压回落后再编码下一段；判断与 async_drain() 一致，
+ * 否则积压恰好等于高水位时（io_uring 后端提交后积压不会立即减少）两边都不推进。读锁只在段内持有，
+ * 任务修改与压缩可以在段之间进行，因此结果不是某一时刻的快照：已经发送过的 ID 不会重复，
+ * 之后才修改的任务按编码时的状态返回。任务文件的记录以 ID 为下标、运行期间的 ID 不超过 last_task_id，
+ * 逐个 ID 查找即可覆盖全部任务，不需要遍历哈希表。
+ *
+ * @return bool 全部任务与 BATCH_END 是否都已编码
+ */
+bool encode_board_chunk(board_cursor &cursor, tcp_connection &conn) {
+    {
+        std::shared_lock lock(task_lock);
+        uint64_t last = std::max(task_store.max_task_id(), last_task_id.load(std::memory_order_relaxed));
+        uint64_t chunk_end = cursor.next_task_id + BOARD_CHUNK_IDS;
+        task_view task{};
+        while (cursor.next_task_id <= last && cursor.next_task_id < chunk_end &&
+               conn.pending_output() <= SEND_HIGH_WATERMARK) {
+            uint64_t task_id = cursor.next_task_id++;
+            if (!find_task(task_id, task)) continue;
+            enqueue_task_response(conn.send_buf, task_id, cursor.version, cursor.request_id);
+            ++cursor.sent;
+        }
+        if (cursor.next_task_id <= last) return false;
     }
+    encode_batch_end(conn.send_buf, cursor.version, cursor.request_id, cursor.sent);
+    return true;
 }
 
-// 认证后处理客户端会话
-void handle_client_session(tcp_server &server, int client_fd);
+// 广播报文所属的协议，两种协议的版本各自演进，会话按对应协议的版本取用
+enum class frame_protocol_t {
+    PIAP,
+    TITP
+};
+
+// 同一条广播按协议版本各编码一次
+struct broadcast_frames {
+    frame_protocol_t protocol;
+    shared_frame v1;
+    shared_frame v2;
+};
+
+broadcast_frames encode_broadcast(titp_t &packet) {
+    broadcast_frames frames{frame_protocol_t::TITP, {}, {}};
+    packet.set_version(TITP_VERSION_V1);
+    frames.v1 = encode_shared(packet);
+    packet.set_version(TITP_VERSION_V2);
+    frames.v2 = encode_shared(packet);
+    return frames;
+}
+
+broadcast_frames encode_broadcast(piap_t &packet) {
+    broadcast_frames frames{frame_protocol_t::PIAP, {}, {}};
+    packet.set_version(PIAP_VERSION_V1);
+    frames.v1 = encode_shared(packet);
+    packet.set_version(PIAP_VERSION_V2);
+    frames.v2 = encode_shared(packet);
+    return frames;
+}
+
+// TITP 报文按会话协商的 TITP 版本取用，PIAP 报文按登录时的 PIAP 版本取用
+const shared_frame &frame_for(const client_session &session, const broadcast_frames &frames) noexcept {
+    if (frames.protocol == frame_protocol_t::PIAP) {
+        return session.piap_version == PIAP_VERSION_V1 ? frames.v1 : frames.v2;
+    }
+    return session.titp_version == TITP_VERSION_V1 ? frames.v1 : frames.v2;
+}
+
+// 订阅队列溢出后代替被丢弃事件的通知，所有会话共用
+const broadcast_frames &events_lost_notice() {
+    static const broadcast_frames frames = [] {
+        titp_t notice(titp_msg_type_t::NOTICE);
+        notice.set_notice(titp_notice_kind_t::EVENTS_LOST, 0, "");
+        return encode_broadcast(notice);
+    }();
+    return frames;
+}
+
+/**
+ * @brief 把订阅队列中的事件移入发送缓冲区，直到积压达到低水位或队列为空。
+ * 连接写不动时事件留在队列中继续合并，连接可写后由 on_writable 再次调用。
+ */
+void deliver_task_events(client_session &session) {
+    tcp_connection &conn = session.conn;
+    subscription_queue &events = session.subscription.events;
+    while (!conn.write_failed) {
+        if (conn.pending_output() >= SEND_LOW_WATERMARK) {
+            conn.flush();
+            if (conn.pending_output() >= SEND_LOW_WATERMARK) break;
+        }
+
+        if (events.take_overflow()) {
+            conn.send_buf.append_shared(frame_for(session, events_lost_notice()));
+            continue;
+        }
+        if (!events.pop(conn.send_buf)) break;
+    }
+    conn.flush();
+}
+
+/**
+ * @brief 任务发生变更后通知订阅了相应难度的会话。事件在调用线程中按版本各编码一次，
+ * 各 Reactor 线程只把共享报文加入订阅者各自的队列。
+ *
+ * @param previous 修改前的难度，任务移出订阅区间时原区间的订阅者同样会收到事件
+ */
+void publish_task_event(std::vector<std::unique_ptr<reactor>> &reactors, titp_notice_kind_t kind, uint64_t task_id,
+                        task_difficulty_t difficulty, task_difficulty_t previous, const std::string &name) {
+    titp_t notice(titp_msg_type_t::NOTICE);
+    notice.set_notice(kind, task_id, name);
+    broadcast_frames frames = encode_broadcast(notice);
+
+    for (auto &target : reactors) {
+        reactor &r = *target;
+        r.loop.post([&r, frames, kind, task_id, difficulty, previous]() {
+            for (auto &[fd, session] : r.sessions) {
+                task_subscription &subscription = session.subscription;
+                if (!subscription.matches(difficulty) && !subscription.matches(previous)) continue;
+
+                if (!subscription.events.push(task_id, kind, frame_for(session, frames))) {
+                    println("Warning: Subscription queue of client %d overflowed, events dropped.", fd);
+                }
+                deliver_task_events(session);
+            }
+        });
+    }
+}
+
+// 一次任务修改应用后要发布的事件
+struct task_event {
+    titp_notice_kind_t kind = titp_notice_kind_t::TASK_POSTED;
+    task_difficulty_t difficulty = task_difficulty_t::UNKNOWN;
+    task_difficulty_t previous = task_difficulty_t::UNKNOWN;
+    std::string name;
+};
+
+/**
+ * @brief 把一次已经落盘的修改应用到内存并更新响应缓存，调用者持有 task_lock 的写锁（或者 Reactor 线程尚未启动）。
+ * 运行时与启动重放走同一个函数，按日志顺序应用得到的结果相同：CREATE 按给定的 ID 写入（覆盖同 ID 任务），
+ * UPDATE 与 CLOSE 只作用于存在的任务，DELETE 留下墓碑，遮住任务文件中可能存在的同 ID 任务。
+ *
+ * @return titp_resource_status_type_t 任务不存在时为 RESOURCE_NOT_FOUND，此时内存不变
+ */
+titp_resource_status_type_t apply_task_change(const task_change &change, task_event &event) {
+    uint64_t task_id = change.task_id;
+    task_view existing{};
+    bool exists = find_task(task_id, existing);
+    if (!exists && change.action != titp_task_action_t::CREATE) {
+        return titp_resource_status_type_t::RESOURCE_NOT_FOUND;
+    }
+
+    switch (change.action) {
+        case titp_task_action_t::CREATE:
+        case titp_task_action_t::UPDATE: {
+            bool creating = change.action == titp_task_action_t::CREATE;
+            task_record record = store_task_record(change.name, change.description, change.difficulty,
+                                                   !creating && existing.closed);
+            event.kind = creating ? titp_notice_kind_t::TASK_POSTED : titp_notice_kind_t::TASK_UPDATED;
+            event.difficulty = record.difficulty;
+            event.previous = exists ? existing.difficulty : record.difficulty;
+            event.name = std::string(change.name, 0, record.name_length);
+            task_database.assign(task_id, record);
+            break;
+        }
+        case titp_task_action_t::CLOSE: {
+            // 运行期间的任务沿用原来的文本，任务文件中的任务把文本复制到 task_texts
+            const task_record *current = task_database.find(task_id);
+            task_record record = current ? *current : store_task_record(existing.name, existing.description, existing.difficulty, false);
+            record.closed = true;
+            event.kind = titp_notice_kind_t::TASK_CLOSED;
+            event.difficulty = event.previous = record.difficulty;
+            event.name = existing.name;
+            task_database.assign(task_id, record);
+            break;
+        }
+        case titp_task_action_t::DELETE:
+            event.kind = titp_notice_kind_t::TASK_DELETED;
+            event.difficulty = event.previous = existing.difficulty;
+            event.name.clear();
+            task_database.assign(task_id, task_record{0, 0, 0, existing.difficulty, false, true});
+            break;
+    }
+
+    if (change.action != titp_task_action_t::DELETE || task_store.contains(task_id)) {
+        cache_task_response(task_id);
+    } else {
+        task_responses.erase(task_id);
+    }
+    return titp_resource_status_type_t::RESOURCE_ACK;
+}
+
+// 任务修改的结果回调，在任务日志的写线程（或提交修改的线程）中调用，task_id 为实际作用的任务
+using task_reply_t = std::function<void(uint64_t task_id, titp_resource_status_type_t status)>;
+
+/**
+ * @brief 提交一次任务修改，可以在任意线程调用，不等待磁盘。修改先追加到任务日志，所在的一批落盘后
+ * 在写线程中应用、向订阅者发布事件并调用 reply；同一批的修改共用一次 fsync。
+ * 新建任务在这里分配 ID；字段不合法或日志不可用时直接调用 reply。
+ */
+void submit_task_change(std::vector<std::unique_ptr<reactor>> &reactors, task_change change, task_reply_t reply) {
+    bool needs_id = change.action != titp_task_action_t::CREATE;
+    bool has_fields = change.action == titp_task_action_t::CREATE || change.action == titp_task_action_t::UPDATE;
+    if (change.action < titp_task_action_t::CREATE || change.action > titp_task_action_t::DELETE ||
+        (needs_id && change.task_id == 0) ||
+        (has_fields && (change.name.empty() || change.difficulty > task_difficulty_t::EXTREMELY_HARD))) {
+        reply(change.task_id, titp_resource_status_type_t::RESOURCE_INFO_MISMATCH);
+        return;
+    }
+    // 与任务文件、协议字段的长度一致，内存中的任务与写出的任务文件逐字节相同
+    if (change.name.size() > MAX_TASK_NAME_LENGTH) change.name.resize(MAX_TASK_NAME_LENGTH);
+    if (change.description.size() >= MAX_TASK_DESCRIPTION_SIZE) change.description.resize(MAX_TASK_DESCRIPTION_SIZE - 1);
+    if (change.action == titp_task_action_t::CREATE) {
+        change.task_id = last_task_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    uint64_t task_id = change.task_id;
+    bool logged = task_journal->append(change, [&reactors, change, reply](bool durable) {
+        if (!durable) {
+            reply(change.task_id, titp_resource_status_type_t::SERVER_TRANSFER_BREAKDOWN);
+            return;
+        }
+        task_event event;
+        titp_resource_status_type_t status;
+        {
+            std::unique_lock lock(task_lock);
+            status = apply_task_change(change, event);
+        }
+        if (status == titp_resource_status_type_t::RESOURCE_ACK) {
+            publish_task_event(reactors, event.kind, change.task_id, event.difficulty, event.previous, event.name);
+        }
+        reply(change.task_id, status);
+    });
+    if (!logged) reply(task_id, titp_resource_status_type_t::SERVER_TRANSFER_BREAKDOWN);
+}
+
+// 认证后处理客户端会话，直到登出、连接关闭或收发出错时返回
+task<void> handle_client_session(reactor &r, client_session &session);
+
+void close_session(reactor &r, int client_fd) {
+    r.loop.remove_fd(client_fd);
+    r.server.kick_client(client_fd);
+    r.sessions.erase(client_fd);
+    r.active_connections.fetch_sub(1, std::memory_order_relaxed);
+    println("Client %d disconnected.", client_fd);
+}
 
-int main() {
+/**
+ * @brief 一个连接的完整生命周期：认证、会话处理，最后关闭连接。
+ * 每次等待数据或发送缓冲区时协程挂起，事件循环线程转而服务其他连接。
+ */
+task<void> serve_client(reactor &r, client_session &session) {
+    int client_fd = session.conn.fd;
+    // 会话中逃出的异常（如编码响应时内存不足）在这里接住，之后照常关闭连接，fd 与会话都不会遗留
     try {
-        tcp_server server(PORT);
-        std::cout << std::string("Server Starts at:") +  SERVER_TEST + std::to_string(PORT) + std::string("\n");
-        println("Type 'exit' or 'quit' to shutdown the server.");
+        if (co_await handle_authentication(r, session)) {
+            session.state = session_state_t::ESTABLISHED;
+            session.conn.set_idle_timeout(IDLE_TIMEOUT * 1000ULL);
+            co_await handle_client_session(r, session);
+        }
+    } catch (const std::exception &e) {
+        println("Error: Session of client %d failed - %s", client_fd, e.what());
+    }
+    if (session.conn.malformed) {
+        println("Error: Unrecognized packet from client %d", client_fd);
+    }
+    if (session.conn.timed_out) {
+        println("Client %d timed out.", client_fd);
+    }
+    // 尽力写出仍在发送缓冲区中的响应（如认证失败的回复），不再等待连接可写
+    session.conn.flush();
+    close_session(r, client_fd);
+}
+
+// 为新连接建立会话并启动其协程，协程运行到第一次挂起时返回。
+void start_session(reactor &r, int client_fd) {
+    uint64_t serial = r.accepted_connections.fetch_add(1, std::memory_order_relaxed);
+    auto [it, inserted] = r.sessions.try_emplace(client_fd, client_fd, r.uring.get(), &r.loop.get_timers(), serial);
+    client_session &session = it->second;
+    // 认证完成之前按 CONNECTION_TIMEOUT 计时，只建立连接不登录的客户端不会一直占着连接
+    session.conn.set_idle_timeout(CONNECTION_TIMEOUT * 1000ULL);
+    session.conn.set_receive_timeout(RECEIVE_TIMEOUT * 1000ULL);
+    r.active_connections.fetch_add(1, std::memory_order_relaxed);
+    println("Client connected with FD: %d (reactor %d)", client_fd, r.id);
+
+    session.coroutine = detach(serve_client(r, session));
+    session.coroutine.resume();
+}
+
+// epoll 后端的 accept 协程：监听套接字上没有新连接时挂起。
+task<void> accept_loop(reactor &r) {
+    bool backoff = false;
+    while (true) {
+        int client_fd = co_await r.server.async_accept(backoff);
+        // accept 出错（例如文件描述符耗尽）时等到下一次就绪再试，避免空转。
+        backoff = client_fd < 0;
+        if (client_fd < 0) {
+            println("Error: accept failed - %s", strerror(-client_fd));
+            continue;
+        }
 
-        fd_set readfds;
-        int max_fd = std::max(server.get_server_fd(), 0) + 1;
+        bool registered = r.loop.add_fd(client_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                                        [&r, client_fd](uint32_t events) {
+                                            auto it = r.sessions.find(client_fd);
+                                            if (it != r.sessions.end()) it->second.conn.notify(events);
+                                        });
+        if (!registered) {
+            r.server.kick_client(client_fd);
+            continue;
+        }
 
-        while (server.is_active()) {
-            FD_ZERO(&readfds);
-            FD_SET(server.get_server_fd(), &readfds);
-            FD_SET(0, &readfds);
+        start_session(r, client_fd);
+    }
+}
 
-            int activity = select(max_fd, &readfds, nullptr, nullptr, nullptr);
+// io_uring 后端收到的一段数据：拷入连接的接收缓冲区（或暂存区）后唤醒等待报文的协程。
+void on_uring_recv(reactor &r, int client_fd, const std::byte *data, ssize_t len) {
+    auto it = r.sessions.find(client_fd);
+    if (it == r.sessions.end()) return;
+    tcp_connection &conn = it->second.conn;
 
-            if (activity < 0) {
-                println("Select error.");
-                break;
+    if (len <= 0 || !conn.feed(data, static_cast<size_t>(len))) {
+        conn.peer_closed = true;
+    }
+    conn.notify(EPOLLIN);
+}
+
+// io_uring 后端的 multishot accept 完成事件
+void on_uring_accept(reactor &r, int client_fd) {
+    if (client_fd < 0) {
+        println("Error: accept failed - %s", strerror(-client_fd));
+        return;
+    }
+
+    bool registered = r.uring->watch_recv(client_fd, [&r, client_fd](const std::byte *data, ssize_t len) {
+        on_uring_recv(r, client_fd, data, len);
+    });
+    // 发送完成后唤醒因积压超过高水位而挂起的会话
+    registered = registered && r.uring->watch_send(client_fd, [&r, client_fd]() {
+        auto it = r.sessions.find(client_fd);
+        if (it != r.sessions.end()) it->second.conn.notify(EPOLLOUT);
+    });
+    if (!registered) {
+        r.uring->close_fd(client_fd);
+        return;
+    }
+
+    start_session(r, client_fd);
+}
+
+// 将进程可打开的文件描述符数量提升到硬上限，以容纳成千上万的并发会话。
+void raise_fd_limit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// 将当前线程绑定到指定的 CPU 核心，失败时仅提示，不影响服务。
+void pin_to_core(std::thread &worker, int core) {
+    unsigned int cores = std::thread::hardware_concurrency();
+    if (cores == 0) return;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core % cores, &cpuset);
+    if (pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpuset) != 0) {
+        println("Warning: Failed to pin reactor thread to core %u", core % cores);
+    }
+}
+
+// Reactor 线程主体：注册自己的监听套接字后运行事件循环，退出时关闭名下的全部连接。
+void run_reactor(reactor &r) {
+    try {
+        if (r.uring) {
+            // io_uring 的完成队列可读时 ring fd 在 epoll 中就绪；每轮等待前统一提交本轮产生的 SQE。
+            r.server.attach_uring(r.uring.get());
+            r.loop.add_fd(r.uring->get_ring_fd(), EPOLLIN, [&r](uint32_t) {
+                r.uring->process_completions();
+            });
+            r.loop.set_pre_poll_hook([&r]() {
+                r.uring->submit_pending();
+            });
+            r.uring->watch_accept(r.server.get_server_fd(), [&r](int client_fd) {
+                on_uring_accept(r, client_fd);
+            });
+        } else {
+            r.loop.add_fd(r.server.get_server_fd(), EPOLLIN | EPOLLET, [&r](uint32_t) {
+                r.server.notify_acceptable();
+            });
+            r.acceptor = detach(accept_loop(r));
+            r.acceptor.resume();
+        }
+
+        // 会话令牌表由所有 Reactor 共用，只需要一个线程驱动它的过期
+        if (r.id == 0) {
+            r.session_expiry.callback = [&r]() {
+                login_sessions.expire(r.loop.now_ms());
+                r.loop.get_timers().schedule(r.session_expiry, SESSION_EXPIRY_INTERVAL_MS);
+            };
+            r.loop.get_timers().schedule(r.session_expiry, SESSION_EXPIRY_INTERVAL_MS);
+        }
+
+        r.loop.run();
+    } catch (const std::exception &e) {
+        std::cerr << "Reactor " << r.id << " error: " << e.what() << std::endl;
+    }
+
+    // 仍然存活的会话协程都挂起在各自的连接上，先销毁协程帧再关闭连接。
+    if (r.acceptor) r.acceptor.destroy();
+    for (auto &[client_fd, session] : r.sessions) {
+        session.coroutine.destroy();
+        r.server.kick_client(client_fd);
+    }
+    r.sessions.clear();
+    r.active_connections = 0;
+    r.server.shutdown_server();
+}
+
+/**
+ * @brief 向所有已认证的会话广播一帧。报文在调用线程中只编码一次，各 Reactor 线程把同一块共享内存
+ * 排入各自连接的发送缓冲区；每个连接独立记录写出进度，积压超过高水位时按 policy 处理。
+ *
+ * @param close_after 投递后关闭连接，用于 FORCE_LOGOUT
+ */
+void broadcast(std::vector<std::unique_ptr<reactor>> &reactors, broadcast_frames frames,
+               overflow_policy_t policy, bool close_after = false) {
+    for (auto &target : reactors) {
+        reactor &r = *target;
+        r.loop.post([&r, frames, policy, close_after]() {
+            // 投递可能恢复协程并关闭会话，先取出目标列表，再逐个按 fd 重新查找
+            std::vector<int> targets;
+            targets.reserve(r.sessions.size());
+            for (const auto &[fd, session] : r.sessions) {
+                if (session.state == session_state_t::ESTABLISHED) targets.push_back(fd);
             }
 
-            if (FD_ISSET(0, &readfds)) {
-                std::string input;
-                std::getline(std::cin, input);
-                if (input == "exit" || input == "quit") {
-                    println("Shutting down server...");
-                    break;
+            size_t queued = 0, dropped = 0, disconnected = 0;
+            for (int fd : targets) {
+                auto it = r.sessions.find(fd);
+                if (it == r.sessions.end()) continue;
+
+                client_session &session = it->second;
+                offer_result_t result = session.conn.offer(frame_for(session, frames), policy);
+                if (result == offer_result_t::QUEUED) ++queued;
+                else if (result == offer_result_t::DROPPED) ++dropped;
+                else ++disconnected;
+
+                if (close_after) {
+                    // 被强制下线的用户不能凭令牌恢复会话
+                    login_sessions.revoke(session.token.view());
+                    if (result == offer_result_t::QUEUED) session.conn.request_close();
                 }
             }
+            println("Reactor %d: broadcast queued for %zu session(s), %zu dropped, %zu disconnected.",
+                    r.id, queued, dropped, disconnected);
+        });
+    }
+}
 
-            if (FD_ISSET(server.get_server_fd(), &readfds)) {
-                int client_fd = server.accept_connection();
-                if (client_fd < 0) {
-                    continue;
-                }
+void print_reactor_stats(const std::vector<std::unique_ptr<reactor>> &reactors) {
+    size_t total = 0;
+    for (const auto &r : reactors) {
+        size_t active = r->active_connections.load(std::memory_order_relaxed);
+        total += active;
+        println("Reactor %d: %zu active connections, %llu accepted in total.", r->id, active,
+                static_cast<unsigned long long>(r->accepted_connections.load(std::memory_order_relaxed)));
+    }
+    println("All reactors: %zu active connections.", total);
+}
+
+/**
+ * @brief 剩余的运行期任务所引用的文本不到 task_texts 的一半时，把它们搬到新的存储区，释放被覆盖与已合并任务的旧文本。
+ * 调用者持有 task_lock 的写锁；缓存的响应已经编码成独立的报文，不引用 task_texts。
+ */
+void compact_task_texts() {
+    uint64_t live = 0;
+    task_database.for_each([&](uint64_t, const task_record &record) {
+        if (!record.deleted) live += record.name_length + record.description_length + 2;
+    });
+    if (live * 2 >= task_texts.used()) return;
 
-                println("Client connected with FD: %d", client_fd);
+    task_text_arena compacted;
+    task_database.for_each([&](uint64_t task_id, task_record &record) {
+        if (record.deleted) return;
+        task_view current = record_view(task_id, record);
+        record.text = compacted.append(current.name, current.description);
+    });
+    task_texts = std::move(compacted);
+}
+
+/**
+ * @brief 把当前的全部任务写成任务文件并同步所在目录，失败时抛出异常。
+ * 收集任务时持有读锁，Reactor 线程照常查找，新修改的应用等到收集结束。
+ *
+ * @return size_t 写出的任务数
+ */
+size_t write_task_file(const std::string &path) {
+    task_file_writer writer;
+    {
+        std::shared_lock lock(task_lock);
+        for_each_task([&](const task_view &task) {
+            writer.add(task.task_id, task.name, task.description, task.difficulty, task.closed);
+        });
+    }
+    writer.commit(path);
+    size_t slash = path.rfind('/');
+    if (!sync_directory(slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash))) {
+        throw std::runtime_error("Error: Failed to sync the directory of '" + path + "'.");
+    }
+    return writer.size();
+}
 
-                if (handle_authentication(server, client_fd)) {
-                    handle_client_session(server, client_fd);
+/**
+ * @brief 压缩任务日志：切换日志段，把当前的全部任务写回启动时确定的任务文件（task_store_path）并改为映射新文件，
+ * 然后删除旧的日志段。重启时读取的总是这个文件，删除的日志段因此不会丢失。
+ * rotate() 返回时旧段中的修改都已应用，之后取到的任务状态不早于旧段的末尾；写文件期间仍在应用的新修改
+ * 留在新段中，重放时再应用一次结果不变。
+ * 替换文件后，与新文件一致的运行期修改与墓碑被移除，之后才到达的修改保留。
+ *
+ * @return bool 是否写出并替换了任务文件
+ */
+bool compact_task_file() {
+    std::lock_guard guard(compaction_lock);
+    const std::string &path = task_store_path;
+    std::optional<uint64_t> segment = task_journal->rotate();
+    if (!segment) {
+        println("Error: Failed to start a new task log segment - %s", strerror(errno));
+        return false;
+    }
+    try {
+        size_t written_count = write_task_file(path);
+
+        task_file saved;
+        saved.open(path);
+        {
+            std::unique_lock lock(task_lock);
+            task_database.erase_if([&](uint64_t task_id, const task_record &record) {
+                task_view written{};
+                if (record.deleted) {
+                    if (saved.contains(task_id)) return false;
+                } else {
+                    task_view current = record_view(task_id, record);
+                    if (!saved.find(task_id, written) || written.name != current.name ||
+                        written.description != current.description || written.difficulty != current.difficulty ||
+                        written.closed != current.closed) {
+                        return false;
+                    }
                 }
+                task_responses.erase(task_id);
+                return true;
+            });
+            compact_task_texts();
+            task_store = std::move(saved);
+        }
+        task_journal->remove_before(*segment);
+        println("Saved %lu task(s) to '%s'.", written_count, path.c_str());
+        return true;
+    } catch (const std::exception &e) {
+        println("%s", e.what());
+        return false;
+    }
+}
 
-                server.kick_client(client_fd);
-                println("Client %d disconnected.", client_fd);
+/**
+ * @brief 把当前的全部任务导出到另一个文件。只是导出：不切换、不删除日志段，也不改变映射与重启时读取的任务文件。
+ */
+void export_task_file(const std::string &path) {
+    std::lock_guard guard(compaction_lock);
+    try {
+        size_t written_count = write_task_file(path);
+        println("Exported %lu task(s) to '%s'.", written_count, path.c_str());
+    } catch (const std::exception &e) {
+        println("%s", e.what());
+    }
+}
+
+/**
+ * @brief 控制台的任务管理命令，与 TITP 的任务修改走同一条日志，落盘后应用并向订阅者发布事件：
+ *   task add <difficulty> <name>[|<description>]
+ *   task update <id> <difficulty> <name>[|<description>]
+ *   task close <id>
+ *   task del <id>
+ *   task save           压缩任务日志，把全部任务写回启动时映射的任务文件
+ *   task save <path>    把全部任务导出到另一个文件，不影响任务日志
+ * 难度取 task_difficulty_t 的数值（0-5）。
+ */
+void handle_task_command(std::vector<std::unique_ptr<reactor>> &reactors, const std::string &command) {
+    std::istringstream in(command);
+    std::string action;
+    in >> action;
+
+    if (action == "save") {
+        std::string path;
+        in >> path;
+        if (path.empty() || path == task_store_path) {
+            compact_task_file();
+        } else {
+            export_task_file(path);
+        }
+        return;
+    }
+
+    task_change change;
+    if (action == "add") {
+        change.action = titp_task_action_t::CREATE;
+    } else if (action == "update") {
+        change.action = titp_task_action_t::UPDATE;
+    } else if (action == "close") {
+        change.action = titp_task_action_t::CLOSE;
+    } else if (action == "del") {
+        change.action = titp_task_action_t::DELETE;
+    } else {
+        println("Usage: task add <difficulty> <name>[|<description>], task update <id> <difficulty> <name>[|<description>], "
+                "task close <id>, task del <id>, task save [path]");
+        return;
+    }
+
+    if (change.action != titp_task_action_t::CREATE && !(in >> change.task_id)) {
+        println("Error: Missing task ID.");
+        return;
+    }
+
+    if (change.action == titp_task_action_t::CREATE || change.action == titp_task_action_t::UPDATE) {
+        int level = -1;
+        std::string text;
+        in >> level;
+        std::getline(in >> std::ws, text);
+        if (level < static_cast<int>(task_difficulty_t::UNKNOWN) ||
+            level > static_cast<int>(task_difficulty_t::EXTREMELY_HARD) || text.empty()) {
+            println("Error: Expected a difficulty between 0 and 5 followed by a task name.");
+            return;
+        }
+        size_t separator = text.find('|');
+        change.name = text.substr(0, separator);
+        change.description = separator == std::string::npos ? "" : text.substr(separator + 1);
+        change.difficulty = static_cast<task_difficulty_t>(level);
+    }
+
+    static const char *const done[] = {"", "posted", "updated", "closed", "deleted"};
+    const char *verb = done[static_cast<int>(change.action)];
+    submit_task_change(reactors, std::move(change), [verb](uint64_t task_id, titp_resource_status_type_t status) {
+        if (status == titp_resource_status_type_t::RESOURCE_ACK) {
+            println("Task %lu %s.", task_id, verb);
+        } else if (status == titp_resource_status_type_t::RESOURCE_NOT_FOUND) {
+            println("Error: Task %lu does not exist.", task_id);
+        } else if (status == titp_resource_status_type_t::RESOURCE_INFO_MISMATCH) {
+            println("Error: Invalid task ID or fields.");
+        } else {
+            println("Error: Failed to write task %lu to the task log.", task_id);
+        }
+    });
+}
+
+void print_usage(const char *program) {
+    println("Usage: %s [-t|--threads <count>] [-b|--backend epoll|io_uring] [-a|--auth-threads <count>] [--tasks <file>] [--data-dir <dir>]", program);
+    println("  -t, --threads <count>  Number of reactor threads, each with its own SO_REUSEPORT listener (default: 1).");
+    println("  -b, --backend <name>   Socket I/O backend: epoll (default) or io_uring.");
+    println("  -a, --auth-threads <count>  Number of password hashing threads (default: half of the CPU cores, at least 1).");
+    println("  --tasks <file>         Task file to serve, memory-mapped at startup; the task log is replayed on top of it and");
+    println("                         compacted into it (default: %s in the data directory, or built-in sample tasks).", TASK_SNAPSHOT_FILE);
+    println("  --data-dir <dir>       Directory of the account and task logs and snapshots (default: %s).", DEFAULT_DATA_DIRECTORY);
+}
+
+int main(int argc, char *argv[]) {
+    int thread_count = 1;
+    int auth_thread_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency() / 2));
+    io_backend_t backend = io_backend_t::EPOLL;
+    std::string data_directory = DEFAULT_DATA_DIRECTORY;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            try {
+                thread_count = std::stoi(argv[++i]);
+            } catch (...) {
+                thread_count = 0;
+            }
+            if (thread_count < 1) {
+                println("Error: Thread count must be a positive integer.");
+                return 1;
+            }
+        } else if ((arg == "-a" || arg == "--auth-threads") && i + 1 < argc) {
+            try {
+                auth_thread_count = std::stoi(argv[++i]);
+            } catch (...) {
+                auth_thread_count = 0;
+            }
+            if (auth_thread_count < 1) {
+                println("Error: Auth thread count must be a positive integer.");
+                return 1;
+            }
+        } else if ((arg == "-b" || arg == "--backend") && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "epoll") {
+                backend = io_backend_t::EPOLL;
+            } else if (name == "io_uring") {
+                backend = io_backend_t::IO_URING;
+            } else {
+                println("Error: Unknown backend '%s'.", name.c_str());
+                return 1;
             }
+        } else if (arg == "--tasks" && i + 1 < argc) {
+            task_store_path = argv[++i];
+        } else if (arg == "--data-dir" && i + 1 < argc) {
+            data_directory = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    try {
+        raise_fd_limit();
+        ensure_directory(data_directory);
+        bool explicit_task_file = !task_store_path.empty();
+        if (!explicit_task_file) task_store_path = data_directory + "/" + TASK_SNAPSHOT_FILE;
+        if (explicit_task_file || access(task_store_path.c_str(), F_OK) == 0) {
+            // 只映射文件并校验首部，任务在第一次被请求时才从磁盘读入
+            task_store.open(task_store_path);
+            println("Mapped %lu task(s) from '%s'.", task_store.size(), task_store_path.c_str());
+        } else {
+            for (const sample_task &task : sample_tasks) {
+                task_database.assign(task.task_id, store_task_record(task.name, task.description, task.difficulty, false));
+            }
+        }
+        build_response_cache();
+
+        // 在任务文件之上按顺序重放任务日志，之后新建的任务从现有的最大 ID 之后分配
+        task_journal = std::make_unique<task_log>(data_directory);
+        size_t replayed = task_journal->recover([](const task_change &change) {
+            task_event event;
+            apply_task_change(change, event);
+        }, []() {
+            return compact_task_file();
+        });
+        uint64_t max_task_id = task_store.max_task_id();
+        task_database.for_each([&](uint64_t task_id, const task_record&) {
+            max_task_id = std::max(max_task_id, task_id);
+        });
+        last_task_id.store(max_task_id, std::memory_order_relaxed);
+        println("Replayed %zu task change(s) from the task log.", replayed);
+
+        // 先从快照与日志恢复账户，首次启动时再写入初始账户
+        account_journal = std::make_unique<account_log>(user_database, data_directory);
+        account_recovery recovered = account_journal->recover();
+        println("Recovered %zu account(s) from '%s': %zu from the snapshot, %zu log record(s) in %zu segment(s).",
+                recovered.accounts, data_directory.c_str(), recovered.snapshot_records, recovered.log_records,
+                recovered.log_segments);
+        if (recovered.torn_tail) {
+            println("Warning: Discarded an incomplete record at the end of the account log.");
         }
+        build_user_database();
+        // 对端关闭后继续写入时不能让 SIGPIPE 终止整个服务器
+        signal(SIGPIPE, SIG_IGN);
 
-        server.shutdown_server();
+        // 只有一个 Reactor 时不需要 SO_REUSEPORT，保持与单线程模式相同的端口独占语义。
+        bool reuse_port = thread_count > 1;
+        std::vector<std::unique_ptr<reactor>> reactors;
+        for (int i = 0; i < thread_count; ++i) {
+            reactors.push_back(std::make_unique<reactor>(i, reuse_port, backend));
+            reactors.back()->peers = &reactors;
+            if (!tcp_server::set_nonblocking(reactors.back()->server.get_server_fd())) {
+                throw std::runtime_error(std::string("Error: Failed to set listening socket non-blocking - ") + strerror(errno));
+            }
+        }
+
+        std::cout << std::string("Server Starts at:") +  SERVER_TEST + std::to_string(PORT) + std::string("\n");
+        println("Running %d reactor thread(s) with the %s backend, %d auth thread(s).", thread_count,
+                backend == io_backend_t::IO_URING ? "io_uring" : "epoll", auth_thread_count);
+        println("Type 'stats' to show connection counts, 'snapshot' to compact the account log, 'exit' or 'quit' to shutdown the server.");
+        println("Type 'notice <text>' to broadcast a maintenance notice, 'kickall [reason]' to force every user to log out.");
+        println("Type 'task add|update|close|del ...' to change tasks, subscribed clients are notified, 'task save' to compact the task log, 'task save <path>' to export the tasks.");
+
+        auth_workers.start(static_cast<size_t>(auth_thread_count));
+        for (auto &r : reactors) {
+            r->worker = std::thread(run_reactor, std::ref(*r));
+            pin_to_core(r->worker, r->id);
+        }
+
+        // 控制台运行在主线程，所有连接都由 Reactor 线程处理。
+        bool shutdown_requested = false;
+        std::string input;
+        while (std::getline(std::cin, input)) {
+            if (input == "exit" || input == "quit") {
+                println("Shutting down server...");
+                shutdown_requested = true;
+                break;
+            }
+            if (input == "stats") {
+                print_reactor_stats(reactors);
+                println("Resumable sessions: %zu, queued auth jobs: %zu", login_sessions.size(), auth_workers.queued());
+                println("Accounts: %zu, account log: %lu record(s) in %lu fsync(s), %lu snapshot(s)%s", user_database.size(),
+                        account_journal->records(), account_journal->batches(), account_journal->snapshots(),
+                        account_journal->healthy() ? "" : ", write failed");
+                println("Task log: %lu change(s) in %lu fsync(s)%s", task_journal->records(), task_journal->batches(),
+                        task_journal->healthy() ? "" : ", write failed");
+                {
+                    std::shared_lock lock(task_lock);
+                    println("Runtime tasks: %zu, task text: %lu byte(s) in %zu KiB", task_database.size(), task_texts.used(),
+                            task_texts.reserved() / 1024);
+                }
+            } else if (input == "snapshot") {
+                println(account_journal->snapshot() ? "Account snapshot written." : "Error: Failed to write account snapshot.");
+            } else if (input.rfind("notice ", 0) == 0) {
+                // 公告可以丢失：来不及读取的会话直接跳过这一条
+                titp_t notice(titp_msg_type_t::NOTICE);
+                notice.set_notice(titp_notice_kind_t::MAINTENANCE, 0, input.substr(7));
+                broadcast(reactors, encode_broadcast(notice), overflow_policy_t::DROP);
+            } else if (input == "kickall" || input.rfind("kickall ", 0) == 0) {
+                // PIAP v2 不携带提示文本，原因先以公告发出；同一 Reactor 上投递的任务按顺序执行，公告一定先于下线报文
+                if (input.size() > 8) {
+                    titp_t reason(titp_msg_type_t::NOTICE);
+                    reason.set_notice(titp_notice_kind_t::MAINTENANCE, 0, input.substr(8));
+                    broadcast(reactors, encode_broadcast(reason), overflow_policy_t::FORCE);
+                }
+                piap_t logout(piap_msg_type_t::FORCE_LOGOUT);
+                broadcast(reactors, encode_broadcast(logout), overflow_policy_t::FORCE, true);
+            } else if (input.rfind("task ", 0) == 0) {
+                handle_task_command(reactors, input.substr(5));
+            }
+        }
+        if (!shutdown_requested) {
+            println("Warning: Console input is unavailable, stop the server with a signal.");
+            for (auto &r : reactors) {
+                r->worker.join();
+            }
+        }
+
+        // 认证任务引用着挂起的会话协程，必须在 Reactor 销毁会话之前停止线程池；
+        // 已经投递的结果仍由事件循环照常处理，尚未执行的任务被丢弃，对应的协程随会话一起销毁
+        auth_workers.stop();
+        // 日志的完成回调同样会恢复会话协程或向会话投递确认，写出剩余的记录后停止
+        account_journal->stop();
+        task_journal->stop();
+        for (auto &r : reactors) {
+            r->loop.stop();
+        }
+        for (auto &r : reactors) {
+            if (r->worker.joinable()) r->worker.join();
+        }
+
+        print_reactor_stats(reactors);
         std::cout << std::string("Server closes successfully!\n");
 
     } catch (const std::exception &e) {
@@ -168,49 +1498,219 @@ int main() {
     return 0;
 }
 
-void handle_client_session(tcp_server &server, int client_fd) {
-    while (true) {
-        // 先尝试读控制包
-        auto ctrl_packet = server.recv_ctrl_packet(client_fd);
-        if (ctrl_packet) {
-            if (ctrl_packet->get_msg_type() == piap_msg_type_t::LOGOUT_REQUEST) {
-                println("Client %d logged out.", client_fd);
-                break;
+/**
+ * @brief 更新会话的订阅条件并回复 SUBSCRIBE_ACK。订阅期间连接每次写出积压后都继续投递排队的事件。
+ */
+void update_subscription(client_session &session, const titp_view_t &request) {
+    task_subscription &subscription = session.subscription;
+    subscription.active = request.get_subscription_active();
+    subscription.min_difficulty = std::min(request.get_min_difficulty(), request.get_max_difficulty());
+    subscription.max_difficulty = std::max(request.get_min_difficulty(), request.get_max_difficulty());
+    if (subscription.active) {
+        session.conn.on_writable = [&session]() {
+            deliver_task_events(session);
+        };
+    } else {
+        subscription.events.clear();
+        session.conn.on_writable = nullptr;
+    }
+
+    titp_t ack(titp_msg_type_t::SUBSCRIBE_ACK);
+    ack.set_version(request.get_version());
+    ack.set_request_id(request.get_request_id());
+    ack.set_subscription(subscription.active, subscription.min_difficulty, subscription.max_difficulty);
+    session.conn.send_buf.encode(ack);
+}
+
+// 在途的任务修改达到上限时挂起会话协程，由确认回落到一半时恢复；每个已提交的修改都一定会被确认
+struct task_change_backlog {
+    client_session &session;
+
+    bool await_ready() const noexcept {
+        return session.pending_task_changes < MAX_PENDING_TASK_CHANGES;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) noexcept {
+        session.change_waiter = h;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+// 把任务修改的确认追加到连接的发送缓冲区
+void encode_task_change_ack(send_buffer &out, uint16_t version, uint32_t request_id, titp_task_action_t action,
+                            uint64_t task_id, titp_resource_status_type_t status) {
+    titp_t ack(titp_msg_type_t::TASK_CHANGE_ACK);
+    ack.set_version(version);
+    ack.set_request_id(request_id);
+    ack.set_task_change_ack(action, task_id, status);
+    out.encode(ack);
+}
+
+/**
+ * @brief 处理 TASK_CHANGE：检查权限后提交到任务日志，不等待落盘，协程继续读取下一个请求，
+ * 同一连接上流水线化的修改与其他连接的修改一起成组提交。修改落盘并应用后，日志的写线程把确认投递回本 Reactor
+ * 写入连接；连接已经关闭、fd 被新连接复用时按序号认出并丢弃。
+ */
+void handle_task_change(reactor &r, client_session &session, const titp_view_t &request) {
+    uint16_t version = request.get_version();
+    uint32_t request_id = request.get_request_id();
+    titp_task_action_t action = request.get_task_action();
+
+    uint8_t level = 0;
+    user_database.visit(session.user.view(), [&](const user_record &record) { level = record.level; });
+    if (level < TASK_EDITOR_LEVEL) {
+        encode_task_change_ack(session.conn.send_buf, version, request_id, action, request.get_task_id(),
+                               titp_resource_status_type_t::RESOURCE_EXPIRED);
+        return;
+    }
+
+    task_change change;
+    change.action = action;
+    change.task_id = request.get_task_id();
+    change.difficulty = request.get_task_change_difficulty();
+    change.name = request.get_task_change_name();
+    change.description = request.get_task_change_description();
+    ++session.pending_task_changes;
+
+    reactor *home = &r;
+    int client_fd = session.conn.fd;
+    uint64_t serial = session.serial;
+    submit_task_change(*r.peers, std::move(change),
+                       [home, client_fd, serial, version, request_id, action](uint64_t task_id,
+                                                                               titp_resource_status_type_t status) {
+        home->loop.post([home, client_fd, serial, version, request_id, action, task_id, status]() {
+            auto it = home->sessions.find(client_fd);
+            if (it == home->sessions.end() || it->second.serial != serial) return;
+            client_session &target = it->second;
+            --target.pending_task_changes;
+            encode_task_change_ack(target.conn.send_buf, version, request_id, action, task_id, status);
+            target.conn.flush();
+            // 恢复后协程可能关闭会话，之后不再访问 target
+            if (target.change_waiter && target.pending_task_changes <= MAX_PENDING_TASK_CHANGES / 2) {
+                std::exchange(target.change_waiter, nullptr).resume();
             }
-            continue;
+        });
+    });
+}
+
+/**
+ * @brief 处理已登录用户的修改密码请求：PBKDF2 交给认证线程池，新密码落盘后回复 CHANGE_PASSWORD_RESPONSE。
+ * 只能修改当前登录的账户。修改成功后该用户之前的令牌都已作废，响应携带为当前连接新签发的令牌。
+ *
+ * @return bool 回复是否成功发出
+ */
+task<bool> handle_password_change(reactor &r, client_session &session, const piap_view_t &request) {
+    uint16_t version = request.get_version();
+    piap_auth_type_t status = piap_auth_type_t::BAD_REQUEST;
+    auto format_status = request.valid_format(r.loop.unix_time());
+    if (format_status == piap_format_type_t::FORMAT_OK && request.get_userID() == session.user.view()) {
+        // 请求视图在挂起后失效，凭据先复制进 awaitable
+        auth_awaitable change(r.loop, auth_operation_t::CHANGE_PASSWORD);
+        change.username.assign(request.get_userID());
+        change.password.assign(request.get_password());
+        change.new_password.assign(request.get_new_password());
+        status = co_await change;
+        if (session.conn.close_requested) co_return false;
+    }
+
+    piap_response_t response(version, piap_msg_type_t::CHANGE_PASSWORD_RESPONSE);
+    response.set_format_status(format_status);
+    response.set_auth_status(status);
+    // 改密成功时当前连接的令牌也已作废，重新签发一个随响应下发
+    if (status == piap_auth_type_t::PASSWORD_CHANGED &&
+        login_sessions.issue(session.user.view(), r.loop.now_ms(), session.token)) {
+        response.session = session.token.view();
+    }
+    println("Password change for %s: %s", session.user.c_str(), piap_auth_status_message(status));
+    co_return co_await r.server.async_send_ctrl_packet(session.conn, response);
+}
+
+task<void> handle_client_session(reactor &r, client_session &session) {
+    tcp_server &server = r.server;
+    tcp_connection &conn = session.conn;
+    while (true) {
+        auto frame = co_await server.async_recv_frame(conn);
+        if (!frame) {
+            println("Connection closed for client %d", conn.fd);
+            co_return;
         }
-        
-        // 再尝试读数据包
-        auto data_packet = server.recv_data_packet(client_fd);
-        if (data_packet) {
-            if (data_packet->get_msg_type() == titp_msg_type_t::RESOURCE_REQUEST) {
-                // 处理任务请求（同之前的代码）
-                uint64_t task_id = data_packet->get_task_id();
-                auto response = std::make_unique<titp_t>(titp_msg_type_t::RESOURCE_SENT);
-                
-                if (task_database.find(task_id) != task_database.end()) {
-                    auto &task_info = task_database[task_id];
-                    response->set_task_id(task_id);
-                    response->set_task_name(task_info.first.c_str());
-                    response->set_task_description(task_info.second.c_str());
-                    response->set_difficulty(task_difficulty_t::MEDIUM);
-                    response->set_resource_status(titp_resource_status_type_t::RESOURCE_ACK);
-                    response->set_msg_status(titp_format_type_t::FORMAT_OK);
-                } else {
-                    response->set_resource_status(titp_resource_status_type_t::RESOURCE_NOT_FOUND);
-                    response->set_msg_status(titp_format_type_t::FORMAT_OK);
+
+        // 控制包
+        if (frame->kind == frame_kind_t::PIAP) {
+            piap_view_t ctrl_packet(frame->data, frame->size);
+            if (ctrl_packet.valid() && ctrl_packet.get_msg_type() == piap_msg_type_t::LOGOUT_REQUEST) {
+                login_sessions.revoke(session.token.view());
+                println("Client %d logged out.", conn.fd);
+                co_return;
+            }
+            if (ctrl_packet.valid() && ctrl_packet.get_msg_type() == piap_msg_type_t::CHANGE_PASSWORD_REQUEST) {
+                if (!co_await handle_password_change(r, session, ctrl_packet)) {
+                    println("Error: Failed to answer password change for client %d", conn.fd);
+                    co_return;
                 }
-                
-                send_data_packet(server, client_fd, std::move(response));
-                println("Handled task request for task ID %lu", task_id);
             }
             continue;
         }
-        
-        // 两种包都没收到，连接断开
-        if (!ctrl_packet && !data_packet) {
-            println("Connection closed for client %d", client_fd);
-            break;
+
+        // 数据包，只读取所需的字段而不反序列化整个报文
+        titp_view_t data_packet(frame->data, frame->size);
+        if (!data_packet.valid()) {
+            println("Connection closed for client %d", conn.fd);
+            co_return;
+        }
+        session.titp_version = data_packet.get_version();
+
+        if (data_packet.get_msg_type() == titp_msg_type_t::RESOURCE_REQUEST) {
+            uint64_t task_id = data_packet.get_task_id();
+            // 引用缓存中的响应或从任务文件编码，带回请求编号，客户端据此把响应对应到各自的在途请求
+            {
+                std::shared_lock lock(task_lock);
+                enqueue_task_response(conn.send_buf, task_id, data_packet.get_version(), data_packet.get_request_id());
+            }
+
+            // 积压超过高水位时协程在这里挂起并停止读取新请求，直到对端读走响应
+            if (!co_await conn.async_drain()) {
+                println("Error: Failed to send task response to client %d", conn.fd);
+                co_return;
+            }
+            println("Handled task request for task ID %lu", task_id);
+        } else if (data_packet.get_msg_type() == titp_msg_type_t::BATCH_REQUEST) {
+            uint32_t batch_count = data_packet.get_batch_count();
+            bool finished = true;
+            board_cursor cursor{data_packet.get_version(), data_packet.get_request_id()};
+            if (batch_count > 0) {
+                encode_batch_response(data_packet, conn.send_buf);
+            } else {
+                // 整个任务板分段编码，积压达到高水位后挂起，对端读走后再继续，内存占用与任务数量无关
+                finished = encode_board_chunk(cursor, conn);
+            }
+            while (true) {
+                if (!co_await conn.async_drain()) {
+                    println("Error: Failed to send batch response to client %d", conn.fd);
+                    co_return;
+                }
+                if (finished) break;
+                finished = encode_board_chunk(cursor, conn);
+            }
+            println("Handled batch request for %u task(s)", batch_count > 0 ? batch_count : cursor.sent);
+        } else if (data_packet.get_msg_type() == titp_msg_type_t::SUBSCRIBE) {
+            update_subscription(session, data_packet);
+            if (!co_await conn.async_drain()) {
+                println("Error: Failed to send subscribe response to client %d", conn.fd);
+                co_return;
+            }
+            println("Client %d %s task events.", conn.fd,
+                    session.subscription.active ? "subscribed to" : "unsubscribed from");
+        } else if (data_packet.get_msg_type() == titp_msg_type_t::TASK_CHANGE) {
+            // 通常没有立即写出的内容，只有没有权限的修改在这里直接回复
+            handle_task_change(r, session, data_packet);
+            if (!co_await conn.async_drain()) {
+                println("Error: Failed to send task change response to client %d", conn.fd);
+                co_return;
+            }
+            // 与发送积压一样，在途的修改过多时停止读取新请求
+            co_await task_change_backlog{session};
         }
     }
 }
\ No newline at end of file
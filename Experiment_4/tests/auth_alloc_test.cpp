@@ -0,0 +1,185 @@
+// 认证路径的分配计数测试：替换全局 operator new，预热之后签发、恢复、作废令牌，
+// 并把登录与恢复的响应编码进发送缓冲区；登录从 Reactor 交给认证线程池查出密码哈希、校验、
+// 再投递回事件循环的往返也单独计数。预热之后整个过程不应再有任何堆分配。
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <string_view>
+#include "../src/include/network/event_loop.h"
+#include "../src/include/network/send_buffer.h"
+#include "../src/include/protocols/PIAP.h"
+#include "../src/include/security/auth_pool.h"
+#include "../src/include/security/session_table.h"
+#include "../src/include/security/user_store.h"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+int failures = 0;
+
+void check(bool condition, const char *what) {
+    if (!condition) {
+        std::printf("FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+// 一次登录加一次恢复在服务器上经过的令牌表操作与响应编码
+void login_and_resume(session_table &table, send_buffer &out, uint64_t now_ms) {
+    session_token token;
+    if (!table.issue("admin", now_ms, token)) return;
+
+    for (uint16_t version : {PIAP_VERSION_V1, PIAP_VERSION_V2}) {
+        piap_response_t response(version, piap_msg_type_t::LOGIN_RESPONSE);
+        response.set_auth_status(piap_auth_type_t::LOGIN_SUCCESS);
+        response.session = token.view();
+        out.encode(response);
+    }
+
+    size_t user_length = 0;
+    table.resume(token.view(), now_ms, [&](std::string_view user) { user_length = user.size(); });
+    piap_response_t resumed(PIAP_VERSION_V2, piap_msg_type_t::RESUME_RESPONSE);
+    resumed.set_auth_status(user_length > 0 ? piap_auth_type_t::LOGIN_SUCCESS : piap_auth_type_t::SESSION_EXPIRED);
+    out.encode(resumed);
+
+    table.revoke(token.view());
+    out.consume(out.size());
+}
+
+// 与服务器中的 auth_awaitable 相同的往返：Reactor 线程提交任务，工作线程查出密码哈希并校验，
+// 结果写进自身后只捕获 this 投递回事件循环；回到循环后再提交下一轮，全部轮次完成后停止循环
+struct login_handoff {
+    static constexpr size_t WARMUP = 100;
+    static constexpr size_t ROUNDS = 10000;
+
+    event_loop &loop;
+    auth_pool &pool;
+    const user_store &users;
+    bool accepted = false;
+    size_t completed = 0;
+    size_t verified = 0;
+    size_t before = 0;
+    size_t steady = 0;
+    bool rejected = false;
+
+    void submit() {
+        bool queued = pool.submit([this]() {
+            std::optional<password_hash> hash = users.find_password("admin");
+            accepted = hash && hash->verify("admin123");
+            loop.post([this]() {
+                finish();
+            });
+        });
+        if (!queued) {
+            rejected = true;
+            loop.stop();
+        }
+    }
+
+    void finish() {
+        if (accepted) ++verified;
+        ++completed;
+        // 预热轮次里线程池的槽、任务队列的两块缓冲区与读端纪元的登记都已就位
+        if (completed == WARMUP) before = allocations.load();
+        if (completed == WARMUP + ROUNDS) {
+            steady = allocations.load() - before;
+            loop.stop();
+            return;
+        }
+        submit();
+    }
+};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    constexpr size_t CAPACITY = 1024;
+    constexpr uint64_t TTL_MS = 30 * 60 * 1000;
+    session_table table(0, std::chrono::minutes(30), CAPACITY);
+    send_buffer out;
+
+    // 预热：发送缓冲区的第一块内存在这里分配，之后写空的最后一块留作复用
+    login_and_resume(table, out, 1);
+
+    size_t before = allocations.load();
+    check(before > 0, "allocation counter sees the warm-up allocations");
+    for (uint64_t i = 0; i < 100000; ++i) {
+        login_and_resume(table, out, 1 + i / 100);
+        if (i % 1000 == 0) table.expire(1 + i / 100);
+    }
+    size_t steady = allocations.load() - before;
+    std::printf("allocations during 100000 login/resume rounds: %zu\n", steady);
+    check(steady == 0, "login and resume allocate after warm-up");
+
+    // 登录交给认证线程池再送回 Reactor：查找密码哈希、提交任务、投递结果都不应分配内存
+    {
+        user_store users;
+        // 迭代次数取 1，测的是往返本身而不是 PBKDF2
+        users.insert(user_record{"admin", password_hash::create("admin123", 1), "Administrator", 1});
+        event_loop loop;
+        auth_pool pool;
+        pool.start(1);
+        login_handoff handoff{loop, pool, users};
+        handoff.submit();
+        loop.run();
+        pool.stop();
+        std::printf("allocations during %zu login handoffs: %zu\n", login_handoff::ROUNDS, handoff.steady);
+        check(!handoff.rejected, "auth pool accepts the login job");
+        check(handoff.completed == login_handoff::WARMUP + login_handoff::ROUNDS, "every login job comes back");
+        check(handoff.verified == handoff.completed, "worker verifies the stored password");
+        check(handoff.steady == 0, "login handoff through the auth pool allocates after warm-up");
+    }
+
+    // 行为：作废后不能恢复，表满后不再签发，到期后全部淘汰
+    session_token token;
+    check(table.issue("user1", 2000, token), "issue a token");
+    check(table.resume(token.view(), 2000, [](std::string_view user) { check(user == "user1", "resumed user"); }),
+          "resume an issued token");
+    table.revoke(token.view());
+    check(!table.resume(token.view(), 2000, [](std::string_view) {}), "revoked token cannot resume");
+    check(!table.resume("not a token", 2000, [](std::string_view) {}), "malformed token cannot resume");
+
+    // 改密后作废该用户的全部令牌，其他用户的令牌不受影响
+    session_token first, second, other;
+    table.issue("user1", 2000, first);
+    table.issue("user1", 2000, second);
+    table.issue("user9", 2000, other);
+    check(table.revoke_user("user1") == 2, "revoke every token of a user");
+    check(!table.resume(first.view(), 2000, [](std::string_view) {}) &&
+          !table.resume(second.view(), 2000, [](std::string_view) {}), "revoked user tokens cannot resume");
+    check(table.resume(other.view(), 2000, [](std::string_view) {}), "other users keep their tokens");
+    table.revoke(other.view());
+
+    size_t issued = 0;
+    for (size_t i = 0; i < CAPACITY + 10; ++i) {
+        if (table.issue("user2", 2000, token)) ++issued;
+    }
+    check(issued == CAPACITY, "table stops issuing at capacity");
+    check(token.empty(), "token cleared when table is full");
+
+    table.expire(2000 + TTL_MS + 2 * SESSION_EXPIRY_TICK_MS);
+    check(table.size() == 0, "expired tokens are removed");
+    check(table.issue("user3", 2000 + TTL_MS + 2 * SESSION_EXPIRY_TICK_MS, token), "issue after expiry");
+
+    if (failures == 0) std::printf("PASS\n");
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
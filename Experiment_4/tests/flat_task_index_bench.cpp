@@ -0,0 +1,135 @@
+// flat_task_index 与 std::unordered_map 的对比基准：按服务器的用法以连续的任务 ID 逐个插入，
+// 再随机查找存在与不存在的 ID，并记录常驻内存的增量。两种表依次测量，同一时刻只有一张表在内存中。
+// 用法：flat_task_index_bench [任务数 ...]，默认 10000 1000000 50000000
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <random>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "../src/include/protocols/TITP.h"
+#include "../src/include/storage/flat_task_index.h"
+
+namespace {
+
+// 与 server.cpp 中的 task_record 布局相同
+struct task_record {
+    uint64_t text;
+    uint16_t name_length;
+    uint16_t description_length;
+    task_difficulty_t difficulty;
+    bool closed;
+    bool deleted;
+};
+
+// 每种查找的次数，与任务数无关，小表的结果因此不只是几微秒的噪声
+constexpr size_t LOOKUPS = 10000000;
+
+struct result {
+    double insert_ns;
+    double hit_ns;
+    double miss_ns;
+    double resident_mb;
+    uint64_t checksum;
+};
+
+double resident_mb() {
+    FILE *file = std::fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long size = 0, resident = 0;
+    if (std::fscanf(file, "%lu %lu", &size, &resident) != 2) resident = 0;
+    std::fclose(file);
+    return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+double elapsed_ns(std::chrono::steady_clock::time_point start, size_t operations) {
+    std::chrono::duration<double, std::nano> spent = std::chrono::steady_clock::now() - start;
+    return spent.count() / static_cast<double>(operations);
+}
+
+task_record make_record(uint64_t task_id) {
+    return task_record{task_id * 64, 12, 40, static_cast<task_difficulty_t>(task_id % 6), false, false};
+}
+
+// 两种表只在插入与查找的写法上不同，其余测量过程相同
+template<typename Table, typename Insert, typename Find>
+result measure(size_t count, const std::vector<uint64_t> &hits, const std::vector<uint64_t> &misses,
+               Insert &&insert, Find &&find) {
+    result r{};
+    malloc_trim(0);
+    double before = resident_mb();
+    {
+        Table table;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t task_id = 1; task_id <= count; ++task_id) insert(table, task_id, make_record(task_id));
+        r.insert_ns = elapsed_ns(start, count);
+        r.resident_mb = resident_mb() - before;
+
+        start = std::chrono::steady_clock::now();
+        for (uint64_t task_id : hits) {
+            const task_record *record = find(table, task_id);
+            r.checksum += record ? record->text : 1;
+        }
+        r.hit_ns = elapsed_ns(start, hits.size());
+
+        start = std::chrono::steady_clock::now();
+        for (uint64_t task_id : misses) {
+            const task_record *record = find(table, task_id);
+            r.checksum += record ? record->text : 1;
+        }
+        r.miss_ns = elapsed_ns(start, misses.size());
+    }
+    malloc_trim(0);
+    return r;
+}
+
+void print_result(const char *name, size_t count, const result &r) {
+    std::printf("%-20s %10zu %12.1f %12.1f %12.1f %12.1f\n", name, count, r.insert_ns, r.hit_ns, r.miss_ns, r.resident_mb);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (counts.empty()) counts = {10000, 1000000, 50000000};
+
+    std::printf("%-20s %10s %12s %12s %12s %12s\n", "table", "tasks", "insert ns", "hit ns", "miss ns", "RSS MiB");
+    uint64_t checksum = 0;
+    for (size_t count : counts) {
+        if (count == 0) continue;
+        // 随机的查找顺序，与客户端请求的任务 ID 一样没有局部性；未命中的 ID 都大于已有的最大 ID
+        std::mt19937_64 random(count);
+        std::vector<uint64_t> hits(LOOKUPS), misses(LOOKUPS);
+        for (auto &task_id : hits) task_id = 1 + random() % count;
+        for (auto &task_id : misses) task_id = count + 1 + random() % count;
+
+        result flat = measure<flat_task_index<task_record>>(count, hits, misses,
+            [](flat_task_index<task_record> &table, uint64_t task_id, const task_record &record) {
+                table.assign(task_id, record);
+            },
+            [](const flat_task_index<task_record> &table, uint64_t task_id) {
+                return table.find(task_id);
+            });
+        print_result("flat_task_index", count, flat);
+
+        using node_map = std::unordered_map<uint64_t, task_record>;
+        result node = measure<node_map>(count, hits, misses,
+            [](node_map &table, uint64_t task_id, const task_record &record) {
+                table.insert_or_assign(task_id, record);
+            },
+            [](const node_map &table, uint64_t task_id) -> const task_record* {
+                auto it = table.find(task_id);
+                return it == table.end() ? nullptr : &it->second;
+            });
+        print_result("std::unordered_map", count, node);
+        checksum += flat.checksum ^ node.checksum;
+    }
+    // 校验和只是为了让查找不被优化掉，两种表的结果相同时为 0
+    std::printf("checksum %lu\n", static_cast<unsigned long>(checksum));
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#!/bin/sh
+# 任务文件导出后重启的测试：task save <path> 只导出，不截断任务日志，也不改变重启时读取的任务文件。
+# 第一次运行新建两个任务、导出到另一个文件、再修改其中一个；重启后两个任务连同导出之后的修改都应当还在。
+# 用法：task_save_restart_test.sh <server>
+
+server=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# 控制台命令之间稍作停顿：任务修改落盘后才应用，紧接着的导出应当看到它
+run() {
+    for command in "$@" exit; do
+        echo "$command"
+        sleep 0.2
+    done | "$server" --data-dir "$dir/data" > "$dir/server.log" 2>&1
+}
+
+fail() {
+    echo "FAIL: $1"
+    cat "$dir/server.log"
+    exit 1
+}
+
+run "task add 2 alpha|created before export" "task add 2 gamma|created before export" \
+    "task save $dir/export.bin" "task update 4 3 beta|changed after export"
+grep -aq alpha "$dir/export.bin" && grep -aq gamma "$dir/export.bin" || fail "export contains the tasks created before it"
+grep -aq beta "$dir/export.bin" && fail "export does not contain later changes"
+
+# 重启后再导出一次，检查恢复出的全部任务
+run "task save $dir/after.bin"
+grep -aq gamma "$dir/after.bin" || fail "task created before the export survives a restart"
+grep -aq beta "$dir/after.bin" || fail "change made after the export survives a restart"
+grep -aq alpha "$dir/after.bin" && fail "restart replays the change made after the export"
+
+# 压缩写回数据目录中的任务文件，重启后不再依赖被删除的日志段
+run "task save" "task close 5"
+run "task save $dir/compacted.bin"
+grep -aq gamma "$dir/compacted.bin" && grep -aq beta "$dir/compacted.bin" || fail "compaction keeps every task"
+grep -q "Mapped 5 task(s)" "$dir/server.log" || fail "restart maps the compacted task file"
+
+echo PASS
\ No newline at end of file